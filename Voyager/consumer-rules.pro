@@ -0,0 +1,11 @@
+# Classes and members resolved once by libxmlParser in JNI_OnLoad.
+# Renaming or stripping any of them makes the native library refuse to load.
+-keep class com.voyager.core.data.utils.XmlToken$StartElement { <init>(java.lang.String, androidx.collection.ArrayMap); }
+-keep class com.voyager.core.data.utils.XmlToken$EndElement { <init>(java.lang.String); }
+-keep class com.voyager.core.data.utils.XmlToken$Text { <init>(java.lang.String); }
+-keep interface com.voyager.core.data.utils.XmlTokenStream { *; }
+-keep interface com.voyager.core.data.utils.FlatTreeStream { *; }
+-keep interface com.voyager.core.data.utils.CacheProbe { *; }
+-keep interface com.voyager.core.data.utils.BatchParseCallback { *; }
+-keep interface com.voyager.core.data.utils.ParseJobCallback { *; }
+-keep class androidx.collection.ArrayMap { <init>(int); put(...); }
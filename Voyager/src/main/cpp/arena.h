@@ -0,0 +1,224 @@
+/**
+ * Bump-pointer arena for per-parse native allocations.
+ *
+ * Allocation is a pointer increment inside the current block; nothing is freed
+ * individually. `reset()` releases everything in one shot and keeps the blocks (up to a
+ * budget), so a thread-local arena reaches a steady state where parsing does not touch malloc.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+class Arena {
+public:
+    explicit Arena(size_t blockSize = DEFAULT_BLOCK_SIZE, size_t maxRetained = DEFAULT_MAX_RETAINED)
+            : blockSize(blockSize), maxRetained(maxRetained) {}
+
+    ~Arena() {
+        freeChain(head);
+    }
+
+    Arena(const Arena &) = delete;
+
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * Returns `size` bytes aligned to `align` (a power of two). Never returns null;
+     * throws std::bad_alloc if the system is out of memory.
+     */
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        uintptr_t aligned = (cursor + align - 1) & ~(uintptr_t(align) - 1);
+        if (!current || aligned + size > limit) {
+            grow(size + align);
+            aligned = (cursor + align - 1) & ~(uintptr_t(align) - 1);
+        }
+        cursor = aligned + size;
+        used += size;
+        if (used > peak) peak = used;
+        return reinterpret_cast<void *>(aligned);
+    }
+
+    template<typename T>
+    T *allocateArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destroyed");
+        return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    /**
+     * Frees everything allocated since the last reset in one shot. Blocks are kept for the
+     * next parse up to `maxRetained` bytes; the rest go back to the system.
+     */
+    void reset() {
+        size_t kept = 0;
+        Block *last = nullptr;
+        for (Block *block = head; block; block = block->next) {
+            if (last && kept + block->size > maxRetained) break;
+            kept += block->size;
+            last = block;
+        }
+        if (last) {
+            freeChain(last->next);
+            last->next = nullptr;
+        }
+        current = nullptr;
+        cursor = limit = 0;
+        used = 0;
+        peak = 0;
+    }
+
+    // Bytes handed out since the last reset
+    size_t bytesUsed() const {
+        return used;
+    }
+
+    // Highest bytesUsed() since the last reset
+    size_t peakBytesUsed() const {
+        return peak;
+    }
+
+    // Bytes currently reserved from the system
+    size_t bytesReserved() const {
+        return reserved;
+    }
+
+    // Number of blocks obtained from malloc since construction
+    size_t systemAllocations() const {
+        return mallocs;
+    }
+
+private:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 16 * 1024;
+    static constexpr size_t DEFAULT_MAX_RETAINED = 256 * 1024;
+
+    struct Block {
+        Block *next;
+        size_t size;
+    };
+
+    size_t blockSize;
+    size_t maxRetained;
+    Block *head = nullptr;
+    Block *current = nullptr;
+    uintptr_t cursor = 0;
+    uintptr_t limit = 0;
+    size_t used = 0;
+    size_t peak = 0;
+    size_t reserved = 0;
+    size_t mallocs = 0;
+
+    void grow(size_t minimum) {
+        // Move on to a block retained from an earlier parse if one is big enough
+        Block *next = current ? current->next : head;
+        while (next) {
+            current = next;
+            if (current->size >= minimum + sizeof(Block)) {
+                useCurrent();
+                return;
+            }
+            next = current->next;
+        }
+
+        size_t size = sizeof(Block) + (minimum > blockSize ? minimum : blockSize);
+        auto *block = static_cast<Block *>(std::malloc(size));
+        if (!block) throw std::bad_alloc();
+        block->size = size;
+        block->next = nullptr;
+        reserved += size;
+        mallocs++;
+        if (current) current->next = block;
+        else head = block;
+        current = block;
+        useCurrent();
+    }
+
+    void useCurrent() {
+        cursor = reinterpret_cast<uintptr_t>(current) + sizeof(Block);
+        limit = reinterpret_cast<uintptr_t>(current) + current->size;
+    }
+
+    void freeChain(Block *block) {
+        while (block) {
+            Block *next = block->next;
+            reserved -= block->size;
+            std::free(block);
+            block = next;
+        }
+    }
+};
+
+/**
+ * Growable array of trivially copyable values backed by an Arena.
+ * Growing abandons the old storage to the arena, which is reclaimed on reset.
+ */
+template<typename T>
+class ArenaVector {
+    static_assert(std::is_trivially_copyable<T>::value, "ArenaVector stores raw values");
+
+public:
+    explicit ArenaVector(Arena &arena) : arena(&arena) {}
+
+    void push_back(const T &value) {
+        if (count == capacity) reserve(capacity ? capacity * 2 : INITIAL_CAPACITY);
+        items[count++] = value;
+    }
+
+    void append(const T *values, size_t length) {
+        if (count + length > capacity) reserve(std::max(capacity * 2, count + length));
+        if (length) std::memcpy(items + count, values, sizeof(T) * length);
+        count += length;
+    }
+
+    void reserve(size_t required) {
+        if (required <= capacity) return;
+        T *grown = arena->allocateArray<T>(required);
+        if (count) std::memcpy(grown, items, sizeof(T) * count);
+        items = grown;
+        capacity = required;
+    }
+
+    void resize(size_t size) {
+        reserve(size);
+        count = size;
+    }
+
+    T &operator[](size_t index) { return items[index]; }
+
+    const T &operator[](size_t index) const { return items[index]; }
+
+    T &back() { return items[count - 1]; }
+
+    void pop_back() { count--; }
+
+    T *data() { return items; }
+
+    const T *data() const { return items; }
+
+    size_t size() const { return count; }
+
+    bool empty() const { return count == 0; }
+
+    void clear() { count = 0; }
+
+    // Forgets the storage without touching it; needed once the arena has been reset
+    void abandon() {
+        items = nullptr;
+        count = capacity = 0;
+    }
+
+private:
+    static constexpr size_t INITIAL_CAPACITY = 16;
+
+    Arena *arena;
+    T *items = nullptr;
+    size_t count = 0;
+    size_t capacity = 0;
+};
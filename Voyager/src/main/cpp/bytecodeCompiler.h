@@ -0,0 +1,424 @@
+/**
+ * Compiles element events straight into Voyager layout bytecode, without any JNI.
+ *
+ * Each start tag is turned into its instructions as soon as Expat reports it, so the
+ * whole layout is compiled in the parse's single pass and no tree is ever built. Both
+ * formats run on `BytecodeInterpreter` on the Kotlin side; integers are little-endian.
+ *
+ * Version 1, the format written by `BytecodeGenerator` (strings `[length:i32][utf8]`):
+ * - header `[version:u8 = 1][timestamp:i32][rootType:string][viewCount:i32]`
+ * - `OPTIMIZE_HINT "activity" <name>`, before any view exists, so v1 interpreters skip it
+ * - per element, in document order: `CREATE_VIEW [type]`, then `ADD_CHILD [parent][index]`
+ *   unless it is the root, `SET_ID [name]` if it has an id, and one
+ *   `SET_ATTRIBUTE [key][STRING value]` per attribute. Views are indexed in creation
+ *   order, and attributes apply to the view created last, i.e. this one
+ * - `FINALIZE`, then the end marker
+ *
+ * Version 2 stores every distinct name and value once, in a constant pool, and refers
+ * to it by index; all counts and operands are unsigned LEB128 varints:
+ * - header `[version:u8 = 2][timestamp:i32][viewCount][rootType:const][activity:const]`
+ * - constants `[count]([tag:u8][payload])*`: `STRING [length][utf8]`, `INT [zigzag]`,
+ *   `BOOLEAN [u8]`, `DIMENSION [unit:u8][zigzag]`, `COLOR [form:u8][argb:u32]`. A value is
+ *   only typed when its text can be rebuilt from the typed form exactly (no "007", no
+ *   "0.5dp"; see typeValue), so `android:text="12"` still reads back as "12"
+ * - view index `([codeOffset:u32][descendants:u32])` per view in creation order. A view's
+ *   subtree is the views after it up to its descendant count, and its code runs from its
+ *   offset to that of the first view past the subtree (or to FINALIZE)
+ * - code `[length]` bytes: per element `CREATE_VIEW [type]`, `ADD_CHILD [parent]` (the
+ *   child being the view just created) unless it is the root, `SET_ID [name]`, and
+ *   `SET_ATTRIBUTE [key][value]`, all constant indices; then `FINALIZE`
+ * - the end marker
+ *
+ * Attribute keys drop their namespace prefix, as in every other native output.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#pragma once
+
+#include "arena.h"
+#include "flatTreeBuilder.h"
+#include "internTable.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+class BytecodeCompiler {
+public:
+    static constexpr uint8_t VERSION_1 = 1;
+    static constexpr uint8_t VERSION_2 = 2;
+
+    static constexpr uint8_t OP_CREATE_VIEW = 0x10;
+    static constexpr uint8_t OP_SET_ATTRIBUTE = 0x20;
+    static constexpr uint8_t OP_ADD_CHILD = 0x40;
+    static constexpr uint8_t OP_SET_ID = 0x50;
+    static constexpr uint8_t OP_OPTIMIZE_HINT = 0x60;
+    static constexpr uint8_t OP_FINALIZE = 0xF0;
+    static constexpr uint8_t END_MARKER = 0xFF;
+
+    // Value and constant tags; v1 only uses TYPE_STRING
+    static constexpr uint8_t TYPE_STRING = 0x01;
+    static constexpr uint8_t TYPE_INT = 0x02;
+    static constexpr uint8_t TYPE_BOOLEAN = 0x04;
+    static constexpr uint8_t TYPE_DIMENSION = 0x05;
+    static constexpr uint8_t TYPE_COLOR = 0x06;
+
+    // DIMENSION units, by their index
+    static constexpr const char *UNITS[] = {"px", "dp", "sp", "pt", "in", "mm", "dip"};
+
+    // COLOR form bits: which of the equivalent spellings the source used
+    static constexpr uint8_t COLOR_HAS_ALPHA = 0x01;
+    static constexpr uint8_t COLOR_LOWERCASE = 0x02;
+
+    /**
+     * @param constants The v2 constant pool, usually the parse's InternTable; it must be
+     *                  empty and not otherwise used during the parse
+     * @param activityName Recorded in the output; must outlive the compiler
+     */
+    BytecodeCompiler(Arena &arena, InternTable &constants, std::string_view activityName,
+                     uint8_t version = VERSION_2)
+            : version(version), constants(constants), activityName(activityName), code(arena),
+              openViews(arena), index(arena), scratch(arena) {}
+
+    void startElement(const char *name, const char **attributes) {
+        if (version == VERSION_1) {
+            startElementV1(name, attributes);
+        } else {
+            startElementV2(name, attributes);
+        }
+        viewCount++;
+    }
+
+    void endElement() {
+        if (openViews.empty()) return;
+        uint32_t view = openViews.back();
+        openViews.pop_back();
+        if (version == VERSION_2) index[view].descendants = static_cast<uint32_t>(viewCount - view - 1);
+    }
+
+    size_t views() const {
+        return viewCount;
+    }
+
+    // Exact size of the compiled layout; only meaningful once a root element was seen
+    size_t serializedSize() const {
+        Output out{nullptr};
+        write(out, 0);
+        return out.size;
+    }
+
+    // Writes the compiled layout into `out`, which must hold serializedSize() bytes
+    void serialize(uint8_t *out, int32_t timestamp) const {
+        Output output{out};
+        write(output, timestamp);
+    }
+
+    /**
+     * Appends the v2 constant for an attribute value to `out`: its tag and payload, typed
+     * when the text is exactly what the typed form prints back. Exposed for tests.
+     */
+    static void typeValue(std::string_view value, ArenaVector<uint8_t> &out) {
+        int32_t number;
+        if (value == "true" || value == "false") {
+            out.push_back(TYPE_BOOLEAN);
+            out.push_back(value == "true" ? 1 : 0);
+        } else if (parseCanonicalInt(value, number)) {
+            out.push_back(TYPE_INT);
+            appendVarint(out, zigzag(number));
+        } else if (!typeDimension(value, out) && !typeColor(value, out)) {
+            out.push_back(TYPE_STRING);
+            out.append(reinterpret_cast<const uint8_t *>(value.data()), value.size());
+        }
+    }
+
+private:
+    static constexpr char ACTIVITY_HINT[] = "activity";
+
+    struct IndexEntry {
+        uint32_t codeOffset;
+        uint32_t descendants;
+    };
+
+    // Writes to memory, or only counts when `out` is null
+    struct Output {
+        uint8_t *out;
+        size_t size = 0;
+
+        void u8(uint8_t value) {
+            if (out) out[size] = value;
+            size++;
+        }
+
+        void i32(int32_t value) {
+            auto bits = static_cast<uint32_t>(value);
+            for (int shift = 0; shift < 32; shift += 8) u8(static_cast<uint8_t>(bits >> shift));
+        }
+
+        void varint(uint64_t value) {
+            while (value >= 0x80) {
+                u8(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            u8(static_cast<uint8_t>(value));
+        }
+
+        void bytes(const uint8_t *data, size_t length) {
+            if (out && length) std::memcpy(out + size, data, length);
+            size += length;
+        }
+    };
+
+    uint8_t version;
+    InternTable &constants;
+    std::string_view activityName;
+    // v1: instructions with inline strings; v2: instructions with constant indices
+    ArenaVector<uint8_t> code;
+    // Indices of the open elements' views, innermost last
+    ArenaVector<uint32_t> openViews;
+    // v2 view index
+    ArenaVector<IndexEntry> index;
+    // v2: the constant being built, interned by its tag and payload bytes
+    ArenaVector<uint8_t> scratch;
+    size_t viewCount = 0;
+    // v1: where the root's type string starts in `code` (right after its length)
+    size_t rootTypeOffset = 0;
+    uint32_t rootTypeConstant = 0;
+    uint32_t activityConstant = 0;
+
+    void startElementV1(const char *name, const char **attributes) {
+        auto view = static_cast<uint32_t>(viewCount);
+        code.push_back(OP_CREATE_VIEW);
+        if (viewCount == 0) rootTypeOffset = code.size() + 4;
+        putString(name, std::strlen(name));
+        if (!openViews.empty()) {
+            code.push_back(OP_ADD_CHILD);
+            putI32(static_cast<int32_t>(openViews.back()));
+            putI32(static_cast<int32_t>(view));
+        }
+        std::string_view id;
+        if (findId(attributes, id)) {
+            code.push_back(OP_SET_ID);
+            putString(id.data(), id.size());
+        }
+        for (const char **attr = attributes; *attr; attr += 2) {
+            const char *key = localName(*attr);
+            const char *value = attr[1] ? attr[1] : "";
+            code.push_back(OP_SET_ATTRIBUTE);
+            putString(key, std::strlen(key));
+            code.push_back(TYPE_STRING);
+            putString(value, std::strlen(value));
+        }
+        openViews.push_back(view);
+    }
+
+    void startElementV2(const char *name, const char **attributes) {
+        auto view = static_cast<uint32_t>(viewCount);
+        if (viewCount == 0) activityConstant = stringConstant(activityName);
+        index.push_back(IndexEntry{static_cast<uint32_t>(code.size()), 0});
+
+        uint32_t type = stringConstant(name);
+        if (viewCount == 0) rootTypeConstant = type;
+        code.push_back(OP_CREATE_VIEW);
+        appendVarint(code, type);
+        if (!openViews.empty()) {
+            code.push_back(OP_ADD_CHILD);
+            appendVarint(code, openViews.back());
+        }
+        std::string_view id;
+        if (findId(attributes, id)) {
+            code.push_back(OP_SET_ID);
+            appendVarint(code, stringConstant(id));
+        }
+        for (const char **attr = attributes; *attr; attr += 2) {
+            uint32_t key = stringConstant(localName(*attr));
+            scratch.clear();
+            typeValue(attr[1] ? attr[1] : "", scratch);
+            uint32_t value = constants.intern(reinterpret_cast<const char *>(scratch.data()),
+                                              scratch.size());
+            code.push_back(OP_SET_ATTRIBUTE);
+            appendVarint(code, key);
+            appendVarint(code, value);
+        }
+        openViews.push_back(view);
+    }
+
+    uint32_t stringConstant(std::string_view value) {
+        scratch.clear();
+        scratch.push_back(TYPE_STRING);
+        scratch.append(reinterpret_cast<const uint8_t *>(value.data()), value.size());
+        return constants.intern(reinterpret_cast<const char *>(scratch.data()), scratch.size());
+    }
+
+    void write(Output &out, int32_t timestamp) const {
+        if (version == VERSION_1) {
+            writeV1(out, timestamp);
+        } else {
+            writeV2(out, timestamp);
+        }
+    }
+
+    void writeV1(Output &out, int32_t timestamp) const {
+        uint32_t rootLength = 0;
+        if (viewCount > 0) {
+            const uint8_t *in = code.data() + rootTypeOffset - 4;
+            rootLength = in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+        }
+        out.u8(VERSION_1);
+        out.i32(timestamp);
+        out.i32(static_cast<int32_t>(rootLength));
+        out.bytes(code.data() + rootTypeOffset, rootLength);
+        out.i32(static_cast<int32_t>(viewCount));
+
+        out.u8(OP_OPTIMIZE_HINT);
+        out.i32(sizeof(ACTIVITY_HINT) - 1);
+        out.bytes(reinterpret_cast<const uint8_t *>(ACTIVITY_HINT), sizeof(ACTIVITY_HINT) - 1);
+        out.i32(static_cast<int32_t>(activityName.size()));
+        out.bytes(reinterpret_cast<const uint8_t *>(activityName.data()), activityName.size());
+
+        out.bytes(code.data(), code.size());
+        out.u8(OP_FINALIZE);
+        out.u8(END_MARKER);
+    }
+
+    void writeV2(Output &out, int32_t timestamp) const {
+        out.u8(VERSION_2);
+        out.i32(timestamp);
+        out.varint(viewCount);
+        out.varint(rootTypeConstant);
+        out.varint(activityConstant);
+
+        uint32_t constantCount = constants.size();
+        out.varint(constantCount);
+        for (uint32_t id = 0; id < constantCount; id++) {
+            std::string_view constant = constants.get(id);
+            auto *bytes = reinterpret_cast<const uint8_t *>(constant.data());
+            out.u8(bytes[0]);
+            // Typed payloads delimit themselves; strings need their length
+            if (bytes[0] == TYPE_STRING) out.varint(constant.size() - 1);
+            out.bytes(bytes + 1, constant.size() - 1);
+        }
+
+        for (size_t i = 0; i < index.size(); i++) {
+            out.i32(static_cast<int32_t>(index[i].codeOffset));
+            out.i32(static_cast<int32_t>(index[i].descendants));
+        }
+
+        out.varint(code.size() + 1);
+        out.bytes(code.data(), code.size());
+        out.u8(OP_FINALIZE);
+        out.u8(END_MARKER);
+    }
+
+    // The first id attribute, as the resource name the interpreter resolves
+    static bool findId(const char **attributes, std::string_view &id) {
+        for (const char **attr = attributes; *attr; attr += 2) {
+            if (std::strcmp(localName(*attr), "id") == 0 && attr[1]) {
+                id = resourceName(attr[1]);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // "@+id/title" or "@id/title" -> "title"
+    static std::string_view resourceName(const char *id) {
+        std::string_view value(id);
+        size_t slash = value.find('/');
+        return value.size() > 0 && value[0] == '@' && slash != std::string_view::npos ?
+               value.substr(slash + 1) : value;
+    }
+
+    // Decimal without sign noise or leading zeros, so printing it back gives the same text
+    static bool parseCanonicalInt(std::string_view text, int32_t &value) {
+        bool negative = !text.empty() && text[0] == '-';
+        std::string_view digits = negative ? text.substr(1) : text;
+        if (digits.empty() || digits.size() > 10 || (digits[0] == '0' && digits.size() > 1) ||
+            (negative && digits == "0")) {
+            return false;
+        }
+        int64_t result = 0;
+        for (char c: digits) {
+            if (c < '0' || c > '9') return false;
+            result = result * 10 + (c - '0');
+        }
+        if (negative) result = -result;
+        if (result < INT32_MIN || result > INT32_MAX) return false;
+        value = static_cast<int32_t>(result);
+        return true;
+    }
+
+    // "16dp", "-2px": a canonical integer followed by a known unit
+    static bool typeDimension(std::string_view value, ArenaVector<uint8_t> &out) {
+        size_t split = value.size();
+        while (split > 0 && value[split - 1] >= 'a' && value[split - 1] <= 'z') split--;
+        std::string_view unit = value.substr(split);
+        int32_t number;
+        if (unit.empty() || !parseCanonicalInt(value.substr(0, split), number)) return false;
+        for (uint8_t u = 0; u < sizeof(UNITS) / sizeof(UNITS[0]); u++) {
+            if (unit == UNITS[u]) {
+                out.push_back(TYPE_DIMENSION);
+                out.push_back(u);
+                appendVarint(out, zigzag(number));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // "#RRGGBB" or "#AARRGGBB" with hex letters all in one case
+    static bool typeColor(std::string_view value, ArenaVector<uint8_t> &out) {
+        if ((value.size() != 7 && value.size() != 9) || value[0] != '#') return false;
+        uint32_t argb = 0;
+        bool upper = false, lower = false;
+        for (char c: value.substr(1)) {
+            uint32_t digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+                lower = true;
+            } else if (c >= 'A' && c <= 'F') {
+                digit = c - 'A' + 10;
+                upper = true;
+            } else {
+                return false;
+            }
+            argb = argb << 4 | digit;
+        }
+        if (upper && lower) return false;
+        uint8_t form = 0;
+        if (value.size() == 9) {
+            form |= COLOR_HAS_ALPHA;
+        } else {
+            argb |= 0xFF000000u;
+        }
+        if (lower) form |= COLOR_LOWERCASE;
+        out.push_back(TYPE_COLOR);
+        out.push_back(form);
+        for (int shift = 0; shift < 32; shift += 8) out.push_back(static_cast<uint8_t>(argb >> shift));
+        return true;
+    }
+
+    static uint32_t zigzag(int32_t value) {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    static void appendVarint(ArenaVector<uint8_t> &out, uint32_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void putI32(int32_t value) {
+        auto bits = static_cast<uint32_t>(value);
+        for (int shift = 0; shift < 32; shift += 8) code.push_back(static_cast<uint8_t>(bits >> shift));
+    }
+
+    void putString(const char *data, size_t length) {
+        putI32(static_cast<int32_t>(length));
+        code.append(reinterpret_cast<const uint8_t *>(data), length);
+    }
+};
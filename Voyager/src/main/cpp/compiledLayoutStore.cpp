@@ -0,0 +1,370 @@
+/**
+ * Persistent compiled-layout store, see compiledLayoutStore.h.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "compiledLayoutStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+    constexpr const char *INDEX_FILE = "/layouts.idx";
+    constexpr const char *DATA_FILE = "/layouts.dat";
+    constexpr const char *COMPACTION_FILE = "/layouts.dat.tmp";
+
+    bool writeFully(int fd, const void *bytes, size_t length, off_t offset) {
+        const auto *in = static_cast<const uint8_t *>(bytes);
+        while (length > 0) {
+            ssize_t written = pwrite(fd, in, length, offset);
+            if (written <= 0) return false;
+            in += written;
+            length -= static_cast<size_t>(written);
+            offset += written;
+        }
+        return true;
+    }
+}
+
+CompiledLayoutStore::~CompiledLayoutStore() {
+    unmap();
+}
+
+bool CompiledLayoutStore::open(const char *path, size_t bound) {
+    lock_guard<mutex> guard(lock);
+    if (slots && directory == path) return true;
+    unmap();
+    directory = path;
+    maxBytes = max(bound, MIN_BYTES);
+
+    int fd = ::open((directory + INDEX_FILE).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+    size_t length = sizeof(IndexHeader) + sizeof(Slot) * CAPACITY;
+    struct stat info{};
+    bool fresh = fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) != length;
+    if (fresh && ftruncate(fd, static_cast<off_t>(length)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    void *address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // The mapping keeps the file referenced
+    ::close(fd);
+    if (address == MAP_FAILED) return false;
+    indexMapping = address;
+    header = static_cast<IndexHeader *>(address);
+    slots = reinterpret_cast<Slot *>(static_cast<uint8_t *>(address) + sizeof(IndexHeader));
+    verified.assign(CAPACITY, false);
+
+    dataFd = ::open((directory + DATA_FILE).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (dataFd < 0) {
+        unmap();
+        return false;
+    }
+    DataHeader dataHeader{};
+    bool consistent = !fresh && header->magic == INDEX_MAGIC && header->version == VERSION &&
+                      header->capacity == CAPACITY &&
+                      pread(dataFd, &dataHeader, sizeof(dataHeader), 0) == sizeof(dataHeader) &&
+                      dataHeader.magic == DATA_MAGIC && dataHeader.version == VERSION &&
+                      dataHeader.generation == header->generation &&
+                      header->dataLength >= sizeof(DataHeader) && fstat(dataFd, &info) == 0 &&
+                      header->dataLength <= static_cast<uint64_t>(info.st_size);
+    if ((!consistent && !reset()) || !mapData()) {
+        unmap();
+        return false;
+    }
+    // The bound may have shrunk since the last run
+    if (header->dataLength > maxBytes) compact(0);
+    return true;
+}
+
+void CompiledLayoutStore::close() {
+    lock_guard<mutex> guard(lock);
+    unmap();
+}
+
+bool CompiledLayoutStore::isOpen() {
+    lock_guard<mutex> guard(lock);
+    return slots != nullptr;
+}
+
+bool CompiledLayoutStore::find(uint32_t kind, const uint8_t *key, size_t keyLength,
+                               vector<uint8_t> &payload) {
+    lock_guard<mutex> guard(lock);
+    if (!slots || keyLength == 0 || keyLength > MAX_KEY_LENGTH) return false;
+
+    Slot *slot = findSlot(kind, key, keyLength);
+    if (!slot) return false;
+    const uint8_t *stored = data + slot->offset + sizeof(RecordHeader);
+    size_t index = slot - slots;
+    if (!verified[index]) {
+        if (!recordMatches(*slot) ||
+            payloadChecksumOf(stored, slot->length) != slot->payloadChecksum) {
+            slot->checksum = 0;
+            return false;
+        }
+        verified[index] = true;
+    }
+    slot->lastUse = ++header->clock;
+    payload.assign(stored, stored + slot->length);
+    return true;
+}
+
+bool CompiledLayoutStore::put(uint32_t kind, const uint8_t *key, size_t keyLength,
+                              const uint8_t *payload, size_t length) {
+    if (keyLength == 0 || keyLength > MAX_KEY_LENGTH || length > UINT32_MAX) return false;
+
+    lock_guard<mutex> guard(lock);
+    if (!slots) return false;
+    size_t size = recordSize(length);
+    if (sizeof(DataHeader) + size > maxBytes) return false;
+    if (header->dataLength + size > maxBytes && !compact(size)) return false;
+
+    Slot *target = claimSlot(kind, key, keyLength);
+    // Invalidate first so a torn write is never mistaken for a valid entry
+    target->checksum = 0;
+
+    RecordHeader record{};
+    record.magic = RECORD_MAGIC;
+    record.kind = kind;
+    record.keyLength = static_cast<uint32_t>(keyLength);
+    record.length = static_cast<uint32_t>(length);
+    memcpy(record.key, key, keyLength);
+    uint8_t padding[8] = {};
+    off_t offset = static_cast<off_t>(header->dataLength);
+    if (!writeFully(dataFd, &record, sizeof(record), offset) ||
+        !writeFully(dataFd, payload, length, offset + static_cast<off_t>(sizeof(record))) ||
+        !writeFully(dataFd, padding, size - sizeof(record) - length,
+                    offset + static_cast<off_t>(sizeof(record) + length))) {
+        return false;
+    }
+
+    memset(target, 0, sizeof(Slot));
+    memcpy(target->key, key, keyLength);
+    target->keyLength = static_cast<uint32_t>(keyLength);
+    target->kind = kind;
+    target->offset = header->dataLength;
+    target->length = static_cast<uint32_t>(length);
+    target->payloadChecksum = payloadChecksumOf(payload, length);
+    target->lastUse = ++header->clock;
+    target->checksum = checksumOf(*target);
+    verified[target - slots] = true;
+    header->dataLength += size;
+    return true;
+}
+
+size_t CompiledLayoutStore::recordCount() {
+    lock_guard<mutex> guard(lock);
+    if (!slots) return 0;
+    return count_if(slots, slots + CAPACITY, [](const Slot &slot) { return isValid(slot); });
+}
+
+size_t CompiledLayoutStore::liveBytes() {
+    lock_guard<mutex> guard(lock);
+    size_t total = 0;
+    for (uint32_t i = 0; slots && i < CAPACITY; i++) {
+        if (isValid(slots[i])) total += recordSize(slots[i].length);
+    }
+    return total;
+}
+
+void CompiledLayoutStore::unmap() {
+    if (indexMapping) munmap(indexMapping, sizeof(IndexHeader) + sizeof(Slot) * CAPACITY);
+    if (data) munmap(const_cast<uint8_t *>(data), dataMappingLength);
+    if (dataFd >= 0) ::close(dataFd);
+    indexMapping = nullptr;
+    header = nullptr;
+    slots = nullptr;
+    data = nullptr;
+    dataMappingLength = 0;
+    dataFd = -1;
+}
+
+// Empties both files and moves them to the next generation
+bool CompiledLayoutStore::reset() {
+    uint64_t generation = header->generation + 1;
+    memset(indexMapping, 0, sizeof(IndexHeader) + sizeof(Slot) * CAPACITY);
+    verified.assign(CAPACITY, false);
+
+    DataHeader dataHeader{DATA_MAGIC, VERSION, generation};
+    if (ftruncate(dataFd, 0) != 0 || !writeFully(dataFd, &dataHeader, sizeof(dataHeader), 0)) {
+        return false;
+    }
+    header->magic = INDEX_MAGIC;
+    header->version = VERSION;
+    header->capacity = CAPACITY;
+    header->generation = generation;
+    header->dataLength = sizeof(DataHeader);
+    return true;
+}
+
+// Maps the data file at its bound, so records appended later are already covered
+bool CompiledLayoutStore::mapData() {
+    struct stat info{};
+    if (fstat(dataFd, &info) != 0) return false;
+    size_t length = max(maxBytes, static_cast<size_t>(info.st_size));
+    void *address = mmap(nullptr, length, PROT_READ, MAP_SHARED, dataFd, 0);
+    if (address == MAP_FAILED) return false;
+    // Nothing points into the old file once find() has copied its payload out
+    if (data) munmap(const_cast<uint8_t *>(data), dataMappingLength);
+    data = static_cast<const uint8_t *>(address);
+    dataMappingLength = length;
+    return true;
+}
+
+/**
+ * Rewrites the data file with the most recently used records that fit in three quarters
+ * of the bound, leaving room for `incoming` more bytes, and rebuilds the index over it.
+ */
+bool CompiledLayoutStore::compact(size_t incoming) {
+    // Each live slot with whether its checksum was already verified
+    vector<pair<Slot, bool>> kept;
+    for (uint32_t i = 0; i < CAPACITY; i++) {
+        if (isValid(slots[i]) && recordMatches(slots[i])) kept.emplace_back(slots[i], verified[i]);
+    }
+    sort(kept.begin(), kept.end(), [](const pair<Slot, bool> &a, const pair<Slot, bool> &b) {
+        return a.first.lastUse > b.first.lastUse;
+    });
+
+    size_t room = maxBytes - sizeof(DataHeader) - incoming;
+    size_t budget = min(maxBytes / 4 * 3, room);
+    uint64_t generation = header->generation + 1;
+    string compactionPath = directory + COMPACTION_FILE;
+    int fd = ::open(compactionPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+
+    DataHeader dataHeader{DATA_MAGIC, VERSION, generation};
+    bool ok = writeFully(fd, &dataHeader, sizeof(dataHeader), 0);
+    uint64_t end = sizeof(DataHeader);
+    size_t used = 0;
+    size_t count = 0;
+    for (auto &[slot, checked]: kept) {
+        size_t size = recordSize(slot.length);
+        if (!ok || used + size > budget) break;
+        ok = writeFully(fd, data + slot.offset, size, static_cast<off_t>(end));
+        slot.offset = end;
+        end += size;
+        used += size;
+        count++;
+    }
+    if (!ok || rename(compactionPath.c_str(), (directory + DATA_FILE).c_str()) != 0) {
+        ::close(fd);
+        unlink(compactionPath.c_str());
+        return false;
+    }
+    ::close(dataFd);
+    dataFd = fd;
+    if (!mapData()) {
+        // Nothing can be read back; start over rather than point into the old file
+        reset();
+        return false;
+    }
+
+    // Reinsert in recency order, so a crowded probe window keeps the hotter records
+    memset(slots, 0, sizeof(Slot) * CAPACITY);
+    verified.assign(CAPACITY, false);
+    for (size_t i = 0; i < count; i++) {
+        const Slot &slot = kept[i].first;
+        uint32_t home = homeSlot(slot.kind, slot.key, slot.keyLength);
+        for (uint32_t probe = 0; probe < MAX_PROBE; probe++) {
+            uint32_t index = (home + probe) & (CAPACITY - 1);
+            if (isValid(slots[index])) continue;
+            slots[index] = slot;
+            slots[index].checksum = checksumOf(slot);
+            verified[index] = kept[i].second;
+            break;
+        }
+    }
+    header->generation = generation;
+    header->dataLength = end;
+    return true;
+}
+
+CompiledLayoutStore::Slot *CompiledLayoutStore::findSlot(uint32_t kind, const uint8_t *key,
+                                                         size_t keyLength) {
+    uint32_t home = homeSlot(kind, key, keyLength);
+    for (uint32_t probe = 0; probe < MAX_PROBE; probe++) {
+        Slot &slot = slots[(home + probe) & (CAPACITY - 1)];
+        if (isValid(slot) && slot.kind == kind && slot.keyLength == keyLength &&
+            memcmp(slot.key, key, keyLength) == 0) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+// This key's slot, else the first free one, else the least recently used in the window
+CompiledLayoutStore::Slot *CompiledLayoutStore::claimSlot(uint32_t kind, const uint8_t *key,
+                                                          size_t keyLength) {
+    if (Slot *existing = findSlot(kind, key, keyLength)) return existing;
+    uint32_t home = homeSlot(kind, key, keyLength);
+    Slot *oldest = nullptr;
+    for (uint32_t probe = 0; probe < MAX_PROBE; probe++) {
+        Slot &slot = slots[(home + probe) & (CAPACITY - 1)];
+        if (!isValid(slot)) return &slot;
+        if (!oldest || slot.lastUse < oldest->lastUse) oldest = &slot;
+    }
+    oldest->checksum = 0;
+    return oldest;
+}
+
+// Whether the slot's record lies within the data file and carries the slot's key
+bool CompiledLayoutStore::recordMatches(const Slot &slot) const {
+    if (slot.offset < sizeof(DataHeader) ||
+        slot.offset + recordSize(slot.length) > header->dataLength) {
+        return false;
+    }
+    RecordHeader record{};
+    memcpy(&record, data + slot.offset, sizeof(record));
+    return record.magic == RECORD_MAGIC && record.kind == slot.kind &&
+           record.keyLength == slot.keyLength && record.length == slot.length &&
+           memcmp(record.key, slot.key, slot.keyLength) == 0;
+}
+
+size_t CompiledLayoutStore::recordSize(size_t length) {
+    return (sizeof(RecordHeader) + length + 7) & ~static_cast<size_t>(7);
+}
+
+uint32_t CompiledLayoutStore::payloadChecksumOf(const uint8_t *payload, size_t length) {
+    // FNV-1a over 64-bit words, then the tail, folded to 32 bits
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, payload + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < length; i++) hash = (hash ^ payload[i]) * 1099511628211ULL;
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+uint32_t CompiledLayoutStore::checksumOf(const Slot &slot) {
+    // FNV-1a over everything before the checksum; never zero so zeroed slots read as free
+    const auto *bytes = reinterpret_cast<const uint8_t *>(&slot);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(Slot, checksum); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash | 1u;
+}
+
+bool CompiledLayoutStore::isValid(const Slot &slot) {
+    return slot.checksum != 0 && slot.keyLength <= MAX_KEY_LENGTH &&
+           slot.checksum == checksumOf(slot);
+}
+
+uint32_t CompiledLayoutStore::homeSlot(uint32_t kind, const uint8_t *key, size_t keyLength) {
+    uint32_t hash = 2166136261u ^ kind;
+    for (size_t i = 0; i < keyLength; i++) {
+        hash ^= key[i];
+        hash *= 16777619u;
+    }
+    return hash & (CAPACITY - 1);
+}
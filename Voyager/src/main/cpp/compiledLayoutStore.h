@@ -0,0 +1,158 @@
+/**
+ * Persistent store of compiled layouts (e.g. serialized flat trees) keyed by the content
+ * fingerprint of their XML, so a layout parsed in an earlier process is mapped back in
+ * instead of parsed again.
+ *
+ * Two files in one directory:
+ * - `layouts.dat`, append-only: a header carrying the file's generation, then records
+ *   `[RecordHeader][payload]`, each padded to 8 bytes. It is mapped read-only once, at
+ *   the size bound, so payloads are read in place and appends need no remapping.
+ * - `layouts.idx`, a fixed-size open-addressing table mapped read-write, as in
+ *   StatKeyIndex. Each slot points at one record and carries its payload checksum and
+ *   the logical time it was last used.
+ *
+ * A payload's checksum is verified on its first lookup in this process; a mismatch drops
+ * the record. Lookups copy the payload out under the lock, so the store never keeps a
+ * replaced data file mapped for a reader. When an append would outgrow the size bound, the most recently used
+ * records are copied into a new data file of the next generation and the index is
+ * rebuilt over it (LRU compaction). An index and data file of different generations,
+ * e.g. after a crash during compaction, are discarded together.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class CompiledLayoutStore {
+public:
+    static constexpr size_t MAX_KEY_LENGTH = 32;
+    static constexpr size_t MIN_BYTES = 64 * 1024;
+
+    CompiledLayoutStore() = default;
+
+    ~CompiledLayoutStore();
+
+    CompiledLayoutStore(const CompiledLayoutStore &) = delete;
+
+    CompiledLayoutStore &operator=(const CompiledLayoutStore &) = delete;
+
+    /**
+     * Opens the store in `directory`, which must exist, creating its files if needed and
+     * discarding them if they are foreign, outdated or out of step. The data file is kept
+     * below `maxBytes` (at least MIN_BYTES). Opening the directory that is already open
+     * does nothing; opening another one closes the current store first.
+     */
+    bool open(const char *directory, size_t maxBytes);
+
+    void close();
+
+    bool isOpen();
+
+    /**
+     * Looks up the payload stored under `kind` and `key`, marks it as used and copies it
+     * into `payload`. Returns false, leaving `payload` alone, on a miss or if the record
+     * fails its checksum.
+     */
+    bool find(uint32_t kind, const uint8_t *key, size_t keyLength, std::vector<uint8_t> &payload);
+
+    /**
+     * Appends a payload under `kind` and `key`, replacing an older one. Compacts first if
+     * the data file would outgrow its bound; payloads too large to fit are not stored.
+     */
+    bool put(uint32_t kind, const uint8_t *key, size_t keyLength, const uint8_t *payload,
+             size_t length);
+
+    // Number of records and bytes of the data file they occupy, dead records excluded
+    size_t recordCount();
+
+    size_t liveBytes();
+
+private:
+    static constexpr uint32_t INDEX_MAGIC = 0x49534c56;  // "VLSI"
+    static constexpr uint32_t DATA_MAGIC = 0x44534c56;  // "VLSD"
+    static constexpr uint32_t RECORD_MAGIC = 0x52534c56;  // "VLSR"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t CAPACITY = 1024;  // Power of two
+    static constexpr uint32_t MAX_PROBE = 8;
+
+    struct IndexHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t capacity;
+        uint32_t reserved;
+        uint64_t generation;
+        // End of the last complete record in the data file; appends start here
+        uint64_t dataLength;
+        uint64_t clock;
+    };
+
+    struct Slot {
+        uint8_t key[MAX_KEY_LENGTH];
+        uint32_t keyLength;
+        uint32_t kind;
+        uint64_t offset;
+        uint32_t length;
+        uint32_t payloadChecksum;
+        // Non-zero checksum of the fields above; zero or a mismatch marks a free slot
+        uint32_t checksum;
+        uint32_t reserved;
+        // Logical time of the last find() or put(), outside the checksum so hits only write it
+        uint64_t lastUse;
+    };
+
+    struct DataHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t generation;
+    };
+
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t kind;
+        uint32_t keyLength;
+        uint32_t length;
+        uint8_t key[MAX_KEY_LENGTH];
+    };
+
+    std::mutex lock;
+    std::string directory;
+    size_t maxBytes = 0;
+    int dataFd = -1;
+    void *indexMapping = nullptr;
+    IndexHeader *header = nullptr;
+    Slot *slots = nullptr;
+    const uint8_t *data = nullptr;
+    size_t dataMappingLength = 0;
+    // Slots whose payload checksum has been verified in this process
+    std::vector<bool> verified;
+
+    void unmap();
+
+    bool reset();
+
+    bool mapData();
+
+    bool compact(size_t incoming);
+
+    Slot *findSlot(uint32_t kind, const uint8_t *key, size_t keyLength);
+
+    Slot *claimSlot(uint32_t kind, const uint8_t *key, size_t keyLength);
+
+    bool recordMatches(const Slot &slot) const;
+
+    static size_t recordSize(size_t length);
+
+    static uint32_t payloadChecksumOf(const uint8_t *payload, size_t length);
+
+    static uint32_t checksumOf(const Slot &slot);
+
+    static bool isValid(const Slot &slot);
+
+    static uint32_t homeSlot(uint32_t kind, const uint8_t *key, size_t keyLength);
+};
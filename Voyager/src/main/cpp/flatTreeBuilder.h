@@ -0,0 +1,169 @@
+/**
+ * Builds the flat view tree from element events and serializes it, without any JNI.
+ *
+ * Nodes, attribute spans and child indices live in the caller's arena while the tree is
+ * built; names and values are ids into the caller's InternTable. Tree layout
+ * (little-endian), read by `FlatViewTree` on the Kotlin side:
+ * - header `[magic:u32 "VFT1"][version:u16][hashLength:u16][nodeCount:u32][attrCount:u32]
+ *   [childCount:u32][stringCount:u32][poolBytes:u32]`, then the content fingerprint
+ * - nodes `([typeId:u32][attrStart:u32][attrCount:u32][childStart:u32][childCount:u32])*`,
+ *   node 0 being the root
+ * - attributes `([keyId:u32][valueId:u32])*`
+ * - children `[nodeIndex:u32]*`; a node's children are a contiguous range
+ * - strings `([offset:u32][length:u32])*` into the UTF-8 pool that follows
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#pragma once
+
+#include "arena.h"
+#include "internTable.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Returns the attribute name without its namespace prefix ("android:text" -> "text")
+inline const char *localName(const char *qualifiedName) {
+    const char *colon = std::strchr(qualifiedName, ':');
+    return colon ? colon + 1 : qualifiedName;
+}
+
+class FlatTreeBuilder {
+public:
+    // Format version written into the header; FlatViewTree rejects any other. Version 2
+    // turned the former `flags` field into `hashLength`
+    static constexpr uint16_t VERSION = 2;
+
+    FlatTreeBuilder(Arena &arena, InternTable &strings)
+            : strings(strings), nodes(arena), attributes(arena), children(arena),
+              openNodes(arena), pendingChildren(arena) {}
+
+    void startElement(const char *name, const char **attributeList) {
+        auto index = static_cast<uint32_t>(nodes.size());
+        FlatNode node{};
+        node.typeId = strings.intern(name, std::strlen(name), true);
+        node.attrStart = static_cast<uint32_t>(attributes.size() / 2);
+        for (const char **attr = attributeList; *attr; attr += 2) {
+            const char *key = localName(*attr);
+            const char *value = attr[1] ? attr[1] : "";
+            attributes.push_back(strings.intern(key, std::strlen(key), true));
+            attributes.push_back(strings.intern(value, std::strlen(value)));
+            node.attrCount++;
+        }
+        // Until the element ends, childStart marks where its children begin in pendingChildren
+        node.childStart = static_cast<uint32_t>(pendingChildren.size() + 1);
+        nodes.push_back(node);
+
+        pendingChildren.push_back(index);
+        openNodes.push_back(index);
+    }
+
+    void endElement() {
+        if (openNodes.empty()) return;
+        FlatNode &node = nodes[openNodes.back()];
+        openNodes.pop_back();
+
+        size_t mark = node.childStart;
+        node.childStart = static_cast<uint32_t>(children.size());
+        node.childCount = static_cast<uint32_t>(pendingChildren.size() - mark);
+        for (size_t i = mark; i < pendingChildren.size(); i++) {
+            children.push_back(pendingChildren[i]);
+        }
+        pendingChildren.resize(mark);
+    }
+
+    // Exact size of the serialized tree carrying a fingerprint of `hashLength` bytes
+    size_t serializedSize(size_t hashLength) const {
+        uint32_t stringCount = strings.size();
+        size_t poolBytes = 0;
+        for (uint32_t id = 0; id < stringCount; id++) poolBytes += strings.get(id).size();
+        return HEADER_SIZE + hashLength + NODE_SIZE * nodes.size() + 4 * attributes.size() +
+               4 * children.size() + 8 * stringCount + poolBytes;
+    }
+
+    // Writes the tree into `out`, which must hold serializedSize(hashLength) bytes
+    void serialize(uint8_t *out, const uint8_t *hash, size_t hashLength) const {
+        Writer writer{out};
+        uint32_t stringCount = strings.size();
+        size_t poolBytes = 0;
+        for (uint32_t id = 0; id < stringCount; id++) poolBytes += strings.get(id).size();
+
+        writer.putU32(MAGIC);
+        writer.putU16(VERSION);
+        writer.putU16(static_cast<uint16_t>(hashLength));
+        writer.putU32(static_cast<uint32_t>(nodes.size()));
+        writer.putU32(static_cast<uint32_t>(attributes.size() / 2));
+        writer.putU32(static_cast<uint32_t>(children.size()));
+        writer.putU32(stringCount);
+        writer.putU32(static_cast<uint32_t>(poolBytes));
+        writer.putBytes(hash, hashLength);
+
+        for (size_t i = 0; i < nodes.size(); i++) {
+            const FlatNode &node = nodes[i];
+            writer.putU32(node.typeId);
+            writer.putU32(node.attrStart);
+            writer.putU32(node.attrCount);
+            writer.putU32(node.childStart);
+            writer.putU32(node.childCount);
+        }
+        for (size_t i = 0; i < attributes.size(); i++) writer.putU32(attributes[i]);
+        for (size_t i = 0; i < children.size(); i++) writer.putU32(children[i]);
+
+        uint32_t offset = 0;
+        for (uint32_t id = 0; id < stringCount; id++) {
+            auto length = static_cast<uint32_t>(strings.get(id).size());
+            writer.putU32(offset);
+            writer.putU32(length);
+            offset += length;
+        }
+        for (uint32_t id = 0; id < stringCount; id++) {
+            std::string_view value = strings.get(id);
+            writer.putBytes(reinterpret_cast<const uint8_t *>(value.data()), value.size());
+        }
+    }
+
+    size_t nodeCount() const {
+        return nodes.size();
+    }
+
+private:
+    static constexpr uint32_t MAGIC = 0x31544656;  // "VFT1"
+    static constexpr size_t HEADER_SIZE = 28;
+    static constexpr size_t NODE_SIZE = 20;
+
+    struct FlatNode {
+        uint32_t typeId;
+        uint32_t attrStart;
+        uint32_t attrCount;
+        uint32_t childStart;
+        uint32_t childCount;
+    };
+
+    struct Writer {
+        uint8_t *out;
+
+        void putU16(uint16_t value) {
+            *out++ = static_cast<uint8_t>(value);
+            *out++ = static_cast<uint8_t>(value >> 8);
+        }
+
+        void putU32(uint32_t value) {
+            for (int shift = 0; shift < 32; shift += 8) *out++ = static_cast<uint8_t>(value >> shift);
+        }
+
+        void putBytes(const uint8_t *data, size_t length) {
+            if (length) std::memcpy(out, data, length);
+            out += length;
+        }
+    };
+
+    InternTable &strings;
+    ArenaVector<FlatNode> nodes;
+    ArenaVector<uint32_t> attributes;
+    ArenaVector<uint32_t> children;
+    ArenaVector<uint32_t> openNodes;
+    // Children of the open elements, innermost last; moved to `children` as each one ends
+    ArenaVector<uint32_t> pendingChildren;
+};
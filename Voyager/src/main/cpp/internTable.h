@@ -0,0 +1,144 @@
+/**
+ * Per-session string intern table for the native XML parser.
+ *
+ * Maps byte spans (element names, attribute keys and values, text runs) to small,
+ * dense integer ids. Each distinct string is copied once into a contiguous pool, so
+ * later tokens can refer to it by id and the JNI layer only has to turn it into a
+ * `jstring` once per parse.
+ *
+ * The table is reset between parses but keeps its capacity, so a thread that parses
+ * many layouts stops allocating after the first few.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+class InternTable {
+public:
+    static constexpr uint32_t NO_ID = UINT32_MAX;
+
+    InternTable() {
+        slots.assign(INITIAL_SLOTS, NO_ID);
+    }
+
+    /**
+     * Returns the id of the given span, adding it to the table if it is new.
+     *
+     * @param cacheable Whether the string may be shared beyond this parse (e.g. element
+     *                  names and attribute keys); sticky once set for an id
+     */
+    uint32_t intern(const char *data, size_t length, bool cacheable = false) {
+        uint32_t hash = hashBytes(data, length);
+        size_t mask = slots.size() - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            uint32_t id = slots[slot];
+            if (id == NO_ID) {
+                id = add(data, length, hash, cacheable);
+                slots[slot] = id;
+                if (entries.size() * 4 > slots.size() * 3) rehash();
+                return id;
+            }
+            const Entry &entry = entries[id];
+            if (entry.hash == hash && entry.length == length &&
+                memcmp(pool.data() + entry.offset, data, length) == 0) {
+                if (cacheable) entries[id].cacheable = true;
+                return id;
+            }
+        }
+    }
+
+    // Returns the id of the given span, or NO_ID if it has not been interned
+    uint32_t find(const char *data, size_t length) const {
+        uint32_t hash = hashBytes(data, length);
+        size_t mask = slots.size() - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            uint32_t id = slots[slot];
+            if (id == NO_ID) return NO_ID;
+            const Entry &entry = entries[id];
+            if (entry.hash == hash && entry.length == length &&
+                memcmp(pool.data() + entry.offset, data, length) == 0) {
+                return id;
+            }
+        }
+    }
+
+    std::string_view get(uint32_t id) const {
+        const Entry &entry = entries[id];
+        return {pool.data() + entry.offset, entry.length};
+    }
+
+    // Null-terminated view of the string, suitable for NewStringUTF
+    const char *c_str(uint32_t id) const {
+        return pool.data() + entries[id].offset;
+    }
+
+    bool isCacheable(uint32_t id) const {
+        return entries[id].cacheable;
+    }
+
+    uint32_t size() const {
+        return static_cast<uint32_t>(entries.size());
+    }
+
+    // Heap bytes held by the table, including capacity kept across clear()
+    size_t bytesReserved() const {
+        return pool.capacity() + entries.capacity() * sizeof(Entry) +
+               slots.capacity() * sizeof(uint32_t);
+    }
+
+    // Forgets all strings but keeps the allocated capacity for the next parse
+    void clear() {
+        pool.clear();
+        entries.clear();
+        std::fill(slots.begin(), slots.end(), NO_ID);
+    }
+
+    // FNV-1a; names and keys are short, so a simple byte loop is fast enough here
+    static uint32_t hashBytes(const char *data, size_t length) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < length; i++) {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+private:
+    static constexpr size_t INITIAL_SLOTS = 256;
+
+    struct Entry {
+        uint32_t offset;
+        uint32_t length;
+        uint32_t hash;
+        bool cacheable;
+    };
+
+    std::vector<char> pool;
+    std::vector<Entry> entries;
+    std::vector<uint32_t> slots;
+
+    uint32_t add(const char *data, size_t length, uint32_t hash, bool cacheable) {
+        auto offset = static_cast<uint32_t>(pool.size());
+        pool.insert(pool.end(), data, data + length);
+        pool.push_back('\0');
+        entries.push_back({offset, static_cast<uint32_t>(length), hash, cacheable});
+        return static_cast<uint32_t>(entries.size() - 1);
+    }
+
+    void rehash() {
+        slots.assign(slots.size() * 2, NO_ID);
+        size_t mask = slots.size() - 1;
+        for (uint32_t id = 0; id < entries.size(); id++) {
+            size_t slot = entries[id].hash & mask;
+            while (slots[slot] != NO_ID) slot = (slot + 1) & mask;
+            slots[slot] = id;
+        }
+    }
+};
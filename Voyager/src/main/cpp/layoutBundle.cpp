@@ -0,0 +1,217 @@
+/**
+ * Layout bundle reader and writer, see layoutBundle.h.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "layoutBundle.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+    // The bundle may sit at any offset of an APK, so fields are read without alignment
+    template<typename T>
+    T load(const uint8_t *in) {
+        T value;
+        memcpy(&value, in, sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    void store(uint8_t *out, T value) {
+        memcpy(out, &value, sizeof(T));
+    }
+
+    size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+LayoutBundle::~LayoutBundle() {
+    close();
+}
+
+bool LayoutBundle::open(int fd, int64_t offset, int64_t regionLength) {
+    close();
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || offset < 0 || offset > info.st_size) return false;
+    int64_t available = info.st_size - offset;
+    int64_t size = regionLength < 0 ? available : min(regionLength, available);
+    if (size < static_cast<int64_t>(HEADER_SIZE)) return false;
+
+    // mmap wants a page-aligned file offset; assets are only 4-byte aligned in the APK
+    auto page = static_cast<int64_t>(sysconf(_SC_PAGESIZE));
+    int64_t slack = offset % page;
+    size_t total = static_cast<size_t>(size + slack);
+    void *address = mmap(nullptr, total, PROT_READ, MAP_SHARED, fd, offset - slack);
+    if (address == MAP_FAILED) return false;
+
+    mapping = address;
+    mappedLength = total;
+    base = static_cast<const uint8_t *>(address) + slack;
+    length = static_cast<uint64_t>(size);
+    if (!validate()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool LayoutBundle::open(const char *path) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool opened = open(fd, 0, -1);
+    // The mapping keeps the file referenced
+    ::close(fd);
+    return opened;
+}
+
+void LayoutBundle::close() {
+    if (mapping) munmap(mapping, mappedLength);
+    mapping = nullptr;
+    mappedLength = 0;
+    base = nullptr;
+    length = 0;
+    count = 0;
+    index = nullptr;
+    pool = nullptr;
+}
+
+string_view LayoutBundle::name(uint32_t position) const {
+    const uint8_t *entry = index + static_cast<size_t>(position) * ENTRY_SIZE;
+    return {pool + load<uint32_t>(entry), load<uint32_t>(entry + 4)};
+}
+
+bool LayoutBundle::find(string_view name, Record &record) const {
+    uint32_t low = 0;
+    uint32_t high = count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        int order = this->name(middle).compare(name);
+        if (order == 0) {
+            entryAt(middle, record);
+            return true;
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return false;
+}
+
+// Checks every offset once, so lookups can trust the index
+bool LayoutBundle::validate() {
+    if (load<uint32_t>(base) != MAGIC || load<uint16_t>(base + 4) != VERSION ||
+        load<uint32_t>(base + 12) != ENTRY_SIZE) {
+        return false;
+    }
+    uint64_t declared = load<uint64_t>(base + 40);
+    if (declared < HEADER_SIZE || declared > length) return false;
+    length = declared;
+
+    fingerprintId = load<uint16_t>(base + 6);
+    uint32_t entries = load<uint32_t>(base + 8);
+    uint64_t indexOffset = load<uint64_t>(base + 16);
+    uint64_t poolOffset = load<uint64_t>(base + 24);
+    uint64_t poolLength = load<uint64_t>(base + 32);
+    if (indexOffset > length || entries > (length - indexOffset) / ENTRY_SIZE ||
+        poolOffset > length || poolLength > length - poolOffset) {
+        return false;
+    }
+    index = base + indexOffset;
+    pool = reinterpret_cast<const char *>(base + poolOffset);
+    count = entries;
+
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t *entry = index + static_cast<size_t>(i) * ENTRY_SIZE;
+        uint64_t nameOffset = load<uint32_t>(entry);
+        uint64_t nameLength = load<uint32_t>(entry + 4);
+        uint64_t recordOffset = load<uint64_t>(entry + 8);
+        uint64_t recordLength = load<uint32_t>(entry + 16);
+        if (nameOffset + nameLength > poolLength || recordOffset > length ||
+            recordLength > length - recordOffset ||
+            load<uint32_t>(entry + 20) > MAX_HASH_LENGTH) {
+            return false;
+        }
+        // Binary search needs strictly ascending names
+        if (i > 0 && name(i - 1).compare(name(i)) >= 0) return false;
+    }
+    return true;
+}
+
+void LayoutBundle::entryAt(uint32_t position, Record &record) const {
+    const uint8_t *entry = index + static_cast<size_t>(position) * ENTRY_SIZE;
+    record.data = base + load<uint64_t>(entry + 8);
+    record.length = load<uint32_t>(entry + 16);
+    record.hash = entry + 24;
+    record.hashLength = load<uint32_t>(entry + 20);
+}
+
+bool LayoutBundleWriter::add(string name, vector<uint8_t> record, const uint8_t *hash,
+                             size_t hashLength) {
+    if (name.empty() || hashLength > LayoutBundle::MAX_HASH_LENGTH ||
+        record.size() > UINT32_MAX) {
+        return false;
+    }
+    for (const Layout &layout: layouts) {
+        if (layout.name == name) return false;
+    }
+    Layout layout{move(name), move(record), {}, hashLength};
+    memcpy(layout.hash, hash, hashLength);
+    layouts.push_back(move(layout));
+    return true;
+}
+
+void LayoutBundleWriter::write(vector<uint8_t> &out) const {
+    vector<const Layout *> sorted;
+    for (const Layout &layout: layouts) sorted.push_back(&layout);
+    sort(sorted.begin(), sorted.end(),
+         [](const Layout *a, const Layout *b) { return a->name < b->name; });
+
+    size_t indexOffset = LayoutBundle::HEADER_SIZE;
+    size_t poolOffset = indexOffset + sorted.size() * LayoutBundle::ENTRY_SIZE;
+    size_t poolLength = 0;
+    for (const Layout *layout: sorted) poolLength += layout->name.size();
+    size_t end = alignUp(poolOffset + poolLength, LayoutBundle::RECORD_ALIGNMENT);
+    vector<size_t> recordOffsets;
+    for (const Layout *layout: sorted) {
+        recordOffsets.push_back(end);
+        end = alignUp(end + layout->record.size(), LayoutBundle::RECORD_ALIGNMENT);
+    }
+
+    out.assign(end, 0);
+    uint8_t *header = out.data();
+    store<uint32_t>(header, LayoutBundle::MAGIC);
+    store<uint16_t>(header + 4, LayoutBundle::VERSION);
+    store<uint16_t>(header + 6, fingerprint);
+    store<uint32_t>(header + 8, static_cast<uint32_t>(sorted.size()));
+    store<uint32_t>(header + 12, static_cast<uint32_t>(LayoutBundle::ENTRY_SIZE));
+    store<uint64_t>(header + 16, indexOffset);
+    store<uint64_t>(header + 24, poolOffset);
+    store<uint64_t>(header + 32, poolLength);
+    store<uint64_t>(header + 40, end);
+
+    size_t nameOffset = 0;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        const Layout &layout = *sorted[i];
+        uint8_t *entry = out.data() + indexOffset + i * LayoutBundle::ENTRY_SIZE;
+        store<uint32_t>(entry, static_cast<uint32_t>(nameOffset));
+        store<uint32_t>(entry + 4, static_cast<uint32_t>(layout.name.size()));
+        store<uint64_t>(entry + 8, recordOffsets[i]);
+        store<uint32_t>(entry + 16, static_cast<uint32_t>(layout.record.size()));
+        store<uint32_t>(entry + 20, static_cast<uint32_t>(layout.hashLength));
+        memcpy(entry + 24, layout.hash, layout.hashLength);
+        memcpy(out.data() + poolOffset + nameOffset, layout.name.data(), layout.name.size());
+        nameOffset += layout.name.size();
+        memcpy(out.data() + recordOffsets[i], layout.record.data(), layout.record.size());
+    }
+}
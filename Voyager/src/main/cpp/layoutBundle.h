@@ -0,0 +1,120 @@
+/**
+ * Single-file bundle of precompiled layouts, for shipping a whole layout pack as one
+ * asset instead of loose XML files.
+ *
+ * Layout (little-endian, offsets from the start of the bundle):
+ * - header, 64 bytes: `[magic:u32 "VLB1"][version:u16][fingerprint:u16][count:u32]
+ *   [entrySize:u32][indexOffset:u64][poolOffset:u64][poolLength:u64][length:u64]`, then
+ *   zeros. `fingerprint` is the ContentFingerprint id of the record hashes
+ * - index: `count` entries sorted bytewise by name, each `[nameOffset:u32][nameLength:u32]
+ *   [recordOffset:u64][recordLength:u32][hashLength:u32][hash:32 bytes]`
+ * - string pool: the names, referenced by the index
+ * - records, each starting on a 64-byte boundary: the layout's flat tree (see
+ *   FlatTreeBuilder), readable in place as FlatViewTree reads any other tree
+ *
+ * A bundle is opened with one mmap and checked once: header, index and record bounds.
+ * Lookups by name are then a binary search over the mapping, with no allocation and no
+ * I/O beyond the page faults of the pages they touch.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class LayoutBundle {
+public:
+    static constexpr uint32_t MAGIC = 0x31424c56;  // "VLB1"
+    static constexpr uint16_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 64;
+    static constexpr size_t ENTRY_SIZE = 56;
+    static constexpr size_t RECORD_ALIGNMENT = 64;
+    static constexpr size_t MAX_HASH_LENGTH = 32;
+
+    struct Record {
+        const uint8_t *data;
+        size_t length;
+        const uint8_t *hash;
+        size_t hashLength;
+    };
+
+    LayoutBundle() = default;
+
+    ~LayoutBundle();
+
+    LayoutBundle(const LayoutBundle &) = delete;
+
+    LayoutBundle &operator=(const LayoutBundle &) = delete;
+
+    /**
+     * Maps `length` bytes at `offset` of `fd` (to the end of the file if negative), e.g. an
+     * uncompressed asset inside an APK, and validates the bundle. The descriptor may be
+     * closed afterwards. Reopening replaces the current mapping.
+     */
+    bool open(int fd, int64_t offset, int64_t length);
+
+    bool open(const char *path);
+
+    // Unmaps the bundle; records found earlier are invalid afterwards
+    void close();
+
+    uint32_t size() const {
+        return count;
+    }
+
+    uint16_t fingerprint() const {
+        return fingerprintId;
+    }
+
+    // Name of the `index`th layout, in sorted order
+    std::string_view name(uint32_t index) const;
+
+    // Finds the layout called `name`; `record` points into the mapping until close()
+    bool find(std::string_view name, Record &record) const;
+
+private:
+    void *mapping = nullptr;
+    size_t mappedLength = 0;
+    const uint8_t *base = nullptr;
+    uint64_t length = 0;
+    uint32_t count = 0;
+    uint16_t fingerprintId = 0;
+    const uint8_t *index = nullptr;
+    const char *pool = nullptr;
+
+    bool validate();
+
+    void entryAt(uint32_t index, Record &record) const;
+};
+
+/**
+ * Assembles a bundle in memory (see LayoutBundle for the format), e.g. in the host
+ * build tool. Records may be added in any order.
+ */
+class LayoutBundleWriter {
+public:
+    explicit LayoutBundleWriter(uint16_t fingerprint) : fingerprint(fingerprint) {}
+
+    // Returns false if the name is taken or empty, or the hash too long
+    bool add(std::string name, std::vector<uint8_t> record, const uint8_t *hash,
+             size_t hashLength);
+
+    // Serializes every added layout into `out`, replacing its contents
+    void write(std::vector<uint8_t> &out) const;
+
+private:
+    struct Layout {
+        std::string name;
+        std::vector<uint8_t> record;
+        uint8_t hash[LayoutBundle::MAX_HASH_LENGTH];
+        size_t hashLength;
+    };
+
+    uint16_t fingerprint;
+    std::vector<Layout> layouts;
+};
@@ -0,0 +1,189 @@
+/**
+ * ParsePool worker loop, priority-ordered work stealing, boosting and cancellation.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "parsePool.h"
+
+#include <chrono>
+
+namespace {
+    uint64_t nowNanos() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+ParsePool::ParsePool(size_t threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; i++) workers.emplace_back(new Worker());
+    for (size_t i = 0; i < threads; i++) {
+        workers[i]->thread = std::thread([this, i] { run(i); });
+    }
+}
+
+ParsePool::~ParsePool() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping.store(true, std::memory_order_release);
+    }
+    wake.notify_all();
+    for (auto &worker: workers) worker->thread.join();
+
+    // Whoever waits for a job that never ran still hears back through onCancel. Stale
+    // entries of boosted jobs fail to claim and are skipped
+    for (auto &worker: workers) {
+        for (auto &queue: worker->queues) {
+            for (const JobHandle &job: queue) cancel(job);
+            queue.clear();
+        }
+    }
+}
+
+JobHandle ParsePool::submit(Task run, ParsePriority priority, Task onCancel) {
+    auto job = std::make_shared<ParseJob>(std::move(run), std::move(onCancel), priority);
+    job->queuedAtNanos = nowNanos();
+    enqueue(nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size(), job, priority);
+    signal();
+    return job;
+}
+
+std::vector<JobHandle> ParsePool::submit(std::vector<Task> tasks, ParsePriority priority,
+                                         const std::function<Task(size_t)> &onCancel) {
+    std::vector<JobHandle> jobs;
+    if (tasks.empty()) return jobs;
+    jobs.reserve(tasks.size());
+    uint64_t now = nowNanos();
+    size_t start = nextWorker.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < tasks.size(); i++) {
+        auto job = std::make_shared<ParseJob>(std::move(tasks[i]),
+                                              onCancel ? onCancel(i) : nullptr, priority);
+        job->queuedAtNanos = now;
+        enqueue((start + i) % workers.size(), job, priority);
+        jobs.push_back(std::move(job));
+    }
+    signal();
+    return jobs;
+}
+
+bool ParsePool::boost(const JobHandle &job, ParsePriority priority) {
+    int target = static_cast<int>(priority);
+    int current = job->priority.load(std::memory_order_relaxed);
+    do {
+        if (current <= target) return false;
+    } while (!job->priority.compare_exchange_weak(current, target, std::memory_order_relaxed));
+    if (job->state.load(std::memory_order_acquire) != ParseJob::QUEUED) return false;
+
+    // The old entry stays behind and is skipped once this one claims the job
+    enqueue(nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size(), job, priority);
+    signal();
+    return true;
+}
+
+bool ParsePool::cancel(const JobHandle &job) {
+    if (!job->claim(ParseJob::CANCELLED)) return false;
+    Task onCancel = std::move(job->onCancel);
+    job->run = nullptr;
+    if (onCancel) onCancel();
+    return true;
+}
+
+size_t ParsePool::cancelQueued(ParsePriority priority) {
+    std::vector<JobHandle> victims;
+    auto index = static_cast<size_t>(priority);
+    for (auto &worker: workers) {
+        std::lock_guard<std::mutex> guard(worker->lock);
+        for (const JobHandle &job: worker->queues[index]) {
+            if (job->currentPriority() == priority) victims.push_back(job);
+        }
+    }
+    // Cancelled outside the worker locks, since onCancel may do real work
+    size_t cancelled = 0;
+    for (const JobHandle &job: victims) {
+        if (cancel(job)) cancelled++;
+    }
+    return cancelled;
+}
+
+void ParsePool::resetHistograms() {
+    for (size_t i = 0; i < PRIORITY_COUNT; i++) {
+        waitHistograms[i].reset();
+        runHistograms[i].reset();
+    }
+}
+
+ParsePool &ParsePool::shared() {
+    static ParsePool pool;
+    return pool;
+}
+
+void ParsePool::enqueue(size_t worker, JobHandle job, ParsePriority priority) {
+    Worker &target = *workers[worker];
+    std::lock_guard<std::mutex> guard(target.lock);
+    target.queues[static_cast<size_t>(priority)].push_back(std::move(job));
+    pending.fetch_add(1, std::memory_order_release);
+}
+
+void ParsePool::signal() {
+    {
+        // Taken after the entries were counted, so a worker about to wait can't miss them
+        std::lock_guard<std::mutex> guard(sleepLock);
+    }
+    wake.notify_all();
+}
+
+bool ParsePool::take(size_t self, JobHandle &job) {
+    for (size_t priority = 0; priority < PRIORITY_COUNT; priority++) {
+        {
+            Worker &own = *workers[self];
+            std::lock_guard<std::mutex> guard(own.lock);
+            std::deque<JobHandle> &queue = own.queues[priority];
+            if (!queue.empty()) {
+                job = std::move(queue.back());
+                queue.pop_back();
+                pending.fetch_sub(1, std::memory_order_acq_rel);
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset < workers.size(); offset++) {
+            Worker &victim = *workers[(self + offset) % workers.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            std::deque<JobHandle> &queue = victim.queues[priority];
+            if (!queue.empty()) {
+                job = std::move(queue.front());
+                queue.pop_front();
+                pending.fetch_sub(1, std::memory_order_acq_rel);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ParsePool::run(size_t self) {
+    JobHandle job;
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (take(self, job)) {
+            // A boosted job has two entries; cancelled ones have already been answered
+            if (job->claim(ParseJob::RUNNING)) {
+                auto priority = static_cast<size_t>(job->currentPriority());
+                uint64_t start = nowNanos();
+                waitHistograms[priority].record((start - job->queuedAtNanos) / 1000);
+                Task task = std::move(job->run);
+                job->onCancel = nullptr;
+                task();
+                runHistograms[priority].record((nowNanos() - start) / 1000);
+            }
+            job.reset();
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wake.wait(guard, [this] {
+            return stopping.load(std::memory_order_acquire) ||
+                   pending.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
@@ -0,0 +1,219 @@
+/**
+ * Priority-aware work-stealing thread pool for parsing.
+ *
+ * Jobs belong to one of three classes: Immediate (the screen being shown), VisibleSoon
+ * (the next likely screen) and Prefetch (everything else). Each worker owns a deque per
+ * class: it takes its own jobs from the back and, once that runs dry, steals from the
+ * front of the others, always draining a higher class everywhere before looking at a
+ * lower one. A worker stuck on one large layout does not hold up the ones queued behind
+ * it, and a prefetch never starts while an immediate job is waiting.
+ *
+ * A queued job can be boosted to a more urgent class or cancelled. Boosting queues a
+ * second entry for the same job; whichever entry a worker reaches first claims it and the
+ * other is skipped. Queue-wait and run time are recorded per class.
+ *
+ * Workers are plain native threads with no JNIEnv; jobs that need one attach themselves.
+ * Per-thread state, such as pooled parser sessions, stays with its worker for the pool's
+ * lifetime.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Scheduling classes, most urgent first; mirrored by `ParsePriority` on the Kotlin side
+enum class ParsePriority : int {
+    Immediate = 0,
+    VisibleSoon = 1,
+    Prefetch = 2,
+};
+
+constexpr size_t PRIORITY_COUNT = 3;
+
+/**
+ * Power-of-two latency histogram: bucket 0 counts samples under 1 µs, bucket i samples in
+ * [2^(i-1), 2^i) µs, and the last bucket everything above.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKETS = 24;
+
+    void record(uint64_t micros) {
+        size_t bucket = 0;
+        while (micros > 0 && bucket < BUCKETS - 1) {
+            micros >>= 1;
+            bucket++;
+        }
+        counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t count(size_t bucket) const {
+        return counts[bucket].load(std::memory_order_relaxed);
+    }
+
+    void reset() {
+        for (auto &count: counts) count.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> counts[BUCKETS] = {};
+};
+
+/**
+ * A queued unit of work. `run` executes on a worker; `onCancel`, if set, runs instead on
+ * the thread that cancelled the job, so whoever waits for the job always hears back.
+ */
+class ParseJob {
+public:
+    using Task = std::function<void()>;
+
+    ParseJob(Task run, Task onCancel, ParsePriority priority)
+            : run(std::move(run)), onCancel(std::move(onCancel)),
+              priority(static_cast<int>(priority)) {}
+
+    ParsePriority currentPriority() const {
+        return static_cast<ParsePriority>(priority.load(std::memory_order_relaxed));
+    }
+
+    // Whether a worker has started (or finished) the job
+    bool started() const {
+        return state.load(std::memory_order_acquire) == RUNNING;
+    }
+
+private:
+    friend class ParsePool;
+
+    static constexpr int QUEUED = 0;
+    static constexpr int RUNNING = 1;
+    static constexpr int CANCELLED = 2;
+
+    Task run;
+    Task onCancel;
+    std::atomic<int> state{QUEUED};
+    std::atomic<int> priority;
+    uint64_t queuedAtNanos = 0;
+
+    // Moves the job out of the queued state; only one caller ever wins
+    bool claim(int target) {
+        int expected = QUEUED;
+        return state.compare_exchange_strong(expected, target, std::memory_order_acq_rel);
+    }
+};
+
+using JobHandle = std::shared_ptr<ParseJob>;
+
+class ParsePool {
+public:
+    using Task = ParseJob::Task;
+
+    // Starts `threads` workers; 0 means one per hardware core
+    explicit ParsePool(size_t threads = 0);
+
+    // Stops the workers once their current job is done and cancels every job still queued
+    ~ParsePool();
+
+    ParsePool(const ParsePool &) = delete;
+
+    ParsePool &operator=(const ParsePool &) = delete;
+
+    // Queues one job and returns immediately
+    JobHandle submit(Task run, ParsePriority priority, Task onCancel = nullptr);
+
+    // Queues a group of jobs of one class, spread evenly over the workers
+    std::vector<JobHandle> submit(std::vector<Task> tasks, ParsePriority priority,
+                                  const std::function<Task(size_t)> &onCancel = nullptr);
+
+    /**
+     * Moves a still-queued job to a more urgent class. Returns false if it already started,
+     * was cancelled, or is already at least that urgent.
+     */
+    bool boost(const JobHandle &job, ParsePriority priority);
+
+    // Cancels a job that has not started yet and runs its onCancel; false if too late
+    bool cancel(const JobHandle &job);
+
+    // Cancels every job still queued in `priority`, e.g. prefetches after navigation
+    size_t cancelQueued(ParsePriority priority);
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    const LatencyHistogram &queueWait(ParsePriority priority) const {
+        return waitHistograms[static_cast<size_t>(priority)];
+    }
+
+    const LatencyHistogram &runTime(ParsePriority priority) const {
+        return runHistograms[static_cast<size_t>(priority)];
+    }
+
+    void resetHistograms();
+
+    // Process-wide pool sized to the number of cores, started on first use
+    static ParsePool &shared();
+
+private:
+    struct Worker {
+        std::mutex lock;
+        std::deque<JobHandle> queues[PRIORITY_COUNT];
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    // Queued entries, including the stale ones boosting leaves behind. Counted under the
+    // worker lock of the queue the entry is in, so it never runs below zero
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> nextWorker{0};
+    std::atomic<bool> stopping{false};
+    LatencyHistogram waitHistograms[PRIORITY_COUNT];
+    LatencyHistogram runHistograms[PRIORITY_COUNT];
+
+    void enqueue(size_t worker, JobHandle job, ParsePriority priority);
+
+    void signal();
+
+    void run(size_t self);
+
+    bool take(size_t self, JobHandle &job);
+};
+
+/**
+ * Collects the indices of finished tasks so one thread can consume results in completion
+ * order while workers are still producing them.
+ */
+class CompletionQueue {
+public:
+    void push(size_t index) {
+        // Notified under the lock: the consumer may destroy the queue as soon as it pops
+        std::lock_guard<std::mutex> guard(lock);
+        done.push_back(index);
+        ready.notify_one();
+    }
+
+    // Blocks until a task has finished and returns its index
+    size_t pop() {
+        std::unique_lock<std::mutex> guard(lock);
+        ready.wait(guard, [this] { return !done.empty(); });
+        size_t index = done.front();
+        done.pop_front();
+        return index;
+    }
+
+private:
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<size_t> done;
+};
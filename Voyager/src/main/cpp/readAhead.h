@@ -0,0 +1,123 @@
+/**
+ * Building blocks for reading a stream ahead of the parser.
+ *
+ * ChunkRing is a small ring of chunk buffers handed between one reader thread and one
+ * parser thread: the reader fills the next free slot while the parser drains the oldest
+ * filled one, so a blocking read and a parse of the previous chunk overlap. ChunkSizer
+ * picks how much to ask for in each read, growing while the stream keeps filling whole
+ * chunks and shrinking back when it delivers less.
+ *
+ * Neither touches JNI; the reader decides where the bytes come from.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+ * Adapts the read size to the stream. A read that fills the whole request suggests more
+ * is waiting, so the next one asks for twice as much; one that returns under half only
+ * asks for what the stream actually delivers (rounded up to a power of two).
+ */
+class ChunkSizer {
+public:
+    ChunkSizer(size_t minimum, size_t maximum) : minimum(minimum), maximum(maximum), size(minimum) {}
+
+    size_t next() const {
+        return size;
+    }
+
+    void observe(size_t requested, size_t received) {
+        if (received >= requested) {
+            size = size * 2 <= maximum ? size * 2 : maximum;
+        } else if (received < requested / 2) {
+            size_t fitted = minimum;
+            while (fitted < received && fitted < maximum) fitted *= 2;
+            size = fitted;
+        }
+    }
+
+private:
+    size_t minimum;
+    size_t maximum;
+    size_t size;
+};
+
+class ChunkRing {
+public:
+    struct Slot {
+        std::vector<char> data;
+        size_t length = 0;
+        // The stream ended (or failed) with this chunk; nothing follows it
+        bool last = false;
+        bool failed = false;
+    };
+
+    explicit ChunkRing(size_t slotCount = 3) : slots(slotCount) {}
+
+    ChunkRing(const ChunkRing &) = delete;
+
+    ChunkRing &operator=(const ChunkRing &) = delete;
+
+    // Reader: waits for a slot to fill; nullptr once the parser has cancelled
+    Slot *acquireFree() {
+        std::unique_lock<std::mutex> guard(lock);
+        changed.wait(guard, [this] { return cancelled || inUse < slots.size(); });
+        if (cancelled) return nullptr;
+        Slot &slot = slots[writeIndex];
+        slot.length = 0;
+        slot.last = false;
+        slot.failed = false;
+        return &slot;
+    }
+
+    // Reader: hands the slot from acquireFree() to the parser
+    void publish() {
+        std::lock_guard<std::mutex> guard(lock);
+        writeIndex = (writeIndex + 1) % slots.size();
+        inUse++;
+        filled++;
+        changed.notify_all();
+    }
+
+    // Parser: waits for the oldest filled slot; nullptr once cancelled
+    Slot *acquireFilled() {
+        std::unique_lock<std::mutex> guard(lock);
+        changed.wait(guard, [this] { return cancelled || filled > 0; });
+        if (cancelled) return nullptr;
+        filled--;
+        return &slots[readIndex];
+    }
+
+    // Parser: returns the slot from acquireFilled() for reuse
+    void release() {
+        std::lock_guard<std::mutex> guard(lock);
+        readIndex = (readIndex + 1) % slots.size();
+        inUse--;
+        changed.notify_all();
+    }
+
+    // Either side: stops the other; used when the parser gives up early
+    void cancel() {
+        std::lock_guard<std::mutex> guard(lock);
+        cancelled = true;
+        changed.notify_all();
+    }
+
+private:
+    std::vector<Slot> slots;
+    std::mutex lock;
+    std::condition_variable changed;
+    size_t writeIndex = 0;
+    size_t readIndex = 0;
+    // Slots published and not yet released, including the one the parser holds
+    size_t inUse = 0;
+    // Slots published and not yet taken by the parser
+    size_t filled = 0;
+    bool cancelled = false;
+};
@@ -0,0 +1,300 @@
+/**
+ * SHA256 block compression backends and runtime CPU dispatch.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "sha256.h"
+
+#include <cstring>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#define SHA256_HAS_ARM_CRYPTO 1
+#ifndef HWCAP_SHA2
+#define HWCAP_SHA2 (1 << 6)
+#endif
+#endif
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA256_HAS_SHA_NI 1
+#ifndef bit_SHA
+#define bit_SHA (1 << 29)
+#endif
+#endif
+
+namespace {
+    alignas(16) const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+            0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+            0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+            0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+            0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+            0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+            0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+            0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+            0xc67178f2};
+
+    const uint32_t INITIAL_STATE[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                       0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+    inline uint32_t rotr(uint32_t x, uint32_t n) {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    inline uint32_t loadBigEndian(const uint8_t *p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) |
+               uint32_t(p[3]);
+    }
+
+    void compressPortable(uint32_t *state, const uint8_t *blocks, size_t count) {
+        uint32_t m[64];
+        for (; count > 0; count--, blocks += SHA256::BLOCK_SIZE) {
+            for (int i = 0; i < 16; i++) m[i] = loadBigEndian(blocks + 4 * i);
+            for (int i = 16; i < 64; i++) {
+                uint32_t s0 = rotr(m[i - 15], 7) ^ rotr(m[i - 15], 18) ^ (m[i - 15] >> 3);
+                uint32_t s1 = rotr(m[i - 2], 17) ^ rotr(m[i - 2], 19) ^ (m[i - 2] >> 10);
+                m[i] = s1 + m[i - 7] + s0 + m[i - 16];
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int i = 0; i < 64; i++) {
+                uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) +
+                              K[i] + m[i];
+                uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & (b | c)) | (b & c));
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        }
+    }
+
+#ifdef SHA256_HAS_ARM_CRYPTO
+#if defined(__clang__)
+#define SHA256_ARM_TARGET __attribute__((target("sha2")))
+#else
+#define SHA256_ARM_TARGET __attribute__((target("+crypto")))
+#endif
+
+    bool cpuHasArmCrypto() {
+        return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+    }
+
+    // ARMv8 Crypto Extensions: four rounds per SHA256H/SHA256H2 pair
+    SHA256_ARM_TARGET
+    void compressArmCrypto(uint32_t *state, const uint8_t *blocks, size_t count) {
+        uint32x4_t abcd = vld1q_u32(state);
+        uint32x4_t efgh = vld1q_u32(state + 4);
+
+        for (; count > 0; count--, blocks += SHA256::BLOCK_SIZE) {
+            uint32x4_t abcdSaved = abcd;
+            uint32x4_t efghSaved = efgh;
+            uint32x4_t msg[4];
+            for (int i = 0; i < 4; i++) {
+                msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(blocks + 16 * i)));
+            }
+
+            for (int group = 0; group < 16; group++) {
+                if (group >= 4) {
+                    msg[group & 3] = vsha256su1q_u32(
+                            vsha256su0q_u32(msg[group & 3], msg[(group + 1) & 3]),
+                            msg[(group + 2) & 3], msg[(group + 3) & 3]);
+                }
+                uint32x4_t wk = vaddq_u32(msg[group & 3], vld1q_u32(K + 4 * group));
+                uint32x4_t previous = abcd;
+                abcd = vsha256hq_u32(abcd, efgh, wk);
+                efgh = vsha256h2q_u32(efgh, previous, wk);
+            }
+
+            abcd = vaddq_u32(abcd, abcdSaved);
+            efgh = vaddq_u32(efgh, efghSaved);
+        }
+
+        vst1q_u32(state, abcd);
+        vst1q_u32(state + 4, efgh);
+    }
+#endif
+
+#ifdef SHA256_HAS_SHA_NI
+    bool cpuHasShaNi() {
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+        bool sse = (ecx & bit_SSSE3) && (ecx & bit_SSE4_1);
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+        return sse && (ebx & bit_SHA);
+    }
+
+    // x86 SHA extensions: the state is kept as ABEF/CDGH, two rounds per SHA256RNDS2
+    __attribute__((target("sha,sse4.1,ssse3")))
+    void compressShaNi(uint32_t *state, const uint8_t *blocks, size_t count) {
+        const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+        __m128i dcba = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state));
+        __m128i hgfe = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state + 4));
+        __m128i cdab = _mm_shuffle_epi32(dcba, 0xB1);
+        __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1B);
+        __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+        __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+        for (; count > 0; count--, blocks += SHA256::BLOCK_SIZE) {
+            __m128i abefSaved = abef;
+            __m128i cdghSaved = cdgh;
+            __m128i msg[4];
+            for (int i = 0; i < 4; i++) {
+                msg[i] = _mm_shuffle_epi8(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + 16 * i)),
+                        byteSwap);
+            }
+
+            for (int group = 0; group < 16; group++) {
+                if (group >= 4) {
+                    __m128i partial = _mm_sha256msg1_epu32(msg[group & 3], msg[(group + 1) & 3]);
+                    partial = _mm_add_epi32(partial, _mm_alignr_epi8(msg[(group + 3) & 3],
+                                                                     msg[(group + 2) & 3], 4));
+                    msg[group & 3] = _mm_sha256msg2_epu32(partial, msg[(group + 3) & 3]);
+                }
+                __m128i wk = _mm_add_epi32(
+                        msg[group & 3], _mm_load_si128(reinterpret_cast<const __m128i *>(K + 4 * group)));
+                cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+                abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0E));
+            }
+
+            abef = _mm_add_epi32(abef, abefSaved);
+            cdgh = _mm_add_epi32(cdgh, cdghSaved);
+        }
+
+        __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+        __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_blend_epi16(feba, dchg, 0xF0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+    }
+#endif
+}
+
+SHA256::SHA256() : SHA256(bestBackend()) {}
+
+SHA256::SHA256(Backend backend) : selected(backend), compress(compressPortable) {
+#ifdef SHA256_HAS_ARM_CRYPTO
+    if (backend == Backend::ArmCrypto) compress = compressArmCrypto;
+#endif
+#ifdef SHA256_HAS_SHA_NI
+    if (backend == Backend::ShaNi) compress = compressShaNi;
+#endif
+    reset();
+}
+
+void SHA256::reset() {
+    memcpy(state, INITIAL_STATE, sizeof(state));
+    buffered = 0;
+    totalBytes = 0;
+}
+
+void SHA256::update(const uint8_t *data, size_t length) {
+    totalBytes += length;
+
+    // Top up a partial block left over from the previous call
+    if (buffered > 0) {
+        size_t take = BLOCK_SIZE - buffered < length ? BLOCK_SIZE - buffered : length;
+        memcpy(buffer + buffered, data, take);
+        buffered += take;
+        data += take;
+        length -= take;
+        if (buffered < BLOCK_SIZE) return;
+        compress(state, buffer, 1);
+        buffered = 0;
+    }
+
+    // Whole blocks are compressed in place
+    size_t blocks = length / BLOCK_SIZE;
+    if (blocks > 0) {
+        compress(state, data, blocks);
+        data += blocks * BLOCK_SIZE;
+        length -= blocks * BLOCK_SIZE;
+    }
+
+    if (length > 0) {
+        memcpy(buffer, data, length);
+        buffered = length;
+    }
+}
+
+void SHA256::final(uint8_t *hash) {
+    uint64_t bitLength = totalBytes * 8;
+    buffer[buffered++] = 0x80;
+    if (buffered > BLOCK_SIZE - 8) {
+        memset(buffer + buffered, 0, BLOCK_SIZE - buffered);
+        compress(state, buffer, 1);
+        buffered = 0;
+    }
+    memset(buffer + buffered, 0, BLOCK_SIZE - 8 - buffered);
+    for (int i = 0; i < 8; i++) {
+        buffer[BLOCK_SIZE - 1 - i] = static_cast<uint8_t>(bitLength >> (8 * i));
+    }
+    compress(state, buffer, 1);
+
+    for (int i = 0; i < 8; i++) {
+        hash[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+        hash[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+        hash[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+        hash[4 * i + 3] = static_cast<uint8_t>(state[i]);
+    }
+}
+
+SHA256::Backend SHA256::bestBackend() {
+    static const Backend best = isSupported(Backend::ArmCrypto) ? Backend::ArmCrypto :
+                                isSupported(Backend::ShaNi) ? Backend::ShaNi : Backend::Portable;
+    return best;
+}
+
+bool SHA256::isSupported(Backend backend) {
+    switch (backend) {
+        case Backend::Portable:
+            return true;
+        case Backend::ArmCrypto:
+#ifdef SHA256_HAS_ARM_CRYPTO
+            return cpuHasArmCrypto();
+#else
+            return false;
+#endif
+        case Backend::ShaNi:
+#ifdef SHA256_HAS_SHA_NI
+            return cpuHasShaNi();
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+const char *SHA256::backendName(Backend backend) {
+    switch (backend) {
+        case Backend::Portable:
+            return "portable";
+        case Backend::ArmCrypto:
+            return "armv8-crypto";
+        case Backend::ShaNi:
+            return "sha-ni";
+    }
+    return "unknown";
+}
@@ -0,0 +1,60 @@
+/**
+ * Streaming SHA256 used to fingerprint parsed layouts.
+ *
+ * Input is consumed in whole 64-byte blocks straight from the caller's buffer; only a
+ * trailing partial block is copied. The block compression function is picked once per
+ * process from the fastest one the CPU supports (ARMv8 Crypto Extensions, x86 SHA-NI, or
+ * the portable C++ version), and all of them produce identical digests.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class SHA256 {
+public:
+    static constexpr size_t DIGEST_LENGTH = 32;
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    enum class Backend {
+        Portable,
+        ArmCrypto,
+        ShaNi,
+    };
+
+    // Uses the best backend for this CPU
+    SHA256();
+
+    // Uses the given backend, which must be supported (see isSupported)
+    explicit SHA256(Backend backend);
+
+    void reset();
+
+    void update(const uint8_t *data, size_t length);
+
+    // Writes the digest into `hash` (DIGEST_LENGTH bytes); call reset() before reusing
+    void final(uint8_t *hash);
+
+    Backend backend() const {
+        return selected;
+    }
+
+    static Backend bestBackend();
+
+    static bool isSupported(Backend backend);
+
+    static const char *backendName(Backend backend);
+
+private:
+    using CompressFn = void (*)(uint32_t *state, const uint8_t *blocks, size_t count);
+
+    uint32_t state[8];
+    uint8_t buffer[BLOCK_SIZE];
+    size_t buffered;
+    uint64_t totalBytes;
+    Backend selected;
+    CompressFn compress;
+};
@@ -0,0 +1,237 @@
+/**
+ * Size-class heap on top of an Arena, used as Expat's memory suite.
+ *
+ * Expat frees and reallocates individually, which a bump arena can't honour, so small
+ * requests are rounded up to a power-of-two class and freed blocks go on a per-class free
+ * list instead of back to malloc. The parser reuses those blocks on its next document, so
+ * a pooled parser stops touching malloc after its first few parses. Requests above
+ * MAX_CLASS_SIZE go straight to malloc. `release()` drops everything in one shot once the
+ * parser that owned the memory is gone.
+ *
+ * Every block carries a header naming its heap, so free and realloc work without
+ * context. Expat's malloc hook has none either; it allocates from the heap made current
+ * on this thread by a `SlabHeap::Scope`.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#pragma once
+
+#include "arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+class SlabHeap {
+public:
+    static constexpr size_t MIN_CLASS_SIZE = 16;
+    static constexpr size_t MAX_CLASS_SIZE = 64 * 1024;
+
+    explicit SlabHeap(size_t blockSize = 32 * 1024, size_t maxRetained = 512 * 1024)
+            : arena(blockSize, maxRetained) {}
+
+    ~SlabHeap() {
+        release();
+    }
+
+    SlabHeap(const SlabHeap &) = delete;
+
+    SlabHeap &operator=(const SlabHeap &) = delete;
+
+    void *allocate(size_t size) {
+        allocations++;
+        size_t sizeClass = classOf(size);
+        Header *header;
+        if (sizeClass == LARGE) {
+            header = static_cast<Header *>(std::malloc(sizeof(Header) + size));
+            if (!header) return nullptr;
+            largeMallocs++;
+            largeBytes += size;
+        } else if (freeLists[sizeClass]) {
+            header = freeLists[sizeClass];
+            freeLists[sizeClass] = header->nextFree;
+        } else {
+            header = static_cast<Header *>(
+                    arena.allocate(sizeof(Header) + classSize(sizeClass), alignof(Header)));
+        }
+        header->owner = this;
+        header->size = sizeClass == LARGE ? size : classSize(sizeClass);
+        live += header->size;
+        if (live > peak) peak = live;
+        return header + 1;
+    }
+
+    void *reallocate(void *pointer, size_t size) {
+        if (!pointer) return allocate(size);
+        Header *header = headerOf(pointer);
+        size_t sizeClass = classOf(header->size);
+        if (sizeClass != LARGE && size <= classSize(sizeClass)) {
+            // The block keeps its class, so it is freed back to the list it came from
+            allocations++;
+            return pointer;
+        }
+        void *grown = allocate(size);
+        if (!grown) return nullptr;
+        std::memcpy(grown, pointer, header->size < size ? header->size : size);
+        deallocate(pointer);
+        return grown;
+    }
+
+    void deallocate(void *pointer) {
+        if (!pointer) return;
+        Header *header = headerOf(pointer);
+        size_t sizeClass = classOf(header->size);
+        if (sizeClass == LARGE) {
+            live -= header->size;
+            largeBytes -= header->size;
+            std::free(header);
+            return;
+        }
+        live -= classSize(sizeClass);
+        header->nextFree = freeLists[sizeClass];
+        freeLists[sizeClass] = header;
+    }
+
+    /**
+     * Forgets every small block at once. Only valid once nothing allocated from this heap
+     * is in use any more, i.e. after the owning parser was freed.
+     */
+    void release() {
+        std::memset(freeLists, 0, sizeof(freeLists));
+        arena.reset();
+        live = 0;
+    }
+
+    // Starts a new measurement window for peakBytes()
+    void resetPeak() {
+        peak = live;
+    }
+
+    // Allocation and reallocation calls served since construction
+    size_t allocationCount() const {
+        return allocations;
+    }
+
+    // Blocks obtained from malloc since construction, by the arena or for large requests
+    size_t systemAllocations() const {
+        return arena.systemAllocations() + largeMallocs;
+    }
+
+    // Highest live byte count since the last resetPeak()
+    size_t peakBytes() const {
+        return peak;
+    }
+
+    // Bytes held from the system, whether live or parked on a free list
+    size_t bytesReserved() const {
+        return arena.bytesReserved() + largeBytes;
+    }
+
+    // Plain functions for XML_Memory_Handling_Suite, served by the current heap. An
+    // exception must not unwind through Expat's C frames, so a failed arena block is
+    // reported as a null allocation instead
+    static void *suiteMalloc(size_t size) {
+        if (current) {
+            try {
+                return current->allocate(size);
+            } catch (const std::bad_alloc &) {
+                return nullptr;
+            }
+        }
+        auto *header = static_cast<Header *>(std::malloc(sizeof(Header) + size));
+        if (!header) return nullptr;
+        header->owner = nullptr;
+        header->size = size;
+        return header + 1;
+    }
+
+    static void *suiteRealloc(void *pointer, size_t size) {
+        if (!pointer) return suiteMalloc(size);
+        Header *header = headerOf(pointer);
+        if (header->owner) {
+            try {
+                return header->owner->reallocate(pointer, size);
+            } catch (const std::bad_alloc &) {
+                return nullptr;
+            }
+        }
+        auto *grown = static_cast<Header *>(std::realloc(header, sizeof(Header) + size));
+        if (!grown) return nullptr;
+        grown->size = size;
+        return grown + 1;
+    }
+
+    static void suiteFree(void *pointer) {
+        if (!pointer) return;
+        Header *header = headerOf(pointer);
+        if (header->owner) header->owner->deallocate(pointer);
+        else std::free(header);
+    }
+
+    /**
+     * Makes `heap` the one suiteMalloc allocates from for the lifetime of the scope.
+     * Scopes nest, so a parse started from inside an Expat callback restores the outer
+     * heap when it ends.
+     */
+    class Scope {
+    public:
+        explicit Scope(SlabHeap &heap) : previous(current) {
+            current = &heap;
+        }
+
+        ~Scope() {
+            current = previous;
+        }
+
+        Scope(const Scope &) = delete;
+
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        SlabHeap *previous;
+    };
+
+private:
+    static constexpr size_t CLASS_COUNT = 13;  // 16 B .. 64 KB
+    static constexpr size_t LARGE = CLASS_COUNT;
+
+    struct alignas(alignof(std::max_align_t)) Header {
+        SlabHeap *owner;
+        // Usable size while allocated: the class size, or the requested size of a large
+        // block. Free blocks reuse the slot for the list link
+        union {
+            size_t size;
+            Header *nextFree;
+        };
+    };
+
+    static thread_local SlabHeap *current;
+
+    Arena arena;
+    Header *freeLists[CLASS_COUNT] = {};
+    size_t allocations = 0;
+    size_t largeMallocs = 0;
+    size_t largeBytes = 0;
+    size_t live = 0;
+    size_t peak = 0;
+
+    static Header *headerOf(void *pointer) {
+        return static_cast<Header *>(pointer) - 1;
+    }
+
+    static size_t classOf(size_t size) {
+        if (size > MAX_CLASS_SIZE) return LARGE;
+        size_t sizeClass = 0;
+        while (classSize(sizeClass) < size) sizeClass++;
+        return sizeClass;
+    }
+
+    static size_t classSize(size_t sizeClass) {
+        return MIN_CLASS_SIZE << sizeClass;
+    }
+};
+
+inline thread_local SlabHeap *SlabHeap::current = nullptr;
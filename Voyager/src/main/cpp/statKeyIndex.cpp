@@ -0,0 +1,156 @@
+/**
+ * Persistent stat-tuple to fingerprint index, see statKeyIndex.h.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "statKeyIndex.h"
+
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+FileIdentity FileIdentity::of(const struct stat &info) {
+    return {static_cast<uint64_t>(info.st_dev), static_cast<uint64_t>(info.st_ino),
+            static_cast<uint64_t>(info.st_size),
+            static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec};
+}
+
+StatKeyIndex::~StatKeyIndex() {
+    unmap();
+}
+
+bool StatKeyIndex::open(const char *path) {
+    lock_guard<mutex> guard(lock);
+    unmap();
+
+    int fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+
+    size_t length = sizeof(Header) + sizeof(Entry) * CAPACITY;
+    struct stat info{};
+    bool fresh = fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) != length;
+    if (fresh && ftruncate(fd, static_cast<off_t>(length)) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void *address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // The mapping keeps the file referenced
+    ::close(fd);
+    if (address == MAP_FAILED) return false;
+
+    auto *header = static_cast<Header *>(address);
+    if (fresh || header->magic != MAGIC || header->version != VERSION ||
+        header->capacity != CAPACITY) {
+        memset(address, 0, length);
+        header->magic = MAGIC;
+        header->version = VERSION;
+        header->capacity = CAPACITY;
+    }
+
+    mapping = address;
+    mappedLength = length;
+    entries = reinterpret_cast<Entry *>(static_cast<uint8_t *>(address) + sizeof(Header));
+    return true;
+}
+
+void StatKeyIndex::close() {
+    lock_guard<mutex> guard(lock);
+    unmap();
+}
+
+bool StatKeyIndex::isOpen() {
+    lock_guard<mutex> guard(lock);
+    return mapping != nullptr;
+}
+
+size_t StatKeyIndex::lookup(const FileIdentity &file, uint32_t fingerprint, uint8_t *hash) {
+    lock_guard<mutex> guard(lock);
+    if (!entries) return 0;
+
+    uint32_t home = homeSlot(file);
+    for (uint32_t probe = 0; probe < MAX_PROBE; probe++) {
+        const Entry &entry = entries[(home + probe) & (CAPACITY - 1)];
+        if (!isValid(entry) || entry.device != file.device || entry.inode != file.inode) continue;
+        if (entry.size != file.size || entry.mtimeNanos != file.mtimeNanos ||
+            entry.fingerprint != fingerprint) {
+            return 0;
+        }
+        memcpy(hash, entry.hash, entry.hashLength);
+        return entry.hashLength;
+    }
+    return 0;
+}
+
+void StatKeyIndex::record(const FileIdentity &file, uint32_t fingerprint, const uint8_t *hash,
+                          size_t length) {
+    if (length == 0 || length > MAX_HASH_LENGTH) return;
+
+    timespec now{};
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t nowNanos = static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+    if (file.mtimeNanos > nowNanos - RACY_WINDOW_NANOS) return;
+
+    lock_guard<mutex> guard(lock);
+    if (!entries) return;
+
+    // Reuse this inode's slot, else the first free one; evict the home slot if all are taken
+    uint32_t home = homeSlot(file);
+    Entry *target = nullptr;
+    for (uint32_t probe = 0; probe < MAX_PROBE; probe++) {
+        Entry &entry = entries[(home + probe) & (CAPACITY - 1)];
+        if (!isValid(entry)) {
+            if (!target) target = &entry;
+        } else if (entry.device == file.device && entry.inode == file.inode) {
+            target = &entry;
+            break;
+        }
+    }
+    if (!target) target = &entries[home];
+
+    // Invalidate first so a torn write is never mistaken for a valid entry
+    target->checksum = 0;
+    target->device = file.device;
+    target->inode = file.inode;
+    target->size = file.size;
+    target->mtimeNanos = file.mtimeNanos;
+    target->fingerprint = fingerprint;
+    target->hashLength = static_cast<uint32_t>(length);
+    memset(target->hash, 0, sizeof(target->hash));
+    memcpy(target->hash, hash, length);
+    target->reserved = 0;
+    target->checksum = checksumOf(*target);
+}
+
+void StatKeyIndex::unmap() {
+    if (mapping) munmap(mapping, mappedLength);
+    mapping = nullptr;
+    mappedLength = 0;
+    entries = nullptr;
+}
+
+uint32_t StatKeyIndex::checksumOf(const Entry &entry) {
+    // FNV-1a over everything before the checksum; never zero so zeroed slots read as free
+    const auto *bytes = reinterpret_cast<const uint8_t *>(&entry);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(Entry, checksum); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash | 1u;
+}
+
+bool StatKeyIndex::isValid(const Entry &entry) {
+    return entry.checksum != 0 && entry.hashLength <= MAX_HASH_LENGTH &&
+           entry.checksum == checksumOf(entry);
+}
+
+uint32_t StatKeyIndex::homeSlot(const FileIdentity &file) {
+    uint64_t mixed = (file.inode ^ (file.device * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+    return static_cast<uint32_t>(mixed >> 32) & (CAPACITY - 1);
+}
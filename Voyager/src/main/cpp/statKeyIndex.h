@@ -0,0 +1,104 @@
+/**
+ * Persistent index from a file's stat identity to its last content fingerprint.
+ *
+ * A local layout file whose (device, inode, size, mtime) tuple is unchanged since it was
+ * last parsed still has the same content, so its fingerprint can be reused without
+ * reading a byte. Entries live in a small fixed-size open-addressing table in an mmapped
+ * file, so they survive process restarts. A changed stat tuple simply misses.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <sys/stat.h>
+
+struct FileIdentity {
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtimeNanos;
+
+    static FileIdentity of(const struct stat &info);
+};
+
+class StatKeyIndex {
+public:
+    static constexpr size_t MAX_HASH_LENGTH = 32;
+
+    StatKeyIndex() = default;
+
+    ~StatKeyIndex();
+
+    StatKeyIndex(const StatKeyIndex &) = delete;
+
+    StatKeyIndex &operator=(const StatKeyIndex &) = delete;
+
+    /**
+     * Maps the index file at `path`, creating it if needed. A file with a foreign or
+     * outdated layout is reinitialized. Reopening replaces the current mapping.
+     */
+    bool open(const char *path);
+
+    void close();
+
+    bool isOpen();
+
+    /**
+     * Copies the fingerprint recorded for `file` into `hash` and returns its length, or
+     * returns 0 if there is no entry for this exact stat tuple and fingerprint kind.
+     */
+    size_t lookup(const FileIdentity &file, uint32_t fingerprint, uint8_t *hash);
+
+    /**
+     * Records the fingerprint for `file`, replacing any older entry for the same inode.
+     * Files modified within the last RACY_WINDOW_NANOS are skipped: a write landing in
+     * the same timestamp tick could otherwise go unnoticed.
+     */
+    void record(const FileIdentity &file, uint32_t fingerprint, const uint8_t *hash,
+                size_t length);
+
+    static constexpr int64_t RACY_WINDOW_NANOS = 2000000000LL;
+
+private:
+    static constexpr uint32_t MAGIC = 0x494b5356;  // "VSKI"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t CAPACITY = 1024;  // Power of two
+    static constexpr uint32_t MAX_PROBE = 8;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t capacity;
+        uint32_t reserved;
+    };
+
+    struct Entry {
+        uint64_t device;
+        uint64_t inode;
+        uint64_t size;
+        int64_t mtimeNanos;
+        uint32_t fingerprint;
+        uint32_t hashLength;
+        uint8_t hash[MAX_HASH_LENGTH];
+        // Non-zero checksum of the fields above; zero or a mismatch marks a free slot
+        uint32_t checksum;
+        uint32_t reserved;
+    };
+
+    std::mutex lock;
+    void *mapping = nullptr;
+    size_t mappedLength = 0;
+    Entry *entries = nullptr;
+
+    void unmap();
+
+    static uint32_t checksumOf(const Entry &entry);
+
+    static bool isValid(const Entry &entry);
+
+    static uint32_t homeSlot(const FileIdentity &file);
+};
@@ -0,0 +1,124 @@
+/**
+ * TokenRing allocation and its futex-based waiting.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "tokenRing.h"
+
+#include <cstdlib>
+#include <ctime>
+#include <linux/futex.h>
+#include <new>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    // Sleeps while `word` still holds `expected`; spurious returns are fine for the callers
+    void futexWait(std::atomic<uint32_t> &word, uint32_t expected) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected,
+                nullptr, nullptr, 0);
+    }
+
+    void futexWakeAll(std::atomic<uint32_t> &word) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE, INT32_MAX,
+                nullptr, nullptr, 0);
+    }
+}
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words must be plain ints");
+
+TokenRing::TokenRing(size_t capacity) {
+    dataCapacity = 64;
+    while (dataCapacity < capacity) dataCapacity *= 2;
+    void *block = nullptr;
+    if (posix_memalign(&block, 64, HEADER_SIZE + dataCapacity) != 0) throw std::bad_alloc();
+    memory = static_cast<uint8_t *>(block);
+    static_assert(sizeof(Control) <= HEADER_SIZE, "control block must fit the header");
+    control = new(memory) Control();
+}
+
+TokenRing::~TokenRing() {
+    control->~Control();
+    free(memory);
+}
+
+uint8_t *TokenRing::reserve(size_t length) {
+    if (length > dataCapacity) return nullptr;
+    size_t mask = dataCapacity - 1;
+    size_t offset = head & mask;
+    if (offset + length > dataCapacity) {
+        // Pad out the lap first; waiting for pad and record together could ask for more
+        // than the whole ring
+        size_t pad = dataCapacity - offset;
+        if (!waitForSpace(pad)) return nullptr;
+        data()[offset] = OP_PAD;
+        head += pad;
+        offset = 0;
+    }
+    if (!waitForSpace(length)) return nullptr;
+    return data() + offset;
+}
+
+bool TokenRing::waitForSpace(size_t needed) {
+    while (true) {
+        if (control->cancelled.load(std::memory_order_acquire)) return false;
+        if (head + needed - control->released.load(std::memory_order_acquire) <= dataCapacity) {
+            return true;
+        }
+        // Whatever is committed must be visible, or the consumer could never free space
+        publish();
+        control->producerSleeping.store(1);
+        uint32_t sequence = control->releaseSequence.load();
+        if (head + needed - control->released.load() > dataCapacity &&
+            !control->cancelled.load()) {
+            futexWait(control->releaseSequence, sequence);
+        }
+        control->producerSleeping.store(0);
+    }
+}
+
+void TokenRing::publish() {
+    if (control->published.load(std::memory_order_relaxed) == head) return;
+    control->published.store(head);
+    if (control->consumerSleeping.load()) {
+        control->publishSequence.fetch_add(1);
+        futexWakeAll(control->publishSequence);
+    }
+}
+
+void TokenRing::close() {
+    publish();
+    control->closed.store(true);
+    control->publishSequence.fetch_add(1);
+    futexWakeAll(control->publishSequence);
+}
+
+uint64_t TokenRing::await(uint64_t consumed) {
+    if (control->released.load(std::memory_order_relaxed) != consumed) {
+        control->released.store(consumed);
+        if (control->producerSleeping.load()) {
+            control->releaseSequence.fetch_add(1);
+            futexWakeAll(control->releaseSequence);
+        }
+    }
+    while (true) {
+        uint64_t end = control->published.load(std::memory_order_acquire);
+        if (end != consumed || control->closed.load(std::memory_order_acquire)) {
+            // A close may race with the last publish; read it again once closed is seen
+            return control->published.load(std::memory_order_acquire);
+        }
+        control->consumerSleeping.store(1);
+        uint32_t sequence = control->publishSequence.load();
+        if (control->published.load() == consumed && !control->closed.load()) {
+            futexWait(control->publishSequence, sequence);
+        }
+        control->consumerSleeping.store(0);
+    }
+}
+
+void TokenRing::cancel() {
+    control->cancelled.store(true);
+    control->releaseSequence.fetch_add(1);
+    futexWakeAll(control->releaseSequence);
+}
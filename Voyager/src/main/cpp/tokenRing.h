@@ -0,0 +1,258 @@
+/**
+ * Single-producer/single-consumer token ring in shared memory.
+ *
+ * A parser thread encodes tokens into the ring while a consumer on another thread, in
+ * Kotlin reading the same memory through a direct ByteBuffer, decodes them, so parsing
+ * and tree building run on different cores. Tokens cross without any per-token JNI: the
+ * consumer only calls in through await() once it has drained everything published, and
+ * either side sleeps on a futex when the ring is empty or full. Waking is skipped unless
+ * the other side has announced that it sleeps.
+ *
+ * The ring is laid out as a HEADER_SIZE control block (positions, futex words; native
+ * only) followed by `capacity` bytes of data, a power of two. Positions are byte counts
+ * that only grow; a position's offset in the data is `position & (capacity - 1)`.
+ * Records never wrap: one that doesn't fit before the end of the data is preceded by a
+ * PAD byte and starts at the next lap.
+ *
+ * Record layout (little-endian), decoded by `TokenRing` on the Kotlin side:
+ * - `PAD`: the rest of this lap is unused
+ * - `STRING [id:u32][length:u32][utf8 bytes]`: defines the next string id, before any
+ *   record that uses it
+ * - `START_ELEMENT [nameId:u32][attrCount:u16]([keyId:u32][valueId:u32])*`
+ * - `END_ELEMENT [nameId:u32]`
+ * - `TEXT [textId:u32]`
+ * - `COMPLETE [hashLength:u8][hash]` or `FAILED`: the last record of a parse
+ *
+ * Element and text records match the batched transport's (see TokenBatchDecoder).
+ *
+ * A writer can publish at subtree boundaries only (see TokenRingWriter's `publishDepth`):
+ * the consumer then sees the root's start tag, and each child of the root only once its
+ * end tag is parsed, so it can render whole subtrees while the rest is still parsing.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#pragma once
+
+#include "flatTreeBuilder.h"
+#include "internTable.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+class TokenRing {
+public:
+    static constexpr size_t HEADER_SIZE = 128;
+
+    static constexpr uint8_t OP_PAD = 0x00;
+    static constexpr uint8_t OP_STRING = 0x01;
+    static constexpr uint8_t OP_START_ELEMENT = 0x02;
+    static constexpr uint8_t OP_END_ELEMENT = 0x03;
+    static constexpr uint8_t OP_TEXT = 0x04;
+    static constexpr uint8_t OP_COMPLETE = 0x05;
+    static constexpr uint8_t OP_FAILED = 0x06;
+
+    // Allocates a ring with `capacity` bytes of data, rounded up to a power of two
+    explicit TokenRing(size_t capacity);
+
+    ~TokenRing();
+
+    TokenRing(const TokenRing &) = delete;
+
+    TokenRing &operator=(const TokenRing &) = delete;
+
+    // The data area, for handing to the consumer
+    uint8_t *data() const {
+        return memory + HEADER_SIZE;
+    }
+
+    size_t capacity() const {
+        return dataCapacity;
+    }
+
+    /**
+     * Producer: returns room for a record of `length` contiguous bytes, waiting for the
+     * consumer if the ring is full. Returns nullptr if the record can never fit or the
+     * consumer has cancelled.
+     */
+    uint8_t *reserve(size_t length);
+
+    // Producer: appends the record written into reserve()'s room; not yet visible
+    void commit(size_t length) {
+        head += length;
+    }
+
+    // Producer: makes every committed record visible to the consumer
+    void publish();
+
+    // Producer: no more records will follow
+    void close();
+
+    /**
+     * Consumer: releases everything before `consumed`, then waits until records past it
+     * are published. Returns the end of the readable records; equal to `consumed` only
+     * once the producer has closed the ring and everything was read.
+     */
+    uint64_t await(uint64_t consumed);
+
+    // Consumer: stops the producer; its pending and later reserve() calls fail
+    void cancel();
+
+    bool isCancelled() const {
+        return control->cancelled.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Control {
+        std::atomic<uint64_t> published{0};
+        std::atomic<uint64_t> released{0};
+        // Futex words: bumped whenever a sleeping consumer or producer must look again
+        std::atomic<uint32_t> publishSequence{0};
+        std::atomic<uint32_t> releaseSequence{0};
+        std::atomic<uint32_t> consumerSleeping{0};
+        std::atomic<uint32_t> producerSleeping{0};
+        std::atomic<bool> closed{false};
+        std::atomic<bool> cancelled{false};
+    };
+
+    uint8_t *memory = nullptr;
+    Control *control = nullptr;
+    size_t dataCapacity = 0;
+    // Producer-local end of the committed records
+    uint64_t head = 0;
+
+    bool waitForSpace(size_t needed);
+};
+
+/**
+ * Encodes parse events into a TokenRing, interning strings in the parse's InternTable and
+ * defining each new id in the ring right before the first record that uses it. Every
+ * method returns false once the ring refuses a record (consumer gone or record too big).
+ *
+ * Records are published once the element depth after them is at most `publishDepth`, so
+ * with PUBLISH_SUBTREES the consumer is woken for the root's start tag and then once per
+ * completed child of the root; with PUBLISH_EVERY_RECORD it sees each token right away.
+ * A full ring publishes regardless, so a subtree bigger than the ring still streams.
+ */
+class TokenRingWriter {
+public:
+    static constexpr uint32_t PUBLISH_SUBTREES = 1;
+    static constexpr uint32_t PUBLISH_EVERY_RECORD = UINT32_MAX;
+
+    TokenRingWriter(TokenRing &ring, InternTable &strings,
+                    uint32_t publishDepth = PUBLISH_EVERY_RECORD)
+            : ring(ring), strings(strings), publishDepth(publishDepth) {}
+
+    bool startElement(const char *name, const char **attributes) {
+        uint32_t nameId = strings.intern(name, std::strlen(name), true);
+        size_t attrCount = 0;
+        for (const char **attr = attributes; *attr; attr += 2) {
+            const char *key = localName(*attr);
+            const char *value = attr[1] ? attr[1] : "";
+            strings.intern(key, std::strlen(key), true);
+            strings.intern(value, std::strlen(value));
+            attrCount++;
+        }
+        if (!defineStrings()) return false;
+
+        uint8_t *out = begin(1 + 4 + 2 + 8 * attrCount);
+        if (!out) return false;
+        *out++ = TokenRing::OP_START_ELEMENT;
+        out = putU32(out, nameId);
+        out = putU16(out, static_cast<uint16_t>(attrCount));
+        for (const char **attr = attributes; *attr; attr += 2) {
+            const char *key = localName(*attr);
+            const char *value = attr[1] ? attr[1] : "";
+            out = putU32(out, strings.find(key, std::strlen(key)));
+            out = putU32(out, strings.find(value, std::strlen(value)));
+        }
+        depth++;
+        return end();
+    }
+
+    bool endElement(const char *name) {
+        if (depth > 0) depth--;
+        return idRecord(TokenRing::OP_END_ELEMENT, strings.intern(name, std::strlen(name), true));
+    }
+
+    bool text(const char *data, size_t length) {
+        return idRecord(TokenRing::OP_TEXT, strings.intern(data, length));
+    }
+
+    bool complete(const uint8_t *hash, size_t hashLength) {
+        uint8_t *out = begin(2 + hashLength);
+        if (!out) return false;
+        *out++ = TokenRing::OP_COMPLETE;
+        *out++ = static_cast<uint8_t>(hashLength);
+        if (hashLength) std::memcpy(out, hash, hashLength);
+        depth = 0;
+        return end();
+    }
+
+    bool fail() {
+        uint8_t *out = begin(1);
+        if (!out) return false;
+        *out = TokenRing::OP_FAILED;
+        depth = 0;
+        return end();
+    }
+
+private:
+    TokenRing &ring;
+    InternTable &strings;
+    // Ids below this are already defined in the ring; ids are dense, so new ones follow
+    uint32_t defined = 0;
+    size_t pending = 0;
+    uint32_t publishDepth;
+    // Elements open after the last record
+    uint32_t depth = 0;
+
+    uint8_t *begin(size_t length) {
+        pending = length;
+        return ring.reserve(length);
+    }
+
+    bool end() {
+        ring.commit(pending);
+        if (depth <= publishDepth) ring.publish();
+        return true;
+    }
+
+    bool idRecord(uint8_t op, uint32_t id) {
+        if (!defineStrings()) return false;
+        uint8_t *out = begin(1 + 4);
+        if (!out) return false;
+        *out++ = op;
+        putU32(out, id);
+        return end();
+    }
+
+    bool defineStrings() {
+        for (; defined < strings.size(); defined++) {
+            std::string_view value = strings.get(defined);
+            uint8_t *out = ring.reserve(1 + 4 + 4 + value.size());
+            if (!out) return false;
+            *out++ = TokenRing::OP_STRING;
+            out = putU32(out, defined);
+            out = putU32(out, static_cast<uint32_t>(value.size()));
+            if (!value.empty()) std::memcpy(out, value.data(), value.size());
+            // Published with the record that uses it
+            ring.commit(1 + 4 + 4 + value.size());
+        }
+        return true;
+    }
+
+    static uint8_t *putU16(uint8_t *out, uint16_t value) {
+        *out++ = static_cast<uint8_t>(value);
+        *out++ = static_cast<uint8_t>(value >> 8);
+        return out;
+    }
+
+    static uint8_t *putU32(uint8_t *out, uint32_t value) {
+        for (int shift = 0; shift < 32; shift += 8) *out++ = static_cast<uint8_t>(value >> shift);
+        return out;
+    }
+};
@@ -0,0 +1,425 @@
+/**
+ * Host check for BytecodeCompiler: compiles layouts while Expat parses them, then runs
+ * the bytecode the way `BytecodeInterpreter` does (views by creation index, attributes on
+ * the last created view, ADD_CHILD links) and compares the rebuilt tree with Expat's own
+ * view of the document. Also checks the header fields and the activity name.
+ *
+ * For v2 every typed constant is printed back as the interpreter's value classes do and
+ * must equal the source text, and every view's subtree is run on its own from the index.
+ *
+ * `--fixture` prints a small layout compiled to both versions, as the hex that
+ * `BytecodeInterpreterTest` runs on the Kotlin interpreter.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "../bytecodeCompiler.h"
+#include "../internTable.h"
+
+#include <expat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+    int failures = 0;
+
+    void expect(bool condition, const char *what) {
+        if (!condition) {
+            std::printf("FAIL %s\n", what);
+            failures++;
+        }
+    }
+
+    struct View {
+        std::string type;
+        std::string id;
+        std::vector<std::pair<std::string, std::string>> attributes;
+        std::vector<size_t> children;
+    };
+
+    std::string describe(const std::vector<View> &views, size_t index) {
+        const View &view = views[index];
+        std::string out = "<" + view.type + (view.id.empty() ? "" : "#" + view.id);
+        for (const auto &[key, value]: view.attributes) out += " " + key + "=" + value;
+        out += ">";
+        for (size_t child: view.children) out += describe(views, child);
+        return out + "</>";
+    }
+
+    // The expected tree, straight from Expat
+    struct Reference {
+        std::vector<View> views;
+        std::vector<size_t> open;
+
+        static void XMLCALL onStart(void *userData, const char *name, const char **attributes) {
+            auto *self = static_cast<Reference *>(userData);
+            size_t index = self->views.size();
+            if (!self->open.empty()) self->views[self->open.back()].children.push_back(index);
+            View view{name, {}, {}, {}};
+            for (const char **attr = attributes; *attr; attr += 2) {
+                std::string key = localName(attr[0]);
+                std::string value = attr[1];
+                if (key == "id" && view.id.empty()) {
+                    size_t slash = value.find('/');
+                    view.id = value[0] == '@' && slash != std::string::npos ? value.substr(slash + 1)
+                                                                            : value;
+                }
+                view.attributes.emplace_back(key, value);
+            }
+            self->views.push_back(view);
+            self->open.push_back(index);
+        }
+
+        static void XMLCALL onEnd(void *userData, const char * /* name */) {
+            static_cast<Reference *>(userData)->open.pop_back();
+        }
+    };
+
+    struct Compile {
+        BytecodeCompiler *compiler;
+
+        static void XMLCALL onStart(void *userData, const char *name, const char **attributes) {
+            static_cast<Compile *>(userData)->compiler->startElement(name, attributes);
+        }
+
+        static void XMLCALL onEnd(void *userData, const char * /* name */) {
+            static_cast<Compile *>(userData)->compiler->endElement();
+        }
+    };
+
+    template<typename Handler>
+    bool parse(const std::string &document, Handler &handler) {
+        XML_Parser parser = XML_ParserCreate(nullptr);
+        XML_SetUserData(parser, &handler);
+        XML_SetElementHandler(parser, Handler::onStart, Handler::onEnd);
+        bool ok = XML_Parse(parser, document.data(), static_cast<int>(document.size()), XML_TRUE) ==
+                  XML_STATUS_OK;
+        XML_ParserFree(parser);
+        return ok;
+    }
+
+    // Mirrors BytecodeInterpreter.execute for the instructions the compiler emits
+    struct Interpreter {
+        const uint8_t *in;
+        const uint8_t *end;
+        bool ok = true;
+
+        uint8_t u8() {
+            if (in >= end) {
+                ok = false;
+                return 0;
+            }
+            return *in++;
+        }
+
+        int32_t i32() {
+            uint32_t value = 0;
+            for (int shift = 0; shift < 32; shift += 8) value |= static_cast<uint32_t>(u8()) << shift;
+            return static_cast<int32_t>(value);
+        }
+
+        std::string string() {
+            return bytes(i32());
+        }
+
+        std::string bytes(int64_t length) {
+            if (length < 0 || end - in < length) {
+                ok = false;
+                return {};
+            }
+            std::string value(reinterpret_cast<const char *>(in), length);
+            in += length;
+            return value;
+        }
+
+        uint32_t varint() {
+            uint32_t value = 0;
+            for (int shift = 0; shift < 35; shift += 7) {
+                uint8_t byte = u8();
+                value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return value;
+            }
+            ok = false;
+            return value;
+        }
+
+        int32_t zigzag() {
+            uint32_t value = varint();
+            return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+        }
+    };
+
+    struct Decoded {
+        std::string rootType;
+        int32_t viewCount = 0;
+        std::string activity;
+        std::vector<View> views;
+        bool finalized = false;
+    };
+
+    Decoded runV1(const std::vector<uint8_t> &bytecode) {
+        Decoded decoded;
+        Interpreter interpreter{bytecode.data(), bytecode.data() + bytecode.size()};
+        expect(interpreter.u8() == BytecodeCompiler::VERSION_1, "version byte");
+        interpreter.i32();
+        decoded.rootType = interpreter.string();
+        decoded.viewCount = interpreter.i32();
+        while (interpreter.ok && interpreter.in < interpreter.end && !decoded.finalized) {
+            switch (interpreter.u8()) {
+                case BytecodeCompiler::OP_CREATE_VIEW:
+                    decoded.views.push_back(View{interpreter.string(), {}, {}, {}});
+                    break;
+                case BytecodeCompiler::OP_SET_ATTRIBUTE: {
+                    std::string key = interpreter.string();
+                    expect(interpreter.u8() == BytecodeCompiler::TYPE_STRING, "string values");
+                    std::string value = interpreter.string();
+                    expect(!decoded.views.empty(), "attribute before any view");
+                    if (!decoded.views.empty()) decoded.views.back().attributes.emplace_back(key, value);
+                    break;
+                }
+                case BytecodeCompiler::OP_ADD_CHILD: {
+                    int32_t parent = interpreter.i32();
+                    int32_t child = interpreter.i32();
+                    bool valid = parent >= 0 && child > parent &&
+                                 static_cast<size_t>(child) < decoded.views.size();
+                    expect(valid, "ADD_CHILD indices");
+                    if (valid) decoded.views[parent].children.push_back(child);
+                    break;
+                }
+                case BytecodeCompiler::OP_SET_ID:
+                    if (!decoded.views.empty()) decoded.views.back().id = interpreter.string();
+                    break;
+                case BytecodeCompiler::OP_OPTIMIZE_HINT: {
+                    std::string type = interpreter.string();
+                    std::string data = interpreter.string();
+                    if (type == "activity") {
+                        expect(decoded.views.empty(), "activity hint ahead of the views");
+                        decoded.activity = data;
+                    }
+                    break;
+                }
+                case BytecodeCompiler::OP_FINALIZE:
+                    decoded.finalized = true;
+                    break;
+                default:
+                    interpreter.ok = false;
+            }
+        }
+        expect(interpreter.ok, "bytecode decodes");
+        expect(decoded.finalized && interpreter.u8() == BytecodeCompiler::END_MARKER &&
+               interpreter.in == interpreter.end, "FINALIZE and end marker close the bytecode");
+        return decoded;
+    }
+
+    // Prints a v2 constant the way the interpreter's value classes do
+    std::string constantText(Interpreter &in) {
+        switch (in.u8()) {
+            case BytecodeCompiler::TYPE_STRING:
+                return in.bytes(in.varint());
+            case BytecodeCompiler::TYPE_INT:
+                return std::to_string(in.zigzag());
+            case BytecodeCompiler::TYPE_BOOLEAN:
+                return in.u8() ? "true" : "false";
+            case BytecodeCompiler::TYPE_DIMENSION: {
+                uint8_t unit = in.u8();
+                bool known = unit < sizeof(BytecodeCompiler::UNITS) / sizeof(BytecodeCompiler::UNITS[0]);
+                expect(known, "dimension unit");
+                return std::to_string(in.zigzag()) + (known ? BytecodeCompiler::UNITS[unit] : "");
+            }
+            case BytecodeCompiler::TYPE_COLOR: {
+                uint8_t form = in.u8();
+                auto argb = static_cast<uint32_t>(in.i32());
+                char text[16];
+                bool alpha = form & BytecodeCompiler::COLOR_HAS_ALPHA;
+                bool lower = form & BytecodeCompiler::COLOR_LOWERCASE;
+                std::snprintf(text, sizeof(text), alpha ? (lower ? "#%08x" : "#%08X")
+                                                        : (lower ? "#%06x" : "#%06X"),
+                              alpha ? argb : argb & 0xFFFFFF);
+                return text;
+            }
+            default:
+                in.ok = false;
+                return {};
+        }
+    }
+
+    struct ProgramV2 {
+        int32_t viewCount = 0;
+        std::string rootType;
+        std::string activity;
+        std::vector<std::string> constants;
+        std::vector<std::pair<uint32_t, uint32_t>> index;
+        const uint8_t *code = nullptr;
+        size_t codeLength = 0;
+    };
+
+    ProgramV2 loadV2(const std::vector<uint8_t> &bytecode) {
+        ProgramV2 program;
+        Interpreter in{bytecode.data(), bytecode.data() + bytecode.size()};
+        expect(in.u8() == BytecodeCompiler::VERSION_2, "v2 version byte");
+        in.i32();
+        program.viewCount = static_cast<int32_t>(in.varint());
+        uint32_t rootType = in.varint();
+        uint32_t activity = in.varint();
+        uint32_t constantCount = in.varint();
+        for (uint32_t i = 0; i < constantCount && in.ok; i++) program.constants.push_back(constantText(in));
+        expect(rootType < program.constants.size() && activity < program.constants.size(),
+               "header constants");
+        if (rootType < program.constants.size()) program.rootType = program.constants[rootType];
+        if (activity < program.constants.size()) program.activity = program.constants[activity];
+        for (int32_t i = 0; i < program.viewCount && in.ok; i++) {
+            auto offset = static_cast<uint32_t>(in.i32());
+            auto descendants = static_cast<uint32_t>(in.i32());
+            program.index.emplace_back(offset, descendants);
+        }
+        program.codeLength = in.varint();
+        program.code = in.in;
+        expect(in.ok && static_cast<size_t>(in.end - in.in) == program.codeLength + 1 &&
+               in.in[program.codeLength - 1] == BytecodeCompiler::OP_FINALIZE &&
+               in.in[program.codeLength] == BytecodeCompiler::END_MARKER,
+               "v2 code ends with FINALIZE and the end marker");
+        return program;
+    }
+
+    // Runs the subtree of view `first` alone, as BytecodeInterpreter.executeSubtree does
+    std::vector<View> runV2(const ProgramV2 &program, uint32_t first) {
+        std::vector<View> views;
+        uint32_t last = first + program.index[first].second;
+        size_t endOffset = last + 1 < program.index.size() ? program.index[last + 1].first
+                                                            : program.codeLength - 1;
+        Interpreter in{program.code + program.index[first].first, program.code + endOffset};
+        auto constant = [&](uint32_t id) {
+            expect(id < program.constants.size(), "constant index");
+            return id < program.constants.size() ? program.constants[id] : std::string();
+        };
+        while (in.ok && in.in < in.end) {
+            switch (in.u8()) {
+                case BytecodeCompiler::OP_CREATE_VIEW:
+                    views.push_back(View{constant(in.varint()), {}, {}, {}});
+                    break;
+                case BytecodeCompiler::OP_ADD_CHILD: {
+                    uint32_t parent = in.varint();
+                    expect(!views.empty() && parent < first + views.size() - 1, "ADD_CHILD parent");
+                    // The subtree's own root has its parent outside the subtree
+                    if (parent >= first && !views.empty()) {
+                        views[parent - first].children.push_back(views.size() - 1);
+                    }
+                    break;
+                }
+                case BytecodeCompiler::OP_SET_ID:
+                    if (!views.empty()) views.back().id = constant(in.varint());
+                    break;
+                case BytecodeCompiler::OP_SET_ATTRIBUTE: {
+                    std::string key = constant(in.varint());
+                    std::string value = constant(in.varint());
+                    if (!views.empty()) views.back().attributes.emplace_back(key, value);
+                    break;
+                }
+                default:
+                    in.ok = false;
+            }
+        }
+        expect(in.ok, "v2 code decodes");
+        expect(views.size() == last - first + 1, "subtree view count matches the index");
+        return views;
+    }
+
+    size_t compile(const std::string &document, const char *activity, uint8_t version,
+                   std::vector<uint8_t> &bytecode) {
+        Arena arena;
+        InternTable constants;
+        BytecodeCompiler compiler(arena, constants, activity, version);
+        Compile compile{&compiler};
+        expect(parse(document, compile), "compiling parse");
+        bytecode.resize(compiler.serializedSize());
+        compiler.serialize(bytecode.data(), 1234);
+        return bytecode.size();
+    }
+
+    void check(const std::string &document, const char *activity) {
+        Reference reference;
+        expect(parse(document, reference), "reference parse");
+        std::string expected = describe(reference.views, 0);
+
+        std::vector<uint8_t> v1;
+        compile(document, activity, BytecodeCompiler::VERSION_1, v1);
+        Decoded decoded = runV1(v1);
+        expect(decoded.activity == activity, "activity name");
+        expect(decoded.rootType == reference.views[0].type, "root type in the header");
+        expect(decoded.viewCount == static_cast<int32_t>(reference.views.size()), "view count");
+        expect(!decoded.views.empty() && describe(decoded.views, 0) == expected,
+               "rebuilt tree matches the document");
+
+        std::vector<uint8_t> v2;
+        compile(document, activity, BytecodeCompiler::VERSION_2, v2);
+        ProgramV2 program = loadV2(v2);
+        expect(program.activity == activity, "v2 activity name");
+        expect(program.rootType == reference.views[0].type, "v2 root type in the header");
+        expect(program.viewCount == static_cast<int32_t>(reference.views.size()), "v2 view count");
+        for (uint32_t view = 0; view < program.index.size(); view++) {
+            std::vector<View> subtree = runV2(program, view);
+            if (subtree.empty() || describe(subtree, 0) != describe(reference.views, view)) {
+                std::printf("FAIL v2 subtree of view %u differs from the document\n", view);
+                failures++;
+                break;
+            }
+        }
+        std::printf("%zu views: v1 %zu bytes, v2 %zu bytes\n", reference.views.size(), v1.size(),
+                    v2.size());
+    }
+
+    std::string makeDocument(size_t rows) {
+        std::string xml = "<LinearLayout xmlns:android=\"http://schemas.android.com/apk/res/android\""
+                          " android:id=\"@+id/list\" android:orientation=\"vertical\">";
+        for (size_t r = 0; r < rows; r++) {
+            xml += "<FrameLayout android:layout_width=\"match_parent\" android:layout_height=\"48dp\">"
+                   "<TextView android:id=\"@+id/label" + std::to_string(r) +
+                   "\" android:text=\"Row " + std::to_string(r) + "\" android:textSize=\"14sp\""
+                   " android:textColor=\"#FF336699\" android:maxLines=\"1\"/>"
+                   "<ImageView android:visibility=\"gone\" android:alpha=\"0.5\"/></FrameLayout>";
+        }
+        return xml + "</LinearLayout>";
+    }
+
+    // The layout BytecodeInterpreterTest runs on the Kotlin interpreter
+    constexpr char FIXTURE[] =
+            "<LinearLayout android:id=\"@+id/root\" android:orientation=\"vertical\">"
+            "<TextView android:text=\"007\" android:textSize=\"16sp\"/>"
+            "<FrameLayout android:alpha=\"0.5\"><TextView android:id=\"@+id/label\""
+            " android:textColor=\"#ff336699\" android:maxLines=\"1\"/></FrameLayout>"
+            "</LinearLayout>";
+    constexpr char FIXTURE_ACTIVITY[] = "com.example.MainActivity";
+
+    // Prints FIXTURE compiled to both versions as hex, one line each
+    int printFixture() {
+        for (uint8_t version : {BytecodeCompiler::VERSION_1, BytecodeCompiler::VERSION_2}) {
+            std::vector<uint8_t> bytecode;
+            compile(FIXTURE, FIXTURE_ACTIVITY, version, bytecode);
+            std::printf("v%u ", version);
+            for (uint8_t byte : bytecode) std::printf("%02x", byte);
+            std::printf("\n");
+        }
+        return failures ? 1 : 0;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc == 2 && std::strcmp(argv[1], "--fixture") == 0) return printFixture();
+    // Values that must stay strings: printing a typed form back would change them
+    check("<TextView text=\"007\" a=\"-0\" b=\"+1\" c=\"0.5dp\" d=\"#AbCdEf\" e=\"True\""
+          " f=\"16 dp\" g=\"2147483648\" h=\"12qq\" i=\"#12345\" j=\"\"/>", "");
+    // Values that are typed and must print back the same
+    check("<TextView a=\"12\" b=\"-2147483648\" c=\"true\" d=\"false\" e=\"-4px\""
+          " f=\"8dip\" g=\"#80ff00aa\" h=\"#00FF00\" i=\"#123456\" j=\"0\"/>", "");
+    check("<View/>", "");
+    check("<TextView xmlns:android=\"x\" android:id=\"title\" android:text=\"&lt;Hi&gt;\"/>",
+          "com.example.MainActivity");
+    check(makeDocument(500), "com.example.ListActivity");
+    check(FIXTURE, FIXTURE_ACTIVITY);
+    if (failures) return 1;
+    std::printf("BytecodeCompiler ok\n");
+    return 0;
+}
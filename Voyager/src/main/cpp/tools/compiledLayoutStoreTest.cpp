@@ -0,0 +1,177 @@
+/**
+ * Host check for CompiledLayoutStore: hits, persistence across reopen, the lazy checksum
+ * catching a corrupted record, LRU compaction under the size bound, replaced data files
+ * being unmapped by compaction and by opening another store, and recovery from a foreign
+ * index file.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "../compiledLayoutStore.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    int failures = 0;
+
+    constexpr uint32_t KIND = 1;
+
+    void check(bool condition, const char *what) {
+        if (!condition) {
+            std::printf("FAIL %s\n", what);
+            failures++;
+        }
+    }
+
+    std::vector<uint8_t> keyOf(int id) {
+        std::vector<uint8_t> key(16);
+        for (size_t i = 0; i < key.size(); i++) key[i] = static_cast<uint8_t>(id * 31 + i);
+        return key;
+    }
+
+    std::vector<uint8_t> payloadOf(int id, size_t size) {
+        std::vector<uint8_t> payload(size);
+        for (size_t i = 0; i < size; i++) payload[i] = static_cast<uint8_t>(id + i * 7);
+        return payload;
+    }
+
+    bool holds(CompiledLayoutStore &store, int id, size_t size) {
+        std::vector<uint8_t> key = keyOf(id);
+        std::vector<uint8_t> expected = payloadOf(id, size);
+        std::vector<uint8_t> payload;
+        return store.find(KIND, key.data(), key.size(), payload) && payload == expected;
+    }
+
+    bool put(CompiledLayoutStore &store, int id, size_t size) {
+        std::vector<uint8_t> key = keyOf(id);
+        std::vector<uint8_t> payload = payloadOf(id, size);
+        return store.put(KIND, key.data(), key.size(), payload.data(), payload.size());
+    }
+
+    // Mappings of `path` in this process, including those of a replaced (deleted) file
+    int mappingsOf(const std::string &path) {
+        FILE *maps = std::fopen("/proc/self/maps", "r");
+        if (!maps) return -1;
+        int count = 0;
+        char line[4096];
+        while (std::fgets(line, sizeof(line), maps)) {
+            if (std::strstr(line, path.c_str())) count++;
+        }
+        std::fclose(maps);
+        return count;
+    }
+
+    off_t fileSize(const std::string &path) {
+        struct stat info{};
+        return stat(path.c_str(), &info) == 0 ? info.st_size : -1;
+    }
+}
+
+int main() {
+    char directory[] = "/tmp/compiledLayoutStoreTestXXXXXX";
+    if (!mkdtemp(directory)) return 1;
+    std::string indexPath = std::string(directory) + "/layouts.idx";
+    std::string dataPath = std::string(directory) + "/layouts.dat";
+    constexpr size_t BOUND = CompiledLayoutStore::MIN_BYTES;
+
+    {
+        CompiledLayoutStore store;
+        check(store.open(directory, BOUND), "open creates the store");
+        check(!holds(store, 1, 500), "empty store misses");
+        check(put(store, 1, 500) && holds(store, 1, 500), "stored payload hits");
+        std::vector<uint8_t> key = keyOf(1);
+        std::vector<uint8_t> payload;
+        check(!store.find(KIND + 1, key.data(), key.size(), payload) && payload.empty(),
+              "other kind misses");
+        check(put(store, 1, 700) && holds(store, 1, 700) && store.recordCount() == 1,
+              "a second put replaces the record");
+        check(!put(store, 2, BOUND), "a payload over the bound is refused");
+    }
+    {
+        CompiledLayoutStore store;
+        check(store.open(directory, BOUND), "reopen");
+        check(holds(store, 1, 700), "record persists across reopen");
+        check(put(store, 3, 300), "append after reopen");
+    }
+    {
+        CompiledLayoutStore store;
+        check(store.open(directory, BOUND), "open before reopening in place");
+        check(store.open(directory, BOUND) && holds(store, 1, 700) && mappingsOf(dataPath) == 1,
+              "opening the open directory again keeps the store");
+
+        char other[] = "/tmp/compiledLayoutStoreTestXXXXXX";
+        check(mkdtemp(other) && store.open(other, BOUND), "open another directory");
+        check(!holds(store, 1, 700), "the other store starts empty");
+        check(mappingsOf(dataPath) == 0, "switching stores unmaps the previous data file");
+        store.close();
+        unlink((std::string(other) + "/layouts.idx").c_str());
+        unlink((std::string(other) + "/layouts.dat").c_str());
+        rmdir(other);
+    }
+    {
+        // Flip one payload byte of record 3, the last one in the data file
+        int fd = ::open(dataPath.c_str(), O_RDWR);
+        off_t end = lseek(fd, 0, SEEK_END);
+        uint8_t byte = 0;
+        bool flipped = pread(fd, &byte, 1, end - 16) == 1;
+        byte ^= 0xFF;
+        flipped = flipped && pwrite(fd, &byte, 1, end - 16) == 1;
+        ::close(fd);
+
+        CompiledLayoutStore store;
+        check(flipped && store.open(directory, BOUND), "reopen after corruption");
+        check(!holds(store, 3, 300), "corrupted record fails its checksum");
+        check(holds(store, 1, 700), "intact record still hits");
+    }
+    {
+        CompiledLayoutStore store;
+        check(store.open(directory, BOUND), "reopen for compaction");
+        bool allStored = true;
+        for (int id = 10; id < 40; id++) {
+            allStored = put(store, id, 6000) && allStored;
+            // Keeps record 1 the most recently used
+            check(holds(store, 1, 700), "hot record survives compaction");
+        }
+        check(allStored, "appends past the bound compact instead of failing");
+        check(fileSize(dataPath) <= static_cast<off_t>(BOUND) && store.liveBytes() <= BOUND,
+              "data file stays within the bound");
+        check(!holds(store, 10, 6000) && holds(store, 39, 6000),
+              "compaction drops the least recently used records");
+    }
+    {
+        CompiledLayoutStore store;
+        check(store.open(directory, BOUND), "reopen after compaction");
+        check(holds(store, 1, 700) && holds(store, 39, 6000), "compacted store persists");
+    }
+    {
+        int fd = ::open(indexPath.c_str(), O_WRONLY);
+        ssize_t written = write(fd, "JUNK", 4);
+        ::close(fd);
+        CompiledLayoutStore store;
+        check(written == 4 && store.open(directory, BOUND), "foreign index reopens");
+        check(!holds(store, 1, 700) && store.recordCount() == 0, "foreign index is reset");
+        check(put(store, 1, 700) && holds(store, 1, 700), "reset store takes records");
+    }
+    {
+        // Compacts every few appends; the replaced data files must not stay mapped
+        CompiledLayoutStore store;
+        check(store.open(directory, BOUND), "reopen for repeated compaction");
+        bool allStored = true;
+        for (int id = 100; id < 400; id++) allStored = put(store, id, 6000) && allStored;
+        check(allStored && holds(store, 399, 6000), "repeated compaction keeps storing");
+        check(mappingsOf(dataPath) == 1, "compaction unmaps the replaced data files");
+    }
+
+    unlink(indexPath.c_str());
+    unlink(dataPath.c_str());
+    rmdir(directory);
+    std::printf("CompiledLayoutStore %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,378 @@
+/**
+ * Host tool that builds a LayoutBundle from a directory of layout XML files:
+ *
+ *     layoutBundleTool <xml-directory> <output-bundle>
+ *     layoutBundleTool --compile <layout.xml> <layout.vft>
+ *     layoutBundleTool --pack <tree-directory> <output-bundle>
+ *
+ * Each `name.xml` becomes the layout `name`, compiled to a flat tree exactly as the
+ * device's FlatTreeSink would (text dropped, namespace prefixes removed) and keyed by the
+ * SHA256 of its bytes. Files are taken in name order, so the same inputs always give the
+ * same bundle. Any malformed file fails the whole build.
+ *
+ * `--compile` and `--pack` split that in two for incremental builds (the Gradle plugin's
+ * PrecompileLayoutsTask): each changed layout is compiled on its own to a `.vft` flat
+ * tree, and packing the trees, which carry their hash, parses nothing. Both paths give
+ * byte-identical bundles.
+ *
+ * `--verify` builds bundles from generated layouts and checks that every layout is found
+ * by name and matches a direct compile, that records are 64-byte aligned, that misses and
+ * damaged bundles are reported, that a bundle embedded at an unaligned offset (as an
+ * asset inside an APK) opens through the descriptor path, and that compile-then-pack
+ * matches a direct build.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "../layoutBundle.h"
+#include "../flatTreeBuilder.h"
+#include "../sha256.h"
+
+#include <expat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    int failures = 0;
+
+    // Flat tree header fields read back by --pack, see flatTreeBuilder.h
+    constexpr uint32_t TREE_MAGIC = 0x31544656;  // "VFT1"
+    constexpr size_t TREE_HEADER_SIZE = 28;
+
+    void expect(bool condition, const char *what) {
+        if (!condition) {
+            std::printf("FAIL %s\n", what);
+            failures++;
+        }
+    }
+
+    struct Compile {
+        FlatTreeBuilder *builder;
+
+        static void XMLCALL onStart(void *userData, const char *name, const char **attributes) {
+            static_cast<Compile *>(userData)->builder->startElement(name, attributes);
+        }
+
+        static void XMLCALL onEnd(void *userData, const char * /* name */) {
+            static_cast<Compile *>(userData)->builder->endElement();
+        }
+    };
+
+    /**
+     * Compiles one document to a flat tree carrying its SHA256; on a parse error returns
+     * false and describes it in `error`.
+     */
+    bool compile(const std::string &document, std::vector<uint8_t> &tree, uint8_t *hash,
+                 std::string &error) {
+        SHA256 sha;
+        sha.update(reinterpret_cast<const uint8_t *>(document.data()), document.size());
+        sha.final(hash);
+
+        Arena arena;
+        InternTable strings;
+        FlatTreeBuilder builder(arena, strings);
+        Compile compile{&builder};
+        XML_Parser parser = XML_ParserCreate(nullptr);
+        XML_SetUserData(parser, &compile);
+        XML_SetElementHandler(parser, Compile::onStart, Compile::onEnd);
+        bool parsed = XML_Parse(parser, document.data(), static_cast<int>(document.size()),
+                                XML_TRUE) == XML_STATUS_OK;
+        if (!parsed) {
+            error = std::string(XML_ErrorString(XML_GetErrorCode(parser))) + " at line " +
+                    std::to_string(XML_GetCurrentLineNumber(parser));
+        }
+        XML_ParserFree(parser);
+        if (!parsed) return false;
+        if (builder.nodeCount() == 0) {
+            error = "no root element";
+            return false;
+        }
+        tree.resize(builder.serializedSize(SHA256::DIGEST_LENGTH));
+        builder.serialize(tree.data(), hash, SHA256::DIGEST_LENGTH);
+        return true;
+    }
+
+    bool readFile(const std::string &path, std::string &content) {
+        FILE *file = std::fopen(path.c_str(), "rb");
+        if (!file) return false;
+        char buffer[64 * 1024];
+        size_t read;
+        content.clear();
+        while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) content.append(buffer, read);
+        bool ok = !std::ferror(file);
+        std::fclose(file);
+        return ok;
+    }
+
+    bool writeFile(const std::string &path, const uint8_t *data, size_t size) {
+        FILE *file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+        bool ok = std::fwrite(data, 1, size, file) == size;
+        return std::fclose(file) == 0 && ok;
+    }
+
+    // Names of the files directly inside `directory` ending in `suffix`, sorted
+    bool listFiles(const std::string &directory, const char *suffix,
+                   std::vector<std::string> &files) {
+        DIR *dir = opendir(directory.c_str());
+        if (!dir) {
+            std::fprintf(stderr, "Cannot open %s\n", directory.c_str());
+            return false;
+        }
+        size_t suffixLength = std::strlen(suffix);
+        while (dirent *entry = readdir(dir)) {
+            std::string file = entry->d_name;
+            if (file.size() > suffixLength &&
+                file.compare(file.size() - suffixLength, suffixLength, suffix) == 0) {
+                files.push_back(file);
+            }
+        }
+        closedir(dir);
+        std::sort(files.begin(), files.end());
+        return true;
+    }
+
+    bool writeBundle(const LayoutBundleWriter &writer, size_t layouts, const std::string &output) {
+        std::vector<uint8_t> bundle;
+        writer.write(bundle);
+        if (!writeFile(output, bundle.data(), bundle.size())) {
+            std::fprintf(stderr, "Cannot write %s\n", output.c_str());
+            return false;
+        }
+        std::printf("%zu layouts, %zu bytes\n", layouts, bundle.size());
+        return true;
+    }
+
+    // Compiles the layout at `input` to a flat tree; returns false after reporting why
+    bool compileFile(const std::string &input, std::vector<uint8_t> &tree, uint8_t *hash) {
+        std::string document;
+        std::string error;
+        if (!readFile(input, document)) {
+            std::fprintf(stderr, "Cannot read %s\n", input.c_str());
+            return false;
+        }
+        if (!compile(document, tree, hash, error)) {
+            std::fprintf(stderr, "%s: %s\n", input.c_str(), error.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Builds `output` from every *.xml directly inside `directory`; returns the exit code
+    int build(const std::string &directory, const std::string &output) {
+        std::vector<std::string> files;
+        if (!listFiles(directory, ".xml", files)) return 1;
+
+        LayoutBundleWriter writer(0);  // ContentFingerprint.SHA256
+        for (const std::string &file: files) {
+            std::vector<uint8_t> tree;
+            uint8_t hash[SHA256::DIGEST_LENGTH];
+            if (!compileFile(directory + "/" + file, tree, hash)) return 1;
+            writer.add(file.substr(0, file.size() - 4), std::move(tree), hash, sizeof(hash));
+        }
+        return writeBundle(writer, files.size(), output) ? 0 : 1;
+    }
+
+    // Compiles one layout to the flat tree `output` for a later --pack; returns the exit code
+    int compileOne(const std::string &input, const std::string &output) {
+        std::vector<uint8_t> tree;
+        uint8_t hash[SHA256::DIGEST_LENGTH];
+        if (!compileFile(input, tree, hash)) return 1;
+        if (!writeFile(output, tree.data(), tree.size())) {
+            std::fprintf(stderr, "Cannot write %s\n", output.c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+    // Builds `output` from every *.vft inside `directory`, as written by --compile
+    int pack(const std::string &directory, const std::string &output) {
+        std::vector<std::string> files;
+        if (!listFiles(directory, ".vft", files)) return 1;
+
+        LayoutBundleWriter writer(0);
+        for (const std::string &file: files) {
+            std::string content;
+            if (!readFile(directory + "/" + file, content)) {
+                std::fprintf(stderr, "Cannot read %s\n", file.c_str());
+                return 1;
+            }
+            const auto *data = reinterpret_cast<const uint8_t *>(content.data());
+            uint32_t magic = 0;
+            uint16_t hashLength = 0;
+            if (content.size() >= TREE_HEADER_SIZE) {
+                std::memcpy(&magic, data, sizeof(magic));
+                std::memcpy(&hashLength, data + 6, sizeof(hashLength));
+            }
+            if (magic != TREE_MAGIC || hashLength > LayoutBundle::MAX_HASH_LENGTH ||
+                content.size() < TREE_HEADER_SIZE + hashLength) {
+                std::fprintf(stderr, "%s: not a flat tree\n", file.c_str());
+                return 1;
+            }
+            writer.add(file.substr(0, file.size() - 4),
+                       std::vector<uint8_t>(data, data + content.size()),
+                       data + TREE_HEADER_SIZE, hashLength);
+        }
+        return writeBundle(writer, files.size(), output) ? 0 : 1;
+    }
+
+    bool sameFile(const std::string &a, const std::string &b) {
+        std::string first;
+        std::string second;
+        return readFile(a, first) && readFile(b, second) && first == second;
+    }
+
+    std::string makeDocument(size_t rows) {
+        std::string xml = "<LinearLayout xmlns:android=\"http://schemas.android.com/apk/res/android\""
+                          " android:orientation=\"vertical\">";
+        for (size_t r = 0; r < rows; r++) {
+            xml += "<TextView android:id=\"@+id/label" + std::to_string(r) +
+                   "\" android:text=\"Row " + std::to_string(r) + "\">Text</TextView>";
+        }
+        return xml + "</LinearLayout>";
+    }
+
+    int verify() {
+        constexpr size_t LAYOUTS = 300;
+        LayoutBundleWriter writer(0);
+        std::vector<std::string> names;
+        std::vector<std::vector<uint8_t>> trees;
+        // Added out of order: the writer sorts
+        for (size_t i = LAYOUTS; i-- > 0;) {
+            std::string name = "layout_" + std::to_string(i);
+            std::vector<uint8_t> tree;
+            uint8_t hash[SHA256::DIGEST_LENGTH];
+            std::string error;
+            expect(compile(makeDocument(i % 40), tree, hash, error), "layout compiles");
+            expect(writer.add(name, tree, hash, sizeof(hash)), "layout added");
+            names.push_back(name);
+            trees.push_back(tree);
+        }
+        expect(!writer.add(names[0], trees[0], nullptr, 0), "duplicate name refused");
+        std::string error;
+        std::vector<uint8_t> tree;
+        uint8_t hash[SHA256::DIGEST_LENGTH];
+        expect(!compile("<a><b></a>", tree, hash, error) && !error.empty(),
+               "malformed layout reported");
+
+        std::vector<uint8_t> bundle;
+        writer.write(bundle);
+
+        char directory[] = "/tmp/layoutBundleToolXXXXXX";
+        if (!mkdtemp(directory)) return 1;
+        std::string path = std::string(directory) + "/layouts.bundle";
+        expect(writeFile(path, bundle.data(), bundle.size()), "bundle written");
+
+        LayoutBundle opened;
+        expect(opened.open(path.c_str()) && opened.size() == LAYOUTS, "bundle opens");
+        const uint8_t *base = nullptr;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < names.size(); i++) {
+            LayoutBundle::Record record{};
+            if (!opened.find(names[i], record) || record.length != trees[i].size() ||
+                std::memcmp(record.data, trees[i].data(), record.length) != 0) {
+                std::printf("FAIL %s differs from a direct compile\n", names[i].c_str());
+                failures++;
+                break;
+            }
+            if (!base) base = record.data;
+            expect((record.data - base) % LayoutBundle::RECORD_ALIGNMENT == 0,
+                   "records are 64-byte aligned");
+        }
+        double micros = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count();
+        LayoutBundle::Record record{};
+        expect(!opened.find("layout_", record) && !opened.find("layout_3000", record) &&
+               !opened.find("", record), "unknown names miss");
+        for (uint32_t i = 1; i < opened.size(); i++) {
+            expect(opened.name(i - 1) < opened.name(i), "names are sorted");
+        }
+
+        // As an asset inside an APK: at an unaligned offset, followed by other data
+        std::string embeddedPath = std::string(directory) + "/embedded";
+        std::vector<uint8_t> embedded(4099, 0x5A);
+        embedded.insert(embedded.end(), bundle.begin(), bundle.end());
+        embedded.resize(embedded.size() + 100, 0x5A);
+        expect(writeFile(embeddedPath, embedded.data(), embedded.size()), "embedded written");
+        int fd = ::open(embeddedPath.c_str(), O_RDONLY);
+        LayoutBundle asset;
+        expect(asset.open(fd, 4099, static_cast<int64_t>(bundle.size())) &&
+               asset.find(names[7], record) && record.length == trees[7].size() &&
+               std::memcmp(record.data, trees[7].data(), record.length) == 0,
+               "bundle opens at an unaligned offset");
+        ::close(fd);
+
+        std::vector<uint8_t> damaged(bundle);
+        damaged[0] ^= 0xFF;
+        expect(writeFile(path, damaged.data(), damaged.size()) && !opened.open(path.c_str()),
+               "bad magic rejected");
+        damaged = bundle;
+        damaged.resize(damaged.size() - 64);
+        expect(writeFile(path, damaged.data(), damaged.size()) && !opened.open(path.c_str()),
+               "truncated bundle rejected");
+
+        // Compile-then-pack, as the Gradle task runs it, against a direct build
+        std::string sources = std::string(directory) + "/xml";
+        std::string treeDirectory = std::string(directory) + "/trees";
+        std::string direct = std::string(directory) + "/direct.bundle";
+        std::string packed = std::string(directory) + "/packed.bundle";
+        mkdir(sources.c_str(), 0700);
+        mkdir(treeDirectory.c_str(), 0700);
+        bool split = true;
+        for (size_t i = 0; i < 5; i++) {
+            std::string document = makeDocument(i * 3);
+            std::string xml = sources + "/screen_" + std::to_string(i) + ".xml";
+            std::string tree = treeDirectory + "/screen_" + std::to_string(i) + ".vft";
+            split = writeFile(xml, reinterpret_cast<const uint8_t *>(document.data()),
+                              document.size()) && compileOne(xml, tree) == 0 && split;
+        }
+        expect(split && build(sources, direct) == 0 && pack(treeDirectory, packed) == 0 &&
+               sameFile(direct, packed), "compile-then-pack matches a direct build");
+        std::string junk = treeDirectory + "/junk.vft";
+        expect(writeFile(junk, reinterpret_cast<const uint8_t *>("JUNK"), 4) &&
+               pack(treeDirectory, packed) != 0, "a file that is not a flat tree fails the pack");
+        unlink(junk.c_str());
+        for (size_t i = 0; i < 5; i++) {
+            std::string name = "screen_" + std::to_string(i);
+            unlink((sources + "/" + name + ".xml").c_str());
+            unlink((treeDirectory + "/" + name + ".vft").c_str());
+        }
+        unlink(direct.c_str());
+        unlink(packed.c_str());
+        rmdir(sources.c_str());
+        rmdir(treeDirectory.c_str());
+
+        unlink(path.c_str());
+        unlink(embeddedPath.c_str());
+        rmdir(directory);
+        std::printf("%zu layouts in %zu bytes, %.2f us per lookup\n", LAYOUTS, bundle.size(),
+                    micros / LAYOUTS);
+        std::printf("LayoutBundle %s\n", failures ? "FAILED" : "ok");
+        return failures ? 1 : 0;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc == 2 && std::strcmp(argv[1], "--verify") == 0) return verify();
+    if (argc == 4 && std::strcmp(argv[1], "--compile") == 0) return compileOne(argv[2], argv[3]);
+    if (argc == 4 && std::strcmp(argv[1], "--pack") == 0) return pack(argv[2], argv[3]);
+    if (argc != 3) {
+        std::fprintf(stderr,
+                     "Usage: %s <xml-directory> <output-bundle>\n"
+                     "       %s --compile <layout.xml> <layout.vft>\n"
+                     "       %s --pack <tree-directory> <output-bundle>\n"
+                     "       %s --verify\n", argv[0], argv[0], argv[0], argv[0]);
+        return 2;
+    }
+    return build(argv[1], argv[2]);
+}
@@ -0,0 +1,226 @@
+/**
+ * Host benchmark for ParsePool: parses a set of generated layouts into flat trees on 1..N
+ * workers and reports documents per second and the speedup over one worker.
+ *
+ * Each worker runs the same JNI-free pipeline as a batch parse on the device: a pooled
+ * Expat parser on a SlabHeap, FlatTreeBuilder on the worker's arena, and SHA256 of the
+ * input. `--verify` checks on a few workers that every tree matches a single-threaded
+ * parse, byte for byte, that priorities, boosting and cancellation are honoured, and that
+ * jobs still queued when the pool is destroyed are cancelled.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "../flatTreeBuilder.h"
+#include "../parsePool.h"
+#include "../sha256.h"
+#include "../slabHeap.h"
+
+#include <expat.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace {
+    // The per-thread state a ParserSession keeps on the device
+    struct WorkerSession {
+        SlabHeap heap;
+        XML_Parser parser = nullptr;
+        Arena arena;
+        InternTable strings;
+        FlatTreeBuilder *builder = nullptr;
+
+        ~WorkerSession() {
+            if (parser) XML_ParserFree(parser);
+        }
+    };
+
+    void XMLCALL onStart(void *userData, const char *name, const char **attributes) {
+        static_cast<WorkerSession *>(userData)->builder->startElement(name, attributes);
+    }
+
+    void XMLCALL onEnd(void *userData, const char *) {
+        static_cast<WorkerSession *>(userData)->builder->endElement();
+    }
+
+    std::vector<uint8_t> parseToFlatTree(const std::string &document) {
+        static const XML_Memory_Handling_Suite suite = {
+                SlabHeap::suiteMalloc, SlabHeap::suiteRealloc, SlabHeap::suiteFree};
+        thread_local WorkerSession session;
+
+        SlabHeap::Scope scope(session.heap);
+        if (!session.parser || !XML_ParserReset(session.parser, nullptr)) {
+            session.parser = XML_ParserCreate_MM(nullptr, &suite, nullptr);
+        }
+        session.arena.reset();
+        session.strings.clear();
+        FlatTreeBuilder builder(session.arena, session.strings);
+        session.builder = &builder;
+        XML_SetUserData(session.parser, &session);
+        XML_SetElementHandler(session.parser, onStart, onEnd);
+
+        SHA256 sha256;
+        sha256.update(reinterpret_cast<const uint8_t *>(document.data()), document.size());
+        uint8_t hash[SHA256::DIGEST_LENGTH];
+        sha256.final(hash);
+
+        std::vector<uint8_t> tree;
+        if (XML_Parse(session.parser, document.data(), static_cast<int>(document.size()),
+                      XML_TRUE) == XML_STATUS_OK) {
+            tree.resize(builder.serializedSize(sizeof(hash)));
+            builder.serialize(tree.data(), hash, sizeof(hash));
+        }
+        session.builder = nullptr;
+        return tree;
+    }
+
+    std::vector<std::string> makeDocuments(size_t count) {
+        std::vector<std::string> documents;
+        documents.reserve(count);
+        for (size_t d = 0; d < count; d++) {
+            std::string xml = "<LinearLayout xmlns:android=\"http://schemas.android.com/apk/res/android\""
+                              " android:layout_width=\"match_parent\" android:orientation=\"vertical\">";
+            size_t rows = 20 + (d * 37) % 120;  // Mixed sizes, like a real layout set
+            for (size_t r = 0; r < rows; r++) {
+                xml += "<LinearLayout android:orientation=\"horizontal\"><ImageView android:id=\"@+id/icon" +
+                       std::to_string(r) + "\" android:src=\"@drawable/ic_" + std::to_string(r % 9) +
+                       "\"/><TextView android:id=\"@+id/label" + std::to_string(r) +
+                       "\" android:text=\"Row " + std::to_string(d) + "." + std::to_string(r) +
+                       "\" android:textSize=\"14sp\"/></LinearLayout>";
+            }
+            xml += "</LinearLayout>";
+            documents.push_back(std::move(xml));
+        }
+        return documents;
+    }
+
+    // Parses every document on `pool` and returns the trees by index
+    std::vector<std::vector<uint8_t>> parseAll(ParsePool &pool,
+                                               const std::vector<std::string> &documents) {
+        std::vector<std::vector<uint8_t>> trees(documents.size());
+        CompletionQueue completions;
+        std::vector<ParsePool::Task> tasks;
+        for (size_t i = 0; i < documents.size(); i++) {
+            tasks.emplace_back([&, i] {
+                trees[i] = parseToFlatTree(documents[i]);
+                completions.push(i);
+            });
+        }
+        pool.submit(std::move(tasks), ParsePriority::Immediate);
+        for (size_t i = 0; i < documents.size(); i++) completions.pop();
+        return trees;
+    }
+
+    // Runs jobs on one worker held busy by a gate, so the queue order is fully decided
+    bool verifyScheduling() {
+        ParsePool pool(1);
+        std::promise<void> release;
+        std::shared_future<void> gate = release.get_future().share();
+        std::promise<void> gateRunning;
+        pool.submit([&] { gateRunning.set_value(); gate.wait(); }, ParsePriority::Immediate);
+        gateRunning.get_future().wait();
+
+        std::vector<int> order;
+        CompletionQueue completions;
+        auto job = [&](int id) {
+            return [&, id] { order.push_back(id); completions.push(id); };
+        };
+        int cancelled = 0;
+        auto onCancel = [&] { cancelled++; completions.push(0); };
+        pool.submit(job(1), ParsePriority::Prefetch, onCancel);
+        JobHandle boosted = pool.submit(job(2), ParsePriority::Prefetch, onCancel);
+        pool.submit(job(3), ParsePriority::VisibleSoon, onCancel);
+        pool.submit(job(4), ParsePriority::Immediate, onCancel);
+        JobHandle dropped = pool.submit(job(5), ParsePriority::VisibleSoon, onCancel);
+
+        bool ok = pool.boost(boosted, ParsePriority::Immediate) &&
+                  !pool.boost(boosted, ParsePriority::VisibleSoon) &&
+                  pool.cancel(dropped) && !pool.cancel(dropped) &&
+                  pool.cancelQueued(ParsePriority::Prefetch) == 1;
+        release.set_value();
+        for (int i = 0; i < 5; i++) completions.pop();
+
+        // One worker pops its own queues from the back, newest first
+        ok = ok && order == std::vector<int>{2, 4, 3} && cancelled == 2 && boosted->started();
+        if (!ok) std::printf("FAIL scheduling order or cancellation\n");
+        return ok;
+    }
+
+    // Jobs still queued when the pool is destroyed are cancelled, never silently dropped
+    bool verifyShutdown() {
+        constexpr int JOBS = 5;
+        std::atomic<int> ran{0};
+        std::atomic<int> cancelled{0};
+        std::promise<void> release;
+        std::shared_future<void> gate = release.get_future().share();
+        std::thread releaser;
+        {
+            ParsePool pool(1);
+            std::promise<void> gateRunning;
+            pool.submit([&] { gateRunning.set_value(); gate.wait(); }, ParsePriority::Immediate);
+            gateRunning.get_future().wait();
+            for (int i = 0; i < JOBS; i++) {
+                pool.submit([&] { ran++; }, ParsePriority::Prefetch, [&] { cancelled++; });
+            }
+            // Let the destructor start stopping the worker before the gate opens
+            releaser = std::thread([&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                release.set_value();
+            });
+        }
+        releaser.join();
+        int answered = ran.load() + cancelled.load();
+        bool ok = answered == JOBS;
+        if (!ok) std::printf("FAIL %d of %d queued jobs never heard back\n", JOBS - answered, JOBS);
+        return ok;
+    }
+}
+
+int main(int argc, char **argv) {
+    bool verifyOnly = argc > 1 && std::strcmp(argv[1], "--verify") == 0;
+    std::vector<std::string> documents = makeDocuments(300);
+
+    std::vector<std::vector<uint8_t>> expected(documents.size());
+    for (size_t i = 0; i < documents.size(); i++) expected[i] = parseToFlatTree(documents[i]);
+
+    if (verifyOnly) {
+        for (size_t threads: {1, 3, 8}) {
+            ParsePool pool(threads);
+            for (int round = 0; round < 3; round++) {
+                if (parseAll(pool, documents) != expected) {
+                    std::printf("FAIL trees differ on %zu workers\n", threads);
+                    return 1;
+                }
+            }
+        }
+        if (!verifyScheduling() || !verifyShutdown()) return 1;
+        std::printf("ParsePool ok\n");
+        return 0;
+    }
+
+    size_t bytes = 0;
+    for (const std::string &document: documents) bytes += document.size();
+    std::printf("%zu documents, %.1f KB total, %u hardware threads\n", documents.size(),
+                bytes / 1024.0, std::thread::hardware_concurrency());
+
+    double single = 0;
+    size_t maxThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        ParsePool pool(threads);
+        parseAll(pool, documents);  // Warm up each worker's session
+        constexpr int ROUNDS = 10;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < ROUNDS; round++) parseAll(pool, documents);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double rate = ROUNDS * documents.size() / seconds;
+        if (threads == 1) single = rate;
+        std::printf("%2zu workers: %9.0f docs/s  speedup %.2fx\n", threads, rate, rate / single);
+        if (threads < maxThreads && threads * 2 > maxThreads) threads = maxThreads / 2;
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * Host check for the read-ahead building blocks: a reader and a parser thread moving a
+ * byte sequence through ChunkRing intact and in order, cancellation waking a blocked
+ * reader, and ChunkSizer growing and shrinking with the stream.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "../readAhead.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char *what) {
+        if (!condition) {
+            std::printf("FAIL %s\n", what);
+            failures++;
+        }
+    }
+
+    void checkTransfer() {
+        constexpr size_t TOTAL = 1000 * 1000;
+        ChunkRing ring;
+        std::thread reader([&] {
+            size_t sent = 0;
+            size_t chunk = 1;
+            while (true) {
+                ChunkRing::Slot *slot = ring.acquireFree();
+                if (!slot) return;
+                size_t length = std::min(chunk, TOTAL - sent);
+                slot->data.resize(length);
+                for (size_t i = 0; i < length; i++) slot->data[i] = static_cast<char>((sent + i) % 251);
+                slot->length = length;
+                sent += length;
+                slot->last = sent == TOTAL;
+                ring.publish();
+                if (sent == TOTAL) return;
+                chunk = chunk * 3 % 7919 + 1;  // Uneven chunk sizes
+            }
+        });
+
+        size_t received = 0;
+        bool intact = true;
+        while (true) {
+            ChunkRing::Slot *slot = ring.acquireFilled();
+            if (!slot) break;
+            for (size_t i = 0; i < slot->length; i++) {
+                intact = intact && slot->data[i] == static_cast<char>((received + i) % 251);
+            }
+            received += slot->length;
+            bool last = slot->last;
+            ring.release();
+            if (last) break;
+        }
+        reader.join();
+        check(intact && received == TOTAL, "every byte arrives once, in order");
+    }
+
+    void checkCancel() {
+        ChunkRing ring(2);
+        std::thread reader([&] {
+            // Fills both slots, then blocks on the third until the parser cancels
+            while (ChunkRing::Slot *slot = ring.acquireFree()) {
+                slot->length = 0;
+                ring.publish();
+            }
+        });
+        ChunkRing::Slot *first = ring.acquireFilled();
+        check(first != nullptr, "a published slot is handed to the parser");
+        ring.cancel();
+        reader.join();
+        check(ring.acquireFilled() == nullptr, "a cancelled ring hands out nothing");
+    }
+
+    void checkSizer() {
+        ChunkSizer sizer(4096, 65536);
+        sizer.observe(4096, 4096);
+        check(sizer.next() == 8192, "a full read doubles the chunk");
+        for (int i = 0; i < 10; i++) sizer.observe(sizer.next(), sizer.next());
+        check(sizer.next() == 65536, "growth stops at the maximum");
+        sizer.observe(65536, 9000);
+        check(sizer.next() == 16384, "a short read fits the chunk to what arrived");
+        sizer.observe(16384, 100);
+        check(sizer.next() == 4096, "the chunk never drops below the minimum");
+    }
+}
+
+int main() {
+    checkTransfer();
+    checkCancel();
+    checkSizer();
+    if (failures) return 1;
+    std::printf("ReadAhead ok\n");
+    return 0;
+}
@@ -0,0 +1,111 @@
+/**
+ * Host check and microbenchmark for the SHA256 backends.
+ *
+ * Verifies every backend this CPU supports against the NIST FIPS 180-2 example vectors
+ * (fed both at once and in odd-sized pieces), then reports hashing throughput per
+ * backend. `--verify` skips the benchmark; the exit status is non-zero on any mismatch.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "../sha256.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Vector {
+        std::string message;
+        const char *digest;
+    };
+
+    std::vector<Vector> nistVectors() {
+        return {
+                {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+                {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+                {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+                 "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+                {"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmno"
+                 "ijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+                 "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"},
+                {std::string(1000000, 'a'),
+                 "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+        };
+    }
+
+    std::string hex(const uint8_t *bytes, size_t length) {
+        static const char digits[] = "0123456789abcdef";
+        std::string out;
+        for (size_t i = 0; i < length; i++) {
+            out += digits[bytes[i] >> 4];
+            out += digits[bytes[i] & 0xF];
+        }
+        return out;
+    }
+
+    std::string digestOf(SHA256::Backend backend, const std::string &message, size_t piece) {
+        SHA256 sha(backend);
+        const auto *data = reinterpret_cast<const uint8_t *>(message.data());
+        for (size_t offset = 0; offset < message.size(); offset += piece) {
+            size_t length = message.size() - offset < piece ? message.size() - offset : piece;
+            sha.update(data + offset, length);
+        }
+        uint8_t hash[SHA256::DIGEST_LENGTH];
+        sha.final(hash);
+        return hex(hash, sizeof(hash));
+    }
+
+    bool verify(SHA256::Backend backend) {
+        bool ok = true;
+        for (const Vector &vector: nistVectors()) {
+            for (size_t piece: {size_t(1), size_t(63), size_t(65), size_t(8192), vector.message.size() + 1}) {
+                std::string actual = digestOf(backend, vector.message, piece);
+                if (actual != vector.digest) {
+                    std::printf("FAIL %s: %zu-byte message in %zu-byte pieces: %s\n",
+                                SHA256::backendName(backend), vector.message.size(), piece,
+                                actual.c_str());
+                    ok = false;
+                }
+            }
+        }
+        std::printf("%-14s NIST vectors %s\n", SHA256::backendName(backend), ok ? "ok" : "FAILED");
+        return ok;
+    }
+
+    void benchmark(SHA256::Backend backend, const std::vector<uint8_t> &input, int rounds) {
+        uint8_t hash[SHA256::DIGEST_LENGTH];
+        SHA256 sha(backend);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            sha.reset();
+            sha.update(input.data(), input.size());
+            sha.final(hash);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double megabytes = double(input.size()) * rounds / (1024.0 * 1024.0);
+        std::printf("%-14s %8.1f MB/s\n", SHA256::backendName(backend), megabytes / elapsed.count());
+    }
+}
+
+int main(int argc, char **argv) {
+    bool verifyOnly = argc > 1 && std::strcmp(argv[1], "--verify") == 0;
+    const SHA256::Backend backends[] = {SHA256::Backend::Portable, SHA256::Backend::ArmCrypto,
+                                        SHA256::Backend::ShaNi};
+
+    bool ok = true;
+    for (SHA256::Backend backend: backends) {
+        if (SHA256::isSupported(backend)) ok = verify(backend) && ok;
+    }
+    std::printf("default backend: %s\n", SHA256::backendName(SHA256::bestBackend()));
+    if (!ok || verifyOnly) return ok ? 0 : 1;
+
+    std::vector<uint8_t> input(16 * 1024 * 1024);
+    for (size_t i = 0; i < input.size(); i++) input[i] = static_cast<uint8_t>(i * 131 + 7);
+    for (SHA256::Backend backend: backends) {
+        if (SHA256::isSupported(backend)) benchmark(backend, input, 8);
+    }
+    return 0;
+}
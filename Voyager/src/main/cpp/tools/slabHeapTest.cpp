@@ -0,0 +1,134 @@
+/**
+ * Host check for SlabHeap: block reuse through the free lists, realloc within and across
+ * size classes, shrinking in place, large requests, and, when Expat is available, that a
+ * pooled parser running on the heap stops reaching malloc after its first document.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "../slabHeap.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef VOYAGER_TEST_EXPAT
+#include <expat.h>
+#endif
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char *what) {
+        if (!condition) {
+            std::printf("FAIL %s\n", what);
+            failures++;
+        }
+    }
+
+    void checkHeap() {
+        SlabHeap heap;
+        SlabHeap::Scope scope(heap);
+
+        void *first = SlabHeap::suiteMalloc(100);
+        std::memset(first, 0xAB, 100);
+        SlabHeap::suiteFree(first);
+        void *second = SlabHeap::suiteMalloc(120);
+        check(second == first, "a freed block is reused for the same size class");
+
+        void *same = SlabHeap::suiteRealloc(second, 128);
+        check(same == second, "realloc within the class keeps the block");
+        std::memset(same, 0x5A, 128);
+        auto *grown = static_cast<unsigned char *>(SlabHeap::suiteRealloc(same, 1000));
+        check(grown != same && grown[0] == 0x5A && grown[127] == 0x5A,
+              "realloc across classes moves the contents");
+
+        size_t before = heap.systemAllocations();
+        void *large = SlabHeap::suiteMalloc(SlabHeap::MAX_CLASS_SIZE + 1);
+        check(heap.systemAllocations() == before + 1, "large requests go to malloc");
+        check(heap.bytesReserved() >= SlabHeap::MAX_CLASS_SIZE, "large blocks count as reserved");
+        SlabHeap::suiteFree(large);
+        SlabHeap::suiteFree(grown);
+        check(heap.peakBytes() >= SlabHeap::MAX_CLASS_SIZE, "peak covers the large block");
+
+        heap.release();
+        heap.resetPeak();
+        check(heap.peakBytes() == 0, "release forgets every small block");
+    }
+
+    void checkShrinkThenFree() {
+        SlabHeap heap;
+        SlabHeap::Scope scope(heap);
+
+        void *block = SlabHeap::suiteMalloc(1000);
+        void *shrunk = SlabHeap::suiteRealloc(block, 20);
+        check(shrunk == block, "shrinking keeps the block");
+        SlabHeap::suiteFree(shrunk);
+        heap.resetPeak();
+        check(heap.peakBytes() == 0, "a shrunk block frees its whole class size");
+        check(SlabHeap::suiteMalloc(1000) == block,
+              "a shrunk block returns to the class it was carved from");
+        void *small = SlabHeap::suiteMalloc(20);
+        check(small != block, "a shrunk block is not handed out for its new size");
+    }
+
+    void checkUnscopedFallback() {
+        void *block = SlabHeap::suiteMalloc(64);
+        block = SlabHeap::suiteRealloc(block, 4096);
+        check(block != nullptr, "allocations outside a scope fall back to malloc");
+        SlabHeap::suiteFree(block);
+    }
+
+#ifdef VOYAGER_TEST_EXPAT
+    int elements = 0;
+
+    void XMLCALL onStart(void *, const char *, const char **) {
+        elements++;
+    }
+
+    void XMLCALL onEnd(void *, const char *) {}
+
+    void checkExpatSteadyState() {
+        std::string document = "<LinearLayout xmlns:android=\"ns\" android:orientation=\"vertical\">";
+        for (int i = 0; i < 200; i++) {
+            document += "<TextView android:id=\"@+id/t" + std::to_string(i) +
+                        "\" android:text=\"Item " + std::to_string(i) + "\"/>";
+        }
+        document += "</LinearLayout>";
+
+        const XML_Memory_Handling_Suite suite = {
+                SlabHeap::suiteMalloc, SlabHeap::suiteRealloc, SlabHeap::suiteFree};
+        SlabHeap heap;
+        SlabHeap::Scope scope(heap);
+        XML_Parser parser = XML_ParserCreate_MM(nullptr, &suite, nullptr);
+
+        size_t afterWarmup = 0;
+        for (int round = 0; round < 5; round++) {
+            if (round > 0) XML_ParserReset(parser, nullptr);
+            XML_SetElementHandler(parser, onStart, onEnd);
+            elements = 0;
+            bool ok = XML_Parse(parser, document.data(), static_cast<int>(document.size()),
+                                XML_TRUE) == XML_STATUS_OK;
+            check(ok && elements == 201, "Expat parses on the slab heap");
+            if (round == 1) afterWarmup = heap.systemAllocations();
+        }
+        check(heap.allocationCount() > 0, "Expat allocates through the suite");
+        check(heap.systemAllocations() == afterWarmup, "a pooled parser stops reaching malloc");
+        XML_ParserFree(parser);
+        std::printf("Expat: %zu suite calls, %zu from malloc, peak %zu bytes\n",
+                    heap.allocationCount(), heap.systemAllocations(), heap.peakBytes());
+    }
+#endif
+}
+
+int main() {
+    checkHeap();
+    checkShrinkThenFree();
+    checkUnscopedFallback();
+#ifdef VOYAGER_TEST_EXPAT
+    checkExpatSteadyState();
+#endif
+    if (failures) return 1;
+    std::printf("SlabHeap ok\n");
+    return 0;
+}
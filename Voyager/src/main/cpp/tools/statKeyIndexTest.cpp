@@ -0,0 +1,92 @@
+/**
+ * Host check for StatKeyIndex: hits, invalidation on a changed stat tuple, persistence
+ * across reopen, the racy-timestamp guard and recovery from a foreign index file.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "../statKeyIndex.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char *what) {
+        if (!condition) {
+            std::printf("FAIL %s\n", what);
+            failures++;
+        }
+    }
+
+    FileIdentity identityOf(const std::string &path) {
+        struct stat info{};
+        stat(path.c_str(), &info);
+        return FileIdentity::of(info);
+    }
+
+    // Writes `content` to `path` and backdates its mtime by `ageSeconds`
+    void writeFile(const std::string &path, const char *content, time_t ageSeconds) {
+        FILE *file = std::fopen(path.c_str(), "w");
+        std::fputs(content, file);
+        std::fclose(file);
+        timespec times[2] = {{0, UTIME_OMIT}, {std::time(nullptr) - ageSeconds, 123456789}};
+        utimensat(AT_FDCWD, path.c_str(), times, 0);
+    }
+}
+
+int main() {
+    char directory[] = "/tmp/statKeyIndexTestXXXXXX";
+    if (!mkdtemp(directory)) return 1;
+    std::string indexPath = std::string(directory) + "/index";
+    std::string layoutPath = std::string(directory) + "/layout.xml";
+
+    uint8_t hash[StatKeyIndex::MAX_HASH_LENGTH];
+    uint8_t digest[16];
+    for (int i = 0; i < 16; i++) digest[i] = static_cast<uint8_t>(0xC0 + i);
+
+    writeFile(layoutPath, "<LinearLayout/>", 60);
+    {
+        StatKeyIndex index;
+        check(index.open(indexPath.c_str()), "open creates the index");
+        FileIdentity file = identityOf(layoutPath);
+        check(index.lookup(file, 1, hash) == 0, "empty index misses");
+        index.record(file, 1, digest, sizeof(digest));
+        check(index.lookup(file, 1, hash) == sizeof(digest) && memcmp(hash, digest, 16) == 0,
+              "recorded entry hits");
+        check(index.lookup(file, 0, hash) == 0, "other fingerprint kind misses");
+    }
+    {
+        StatKeyIndex index;
+        check(index.open(indexPath.c_str()), "reopen");
+        check(index.lookup(identityOf(layoutPath), 1, hash) == sizeof(digest),
+              "entry persists across reopen");
+
+        writeFile(layoutPath, "<FrameLayout/>", 30);
+        check(index.lookup(identityOf(layoutPath), 1, hash) == 0, "changed file misses");
+
+        writeFile(layoutPath, "<FrameLayout/>", 0);
+        index.record(identityOf(layoutPath), 1, digest, sizeof(digest));
+        check(index.lookup(identityOf(layoutPath), 1, hash) == 0, "racy mtime is not recorded");
+    }
+    {
+        int fd = ::open(indexPath.c_str(), O_WRONLY);
+        ssize_t written = write(fd, "JUNK", 4);
+        ::close(fd);
+        StatKeyIndex index;
+        check(written == 4 && index.open(indexPath.c_str()), "foreign index reopens");
+        check(index.lookup(identityOf(layoutPath), 1, hash) == 0, "foreign index is reset");
+    }
+
+    unlink(indexPath.c_str());
+    unlink(layoutPath.c_str());
+    rmdir(directory);
+    std::printf("StatKeyIndex %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
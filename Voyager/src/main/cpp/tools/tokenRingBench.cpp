@@ -0,0 +1,336 @@
+/**
+ * Host benchmark for TokenRing: parses generated layouts on a producer thread into the
+ * ring while a consumer thread decodes the tokens and builds a node tree, against parsing
+ * and building on one thread as the synchronous `onToken` path does. Reports time to the
+ * first token and to the finished tree.
+ *
+ * `--verify` runs the ring at a few small capacities, so records wrap and both sides
+ * block on each other, and checks the decoded token sequence against Expat's own, both
+ * publishing every record and publishing whole subtrees of the root. In the latter mode
+ * it also checks that, when the ring never fills, the consumer only wakes at subtree
+ * boundaries. A record that wraps and is larger than the offset it would start at must
+ * still fit once the lap is released.
+ *
+ * The JNI cost that the ring saves on the device is not part of either side here.
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+#include "../tokenRing.h"
+
+#include <expat.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Stands in for ViewNode: what the consumer builds from the tokens
+    struct Node {
+        std::string type;
+        std::vector<std::pair<std::string, std::string>> attributes;
+        std::vector<size_t> children;
+    };
+
+    struct TreeBuilder {
+        std::vector<Node> nodes;
+        std::vector<size_t> open;
+        std::string transcript;
+        bool recordTranscript = false;
+        Clock::time_point firstToken{};
+        // Deepest element nesting the consumer was left at when it ran out of records
+        size_t deepestWake = 0;
+
+        void start(const std::string &type) {
+            if (nodes.empty()) firstToken = Clock::now();
+            if (!open.empty()) nodes[open.back()].children.push_back(nodes.size());
+            open.push_back(nodes.size());
+            nodes.push_back(Node{type, {}, {}});
+            if (recordTranscript) transcript += "<" + type;
+        }
+
+        void attribute(const std::string &key, const std::string &value) {
+            nodes.back().attributes.emplace_back(key, value);
+            if (recordTranscript) transcript += " " + key + "=" + value;
+        }
+
+        void end(const std::string &type) {
+            if (!open.empty()) open.pop_back();
+            if (recordTranscript) transcript += "</" + type + ">";
+        }
+
+        void text(const std::string &value) {
+            if (recordTranscript) transcript += "#" + value;
+        }
+    };
+
+    // The synchronous path: Expat callbacks build the tree directly
+    struct DirectParse {
+        TreeBuilder builder;
+        std::string textRun;
+
+        void flushText() {
+            if (!textRun.empty()) builder.text(textRun);
+            textRun.clear();
+        }
+
+        static void XMLCALL onStart(void *userData, const char *name, const char **attributes) {
+            auto *self = static_cast<DirectParse *>(userData);
+            self->flushText();
+            self->builder.start(name);
+            for (const char **attr = attributes; *attr; attr += 2) {
+                self->builder.attribute(localName(attr[0]), attr[1]);
+            }
+        }
+
+        static void XMLCALL onEnd(void *userData, const char *name) {
+            auto *self = static_cast<DirectParse *>(userData);
+            self->flushText();
+            self->builder.end(name);
+        }
+
+        static void XMLCALL onText(void *userData, const char *data, int length) {
+            static_cast<DirectParse *>(userData)->textRun.append(data, length);
+        }
+    };
+
+    void parseDirect(const std::string &document, TreeBuilder &builder) {
+        DirectParse parse;
+        parse.builder.recordTranscript = builder.recordTranscript;
+        XML_Parser parser = XML_ParserCreate(nullptr);
+        XML_SetUserData(parser, &parse);
+        XML_SetElementHandler(parser, DirectParse::onStart, DirectParse::onEnd);
+        XML_SetCharacterDataHandler(parser, DirectParse::onText);
+        XML_Parse(parser, document.data(), static_cast<int>(document.size()), XML_TRUE);
+        XML_ParserFree(parser);
+        builder = std::move(parse.builder);
+    }
+
+    // The producer side of the ring path, as RingTokenSink does it on the device
+    struct RingProducer {
+        TokenRingWriter *writer;
+        std::string textRun;
+        bool ok = true;
+
+        void flushText() {
+            if (!textRun.empty() && ok) ok = writer->text(textRun.data(), textRun.size());
+            textRun.clear();
+        }
+
+        static void XMLCALL onStart(void *userData, const char *name, const char **attributes) {
+            auto *self = static_cast<RingProducer *>(userData);
+            self->flushText();
+            if (self->ok) self->ok = self->writer->startElement(name, attributes);
+        }
+
+        static void XMLCALL onEnd(void *userData, const char *name) {
+            auto *self = static_cast<RingProducer *>(userData);
+            self->flushText();
+            if (self->ok) self->ok = self->writer->endElement(name);
+        }
+
+        static void XMLCALL onText(void *userData, const char *data, int length) {
+            static_cast<RingProducer *>(userData)->textRun.append(data, length);
+        }
+    };
+
+    void produce(const std::string &document, TokenRing &ring, uint32_t publishDepth) {
+        InternTable strings;
+        TokenRingWriter writer(ring, strings, publishDepth);
+        RingProducer producer{&writer, std::string(), true};
+        XML_Parser parser = XML_ParserCreate(nullptr);
+        XML_SetUserData(parser, &producer);
+        XML_SetElementHandler(parser, RingProducer::onStart, RingProducer::onEnd);
+        XML_SetCharacterDataHandler(parser, RingProducer::onText);
+        bool parsed = XML_Parse(parser, document.data(), static_cast<int>(document.size()),
+                                XML_TRUE) == XML_STATUS_OK;
+        XML_ParserFree(parser);
+        uint8_t hash[4] = {1, 2, 3, 4};
+        if (parsed && producer.ok) {
+            writer.complete(hash, sizeof(hash));
+        } else {
+            writer.fail();
+        }
+        ring.close();
+    }
+
+    uint32_t readU32(const uint8_t *in) {
+        return in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+    }
+
+    // Mirrors the Kotlin decoder; returns whether the parse completed
+    bool consume(TokenRing &ring, TreeBuilder &builder) {
+        std::vector<std::string> strings;
+        const uint8_t *data = ring.data();
+        size_t mask = ring.capacity() - 1;
+        uint64_t position = 0;
+        while (true) {
+            if (builder.open.size() > builder.deepestWake) builder.deepestWake = builder.open.size();
+            uint64_t end = ring.await(position);
+            if (end == position) return false;
+            while (position < end) {
+                const uint8_t *in = data + (position & mask);
+                const uint8_t *start = in;
+                switch (*in++) {
+                    case TokenRing::OP_PAD:
+                        position = (position | mask) + 1;
+                        continue;
+                    case TokenRing::OP_STRING: {
+                        uint32_t length = readU32(in + 4);
+                        strings.emplace_back(reinterpret_cast<const char *>(in + 8), length);
+                        in += 8 + length;
+                        break;
+                    }
+                    case TokenRing::OP_START_ELEMENT: {
+                        builder.start(strings[readU32(in)]);
+                        uint16_t count = in[4] | in[5] << 8;
+                        in += 6;
+                        for (uint16_t i = 0; i < count; i++, in += 8) {
+                            builder.attribute(strings[readU32(in)], strings[readU32(in + 4)]);
+                        }
+                        break;
+                    }
+                    case TokenRing::OP_END_ELEMENT:
+                        builder.end(strings[readU32(in)]);
+                        in += 4;
+                        break;
+                    case TokenRing::OP_TEXT:
+                        builder.text(strings[readU32(in)]);
+                        in += 4;
+                        break;
+                    case TokenRing::OP_COMPLETE:
+                        return true;
+                    default:
+                        return false;
+                }
+                position += in - start;
+            }
+        }
+    }
+
+    bool parseThroughRing(const std::string &document, size_t capacity, TreeBuilder &builder,
+                          uint32_t publishDepth = TokenRingWriter::PUBLISH_EVERY_RECORD) {
+        TokenRing ring(capacity);
+        std::thread producer([&] { produce(document, ring, publishDepth); });
+        bool completed = consume(ring, builder);
+        ring.cancel();
+        producer.join();
+        return completed;
+    }
+
+    /**
+     * A record that wraps and is bigger than the offset it would start at: waiting for
+     * its pad and itself at once would need more than the whole ring.
+     */
+    bool verifyLargeWrap() {
+        TokenRing ring(256);
+        uint8_t *first = ring.reserve(200);
+        if (!first) return false;
+        std::memset(first, TokenRing::OP_TEXT, 200);
+        ring.commit(200);
+        ring.publish();
+
+        std::thread producer([&] {
+            uint8_t *second = ring.reserve(220);
+            if (second) {
+                std::memset(second, TokenRing::OP_TEXT, 220);
+                ring.commit(220);
+            }
+            ring.close();
+        });
+        // Read everything published until the ring closes, skipping the pad
+        uint64_t position = 0;
+        uint64_t end;
+        while ((end = ring.await(position)) != position) position = end;
+        producer.join();
+        return position == 256 + 220;
+    }
+
+    std::string makeDocument(size_t rows) {
+        std::string xml = "<LinearLayout xmlns:android=\"http://schemas.android.com/apk/res/android\""
+                          " android:orientation=\"vertical\">";
+        for (size_t r = 0; r < rows; r++) {
+            xml += "<LinearLayout android:orientation=\"horizontal\"><ImageView android:id=\"@+id/icon" +
+                   std::to_string(r) + "\" android:src=\"@drawable/ic_" + std::to_string(r % 9) +
+                   "\"/><TextView android:id=\"@+id/label" + std::to_string(r) +
+                   "\" android:text=\"Row " + std::to_string(r) + "\">Label " + std::to_string(r) +
+                   "</TextView></LinearLayout>";
+        }
+        return xml + "</LinearLayout>";
+    }
+
+    double micros(Clock::duration duration) {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+}
+
+int main(int argc, char **argv) {
+    bool verifyOnly = argc > 1 && std::strcmp(argv[1], "--verify") == 0;
+
+    if (verifyOnly) {
+        std::string document = makeDocument(300);
+        TreeBuilder expected;
+        expected.recordTranscript = true;
+        parseDirect(document, expected);
+        for (uint32_t publishDepth: {TokenRingWriter::PUBLISH_EVERY_RECORD,
+                                     TokenRingWriter::PUBLISH_SUBTREES}) {
+            for (size_t capacity: {256, 1024, 64 * 1024}) {
+                TreeBuilder actual;
+                actual.recordTranscript = true;
+                if (!parseThroughRing(document, capacity, actual, publishDepth) ||
+                    actual.transcript != expected.transcript) {
+                    std::printf("FAIL tokens differ through a %zu byte ring (publish depth %u)\n",
+                                capacity, publishDepth);
+                    return 1;
+                }
+            }
+        }
+        TreeBuilder subtrees;
+        parseThroughRing(document, 1 << 20, subtrees, TokenRingWriter::PUBLISH_SUBTREES);
+        if (subtrees.deepestWake > TokenRingWriter::PUBLISH_SUBTREES) {
+            std::printf("FAIL the consumer woke inside a subtree (depth %zu)\n",
+                        subtrees.deepestWake);
+            return 1;
+        }
+        if (!verifyLargeWrap()) {
+            std::printf("FAIL a record wrapping past its own offset never fit\n");
+            return 1;
+        }
+        TreeBuilder broken;
+        if (parseThroughRing("<a><b></a>", 1024, broken)) {
+            std::printf("FAIL a malformed document completed\n");
+            return 1;
+        }
+        std::printf("TokenRing ok\n");
+        return 0;
+    }
+
+    std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+    for (size_t rows: {50, 500, 5000}) {
+        std::string document = makeDocument(rows);
+        constexpr int ROUNDS = 20;
+        double directTotal = 0, ringTotal = 0, directFirst = 0, ringFirst = 0;
+        for (int round = 0; round < ROUNDS; round++) {
+            TreeBuilder direct;
+            auto start = Clock::now();
+            parseDirect(document, direct);
+            directTotal += micros(Clock::now() - start);
+            directFirst += micros(direct.firstToken - start);
+
+            TreeBuilder ringTree;
+            start = Clock::now();
+            parseThroughRing(document, 64 * 1024, ringTree);
+            ringTotal += micros(Clock::now() - start);
+            ringFirst += micros(ringTree.firstToken - start);
+        }
+        std::printf("%6.1f KB: one thread %8.1f us (first token %6.1f us), ring %8.1f us "
+                    "(first token %6.1f us)\n", document.size() / 1024.0, directTotal / ROUNDS,
+                    directFirst / ROUNDS, ringTotal / ROUNDS, ringFirst / ROUNDS);
+    }
+    return 0;
+}
@@ -27,12 +27,39 @@
 #include <vector>
 #include <cstring>
 #include <expat.h>
+#define XXH_STATIC_LINKING_ONLY
+#include <xxhash.h>
 #include <rapidjson/prettywriter.h>
 #include <rapidjson/stringbuffer.h>
 #include <android/log.h>
+#include "internTable.h"
+#include "arena.h"
+#include "slabHeap.h"
+#include "flatTreeBuilder.h"
+#include "bytecodeCompiler.h"
+#include "parsePool.h"
+#include "readAhead.h"
+#include "tokenRing.h"
+#include "sha256.h"
+#include "statKeyIndex.h"
+#include "compiledLayoutStore.h"
+#include "layoutBundle.h"
 #include <cstdint>
 #include <string>
 #include <map>
+#include <mutex>
+#include <string_view>
+#include <algorithm>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
 
 // Define logging macros for Android
 #define LOG_TAG    "XMLParser"
@@ -47,418 +74,2693 @@ using namespace std;
 namespace {
     constexpr int BUFFER_SIZE = 8192;  // Increased buffer size for better performance
     constexpr int INITIAL_VECTOR_CAPACITY = 16;  // Pre-allocate vector capacity
-    constexpr int SHA256_DIGEST_LENGTH = 32;  // SHA256 produces 32 bytes
+    constexpr size_t MAX_DIGEST_LENGTH = SHA256::DIGEST_LENGTH;  // Longest fingerprint
+    constexpr size_t MAPPED_WINDOW_SIZE = 64 * 1024;  // Hash-then-parse window for mapped input
+    constexpr size_t CRITICAL_PIN_LIMIT = 1024 * 1024;  // Largest array parsed under one pin
+    constexpr size_t MAX_POOLED_SESSIONS = 2;  // Idle sessions kept per thread
+    constexpr size_t MAX_POOLED_SESSION_BYTES = 1024 * 1024;  // Retained memory per idle session
+    constexpr uint32_t SLICE_CLOCK_INTERVAL = 16;  // Element events between deadline checks
+    constexpr size_t READ_AHEAD_THRESHOLD = 32 * 1024;  // Stream bytes read inline before read-ahead
+    constexpr size_t READ_AHEAD_MAX_CHUNK = 256 * 1024;  // Largest read the read-ahead thread makes
 }
 
-// SHA256 implementation
-class SHA256 {
+/**
+ * Process-wide registry of the JNI classes and method IDs used by the parser.
+ *
+ * Resolved exactly once in JNI_OnLoad and held as global class references, so the
+ * per-token hot path never pays for FindClass/GetMethodID. If any lookup fails (for
+ * example, a Kotlin class renamed or stripped by R8) the library refuses to load with a
+ * single error naming the missing symbol.
+ */
+struct JniRegistry {
+    jclass startElementClass = nullptr;
+    jmethodID startElementConstructor = nullptr;
+    jclass endElementClass = nullptr;
+    jmethodID endElementConstructor = nullptr;
+    jclass textClass = nullptr;
+    jmethodID textConstructor = nullptr;
+    jclass arrayMapClass = nullptr;
+    jmethodID arrayMapConstructor = nullptr;
+    jmethodID arrayMapPut = nullptr;
+    jclass tokenStreamClass = nullptr;
+    jmethodID onTokenMethod = nullptr;
+    jmethodID onCompleteMethod = nullptr;
+    jmethodID onTokenBatchMethod = nullptr;
+    jclass flatTreeStreamClass = nullptr;
+    jmethodID onFlatTreeMethod = nullptr;
+    jclass cacheProbeClass = nullptr;
+    jmethodID isCachedMethod = nullptr;
+    jclass batchCallbackClass = nullptr;
+    jmethodID onBatchResultMethod = nullptr;
+    jclass jobCallbackClass = nullptr;
+    jmethodID onJobFinishedMethod = nullptr;
+    jclass inputStreamClass = nullptr;
+    jmethodID readMethod = nullptr;
+    jmethodID readRangeMethod = nullptr;
+    jclass stringClass = nullptr;
+};
+
+namespace {
+    JniRegistry g_jni;
+    JavaVM *g_vm = nullptr;
+
+    /**
+     * Counters describing how much JNI work the parser does per token.
+     * Accumulated per parse and folded into these totals once the parse ends.
+     */
+    struct JniStats {
+        atomic<uint64_t> parses{0};
+        atomic<uint64_t> tokens{0};
+        atomic<uint64_t> jniCalls{0};
+        atomic<uint64_t> tokenNanos{0};
+        // Parses that re-armed a pooled Expat parser vs. ones that had to create one
+        atomic<uint64_t> poolHits{0};
+        atomic<uint64_t> poolMisses{0};
+        // Calls into Expat's memory suite, and the subset that had to reach malloc
+        atomic<uint64_t> expatAllocations{0};
+        atomic<uint64_t> systemAllocations{0};
+        // Largest arena plus Expat heap footprint of a single parse
+        atomic<uint64_t> peakParseBytes{0};
+    } g_stats;
+
+    jclass findGlobalClass(JNIEnv *env, const char *name) {
+        jclass local = env->FindClass(name);
+        if (!local) {
+            env->ExceptionClear();
+            LOGE("JNI registry: class %s not found (renamed or stripped by R8?)", name);
+            return nullptr;
+        }
+        auto global = static_cast<jclass>(env->NewGlobalRef(local));
+        env->DeleteLocalRef(local);
+        return global;
+    }
+
+    jmethodID findMethod(JNIEnv *env, jclass clazz, const char *className, const char *name,
+                         const char *signature) {
+        if (!clazz) return nullptr;
+        jmethodID method = env->GetMethodID(clazz, name, signature);
+        if (!method) {
+            env->ExceptionClear();
+            LOGE("JNI registry: method %s.%s%s not found (renamed or stripped by R8?)", className,
+                 name, signature);
+        }
+        return method;
+    }
+
+    bool initJniRegistry(JNIEnv *env) {
+        constexpr const char *START = "com/voyager/core/data/utils/XmlToken$StartElement";
+        constexpr const char *END = "com/voyager/core/data/utils/XmlToken$EndElement";
+        constexpr const char *TEXT = "com/voyager/core/data/utils/XmlToken$Text";
+        constexpr const char *ARRAY_MAP = "androidx/collection/ArrayMap";
+        constexpr const char *TOKEN_STREAM = "com/voyager/core/data/utils/XmlTokenStream";
+        constexpr const char *FLAT_TREE_STREAM = "com/voyager/core/data/utils/FlatTreeStream";
+        constexpr const char *CACHE_PROBE = "com/voyager/core/data/utils/CacheProbe";
+        constexpr const char *BATCH_CALLBACK = "com/voyager/core/data/utils/BatchParseCallback";
+        constexpr const char *JOB_CALLBACK = "com/voyager/core/data/utils/ParseJobCallback";
+        constexpr const char *INPUT_STREAM = "java/io/InputStream";
+
+        JniRegistry &r = g_jni;
+        r.startElementClass = findGlobalClass(env, START);
+        r.startElementConstructor = findMethod(env, r.startElementClass, START, "<init>",
+                                               "(Ljava/lang/String;Landroidx/collection/ArrayMap;)V");
+        r.endElementClass = findGlobalClass(env, END);
+        r.endElementConstructor = findMethod(env, r.endElementClass, END, "<init>",
+                                             "(Ljava/lang/String;)V");
+        r.textClass = findGlobalClass(env, TEXT);
+        r.textConstructor = findMethod(env, r.textClass, TEXT, "<init>", "(Ljava/lang/String;)V");
+        r.arrayMapClass = findGlobalClass(env, ARRAY_MAP);
+        r.arrayMapConstructor = findMethod(env, r.arrayMapClass, ARRAY_MAP, "<init>", "(I)V");
+        r.arrayMapPut = findMethod(env, r.arrayMapClass, ARRAY_MAP, "put",
+                                   "(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;");
+        r.tokenStreamClass = findGlobalClass(env, TOKEN_STREAM);
+        r.onTokenMethod = findMethod(env, r.tokenStreamClass, TOKEN_STREAM, "onToken",
+                                     "(Lcom/voyager/core/data/utils/XmlToken;)V");
+        r.onCompleteMethod = findMethod(env, r.tokenStreamClass, TOKEN_STREAM, "onComplete",
+                                        "([B)V");
+        r.onTokenBatchMethod = findMethod(env, r.tokenStreamClass, TOKEN_STREAM, "onTokenBatch",
+                                          "(Ljava/nio/ByteBuffer;I[Ljava/lang/String;)V");
+        r.flatTreeStreamClass = findGlobalClass(env, FLAT_TREE_STREAM);
+        r.onFlatTreeMethod = findMethod(env, r.flatTreeStreamClass, FLAT_TREE_STREAM, "onFlatTree",
+                                        "([B)V");
+        r.cacheProbeClass = findGlobalClass(env, CACHE_PROBE);
+        r.isCachedMethod = findMethod(env, r.cacheProbeClass, CACHE_PROBE, "isCached", "([B)Z");
+        r.batchCallbackClass = findGlobalClass(env, BATCH_CALLBACK);
+        r.onBatchResultMethod = findMethod(env, r.batchCallbackClass, BATCH_CALLBACK, "onResult",
+                                           "(I[B)V");
+        r.jobCallbackClass = findGlobalClass(env, JOB_CALLBACK);
+        r.onJobFinishedMethod = findMethod(env, r.jobCallbackClass, JOB_CALLBACK, "onFinished",
+                                           "([B)V");
+        r.inputStreamClass = findGlobalClass(env, INPUT_STREAM);
+        r.readMethod = findMethod(env, r.inputStreamClass, INPUT_STREAM, "read", "([B)I");
+        r.readRangeMethod = findMethod(env, r.inputStreamClass, INPUT_STREAM, "read", "([BII)I");
+        r.stringClass = findGlobalClass(env, "java/lang/String");
+
+        return r.startElementConstructor && r.endElementConstructor && r.textConstructor &&
+               r.arrayMapConstructor && r.arrayMapPut && r.onTokenMethod && r.onCompleteMethod &&
+               r.onTokenBatchMethod && r.onFlatTreeMethod && r.isCachedMethod &&
+               r.onBatchResultMethod && r.onJobFinishedMethod && r.readMethod && r.readRangeMethod &&
+               r.stringClass;
+    }
+
+    void releaseJniRegistry(JNIEnv *env) {
+        for (jclass clazz: {g_jni.startElementClass, g_jni.endElementClass, g_jni.textClass,
+                            g_jni.arrayMapClass, g_jni.tokenStreamClass,
+                            g_jni.flatTreeStreamClass, g_jni.cacheProbeClass,
+                            g_jni.batchCallbackClass, g_jni.jobCallbackClass,
+                            g_jni.inputStreamClass, g_jni.stringClass}) {
+            if (clazz) env->DeleteGlobalRef(clazz);
+        }
+        g_jni = JniRegistry();
+    }
+
+    uint64_t nowNanos() {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /**
+     * Returns the JNIEnv of the current thread, attaching it to the VM first if it is a
+     * native worker. Attached threads are detached when they exit.
+     */
+    JNIEnv *attachedEnv() {
+        struct Attachment {
+            bool attached = false;
+
+            ~Attachment() {
+                if (attached && g_vm) g_vm->DetachCurrentThread();
+            }
+        };
+        thread_local Attachment attachment;
+
+        JNIEnv *env = nullptr;
+        if (!g_vm) return nullptr;
+        jint status = g_vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6);
+        if (status == JNI_OK) return env;
+        if (status != JNI_EDETACHED) return nullptr;
+
+        JavaVMAttachArgs args{JNI_VERSION_1_6, "VoyagerParse", nullptr};
+        if (g_vm->AttachCurrentThreadAsDaemon(&env, &args) != JNI_OK) {
+            LOGE("Failed to attach parse worker to the VM");
+            return nullptr;
+        }
+        attachment.attached = true;
+        return env;
+    }
+}
+
+class TokenSink;
+
+// Content fingerprint ids, mirrored by `ContentFingerprint` on the Kotlin side
+enum class Fingerprint : jint {
+    SHA256 = 0,
+    XXH3_128 = 1,
+};
+
+// Maps a `ParsePriority.id` from Kotlin, treating unknown values as Prefetch
+ParsePriority toPriority(jint value) {
+    if (value == static_cast<jint>(ParsePriority::Immediate)) return ParsePriority::Immediate;
+    if (value == static_cast<jint>(ParsePriority::VisibleSoon)) return ParsePriority::VisibleSoon;
+    return ParsePriority::Prefetch;
+}
+
+// Maps the id passed from Kotlin, falling back to SHA256 for unknown values
+Fingerprint toFingerprint(jint value) {
+    if (value == static_cast<jint>(Fingerprint::XXH3_128)) return Fingerprint::XXH3_128;
+    if (value != static_cast<jint>(Fingerprint::SHA256)) {
+        LOGE("Unknown fingerprint %d, using SHA256", value);
+    }
+    return Fingerprint::SHA256;
+}
+
+/**
+ * Computes the content fingerprint reported through onComplete. It is fed each chunk
+ * right before Expat parses it, so hashing and parsing share a single pass over the input.
+ */
+class ContentHasher {
+public:
+    virtual ~ContentHasher() = default;
+
+    virtual void reset() = 0;
+
+    virtual void update(const uint8_t *data, size_t length) = 0;
+
+    // Writes the digest (at most MAX_DIGEST_LENGTH bytes) and returns its length
+    virtual size_t finish(uint8_t *digest) = 0;
+};
+
+// 32-byte SHA256, for callers that need a cryptographic digest
+class Sha256Hasher : public ContentHasher {
+public:
+    void reset() override {
+        sha256.reset();
+    }
+
+    void update(const uint8_t *data, size_t length) override {
+        sha256.update(data, length);
+    }
+
+    size_t finish(uint8_t *digest) override {
+        sha256.final(digest);
+        return SHA256::DIGEST_LENGTH;
+    }
+
+private:
+    SHA256 sha256;
+};
+
+/**
+ * 16-byte XXH3-128 in canonical (big-endian) order. Not cryptographic, but collisions are
+ * negligible for cache keys and xxHash's NEON/SSE2 loops hash at memory speed.
+ */
+class Xxh3Hasher : public ContentHasher {
+public:
+    Xxh3Hasher() {
+        XXH3_INITSTATE(&state);
+        reset();
+    }
+
+    void reset() override {
+        XXH3_128bits_reset(&state);
+    }
+
+    void update(const uint8_t *data, size_t length) override {
+        XXH3_128bits_update(&state, data, length);
+    }
+
+    size_t finish(uint8_t *digest) override {
+        XXH128_canonical_t canonical;
+        XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(&state));
+        memcpy(digest, canonical.digest, sizeof(canonical.digest));
+        return sizeof(canonical.digest);
+    }
+
+private:
+    XXH3_state_t state;
+};
+
+using ParserPtr = unique_ptr<XML_ParserStruct, decltype(&XML_ParserFree)>;
+
+/**
+ * Everything one parse touches, handed to Expat as its userData.
+ *
+ * Nothing about a parse lives in thread-local globals, so a parse started from inside a
+ * token callback (say, for an `<include>`) runs in a session of its own and leaves the
+ * outer one intact. Sessions are reused through SessionLease; beginParse() resets every
+ * per-parse field.
+ */
+struct ParserSession {
+    JNIEnv *env = nullptr;
+    jobject tokenStream = nullptr;
+    TokenSink *sink = nullptr;
+    // Everything Expat allocates; declared before the parser so it outlives it
+    SlabHeap expatHeap;
+    ParserPtr parser{nullptr, XML_ParserFree};
+    Sha256Hasher sha256;
+    Xxh3Hasher xxh3;
+    ContentHasher *hasher = &sha256;
+    uint8_t hash[MAX_DIGEST_LENGTH]{};
+    size_t hashLength = 0;
+    // Set once `hash` holds the final digest (hashed up front, or from the stat index)
+    bool hashFinal = false;
+    InternTable strings;
+    Arena arena;
+    // Character data since the last element boundary, in the arena
+    ArenaVector<char> currentText{arena};
+    // Backing store of BatchTokenSink, kept across parses
+    vector<uint8_t> batchStorage;
+    // Allocation counters when this parse began, for the per-parse report
+    size_t expatAllocationsAtStart = 0;
+    size_t systemAllocationsAtStart = 0;
+    // Set by another thread to abandon the parse; checked between chunks and in handlers
+    const atomic<bool> *cancel = nullptr;
+    // Once set, the parse was stopped for good and handlers deliver nothing more
+    bool halted = false;
+    // Time-sliced parses only: when to suspend Expat (0 = never), and whether it was asked
+    uint64_t sliceDeadline = 0;
+    bool suspending = false;
+    uint32_t eventsSinceClock = 0;
+    uint64_t tokens = 0;
+    uint64_t jniCalls = 0;
+    uint64_t tokenNanos = 0;
+
+    ParserSession() = default;
+
+    ParserSession(const ParserSession &) = delete;
+
+    ParserSession &operator=(const ParserSession &) = delete;
+
+    // Memory this session holds on to between parses, Expat's pools included
+    size_t retainedBytes() const {
+        return arena.bytesReserved() + expatHeap.bytesReserved() + strings.bytesReserved() +
+               batchStorage.capacity();
+    }
+
+    // Blocks this session has taken from malloc for the arena and Expat since creation
+    size_t systemAllocations() const {
+        return arena.systemAllocations() + expatHeap.systemAllocations();
+    }
+};
+
+/**
+ * Borrows a session for one parse from this thread's pool and hands it back afterwards.
+ *
+ * A pooled session keeps its Expat parser, arena and tables, so the next parse only
+ * resets them. A parse started from inside a token callback takes a second session, or a
+ * new one if the pool is empty. Sessions whose retained memory grew past
+ * MAX_POOLED_SESSION_BYTES, e.g. after one very large document, are freed instead.
+ */
+class SessionLease {
+public:
+    SessionLease() {
+        vector<unique_ptr<ParserSession>> &idle = pool();
+        if (idle.empty()) {
+            session.reset(new ParserSession());
+        } else {
+            session = std::move(idle.back());
+            idle.pop_back();
+        }
+    }
+
+    ~SessionLease() {
+        vector<unique_ptr<ParserSession>> &idle = pool();
+        if (idle.size() < MAX_POOLED_SESSIONS &&
+            session->retainedBytes() <= MAX_POOLED_SESSION_BYTES) {
+            idle.push_back(std::move(session));
+        }
+    }
+
+    SessionLease(const SessionLease &) = delete;
+
+    SessionLease &operator=(const SessionLease &) = delete;
+
+    ParserSession &operator*() const {
+        return *session;
+    }
+
+private:
+    unique_ptr<ParserSession> session;
+
+    static vector<unique_ptr<ParserSession>> &pool() {
+        static thread_local vector<unique_ptr<ParserSession>> idle;
+        return idle;
+    }
+};
+
+// Copies a digest into a new Java byte array, or returns nullptr if allocation fails
+jbyteArray newHashArray(JNIEnv *env, const uint8_t *hash, size_t length) {
+    jbyteArray array = env->NewByteArray(static_cast<jsize>(length));
+    if (!array) {
+        LOGE("Failed to create hash byte array");
+        return nullptr;
+    }
+    env->SetByteArrayRegion(array, 0, static_cast<jsize>(length),
+                            reinterpret_cast<const jbyte *>(hash));
+    return array;
+}
+
+/**
+ * Receives parse events from the Expat handlers and delivers them to Kotlin.
+ * One sink instance lives for the duration of a single parse.
+ */
+class TokenSink {
+public:
+    virtual ~TokenSink() = default;
+
+    virtual void startElement(const char *name, const char **attributes) = 0;
+
+    virtual void endElement(const char *name) = 0;
+
+    virtual void text(const char *data, size_t length) = 0;
+
+    // Delivers anything still buffered; called once after the last token
+    virtual void flush() {}
+
+    /**
+     * While deferred, the sink must not call into Java. Used while a Java array is pinned
+     * in a critical region.
+     */
+    virtual void setDeferred(bool /* value */) {}
+
+    /**
+     * Moves the sink to the JNIEnv of a later native call, for a parse that spans several
+     * (see PushParse). Local references from earlier calls are gone by then.
+     */
+    virtual void rebind(JNIEnv * /* env */) {}
+
+    /**
+     * Delivers a result stored by an earlier parse of the same content (see
+     * CompiledLayoutStore) in place of parsing it; returns false if the sink keeps none.
+     */
+    virtual bool restore(JNIEnv * /* env */, jobject /* tokenStream */,
+                         const uint8_t * /* hash */, size_t /* hashLength */) {
+        return false;
+    }
+
+    // Reports the finished parse; by default hands the hash to XmlTokenStream.onComplete
+    virtual void complete(JNIEnv *env, jobject tokenStream, const uint8_t *hash,
+                          size_t hashLength) {
+        jbyteArray hashArray = newHashArray(env, hash, hashLength);
+        if (!hashArray) return;
+        env->CallVoidMethod(tokenStream, g_jni.onCompleteMethod, hashArray);
+        env->DeleteLocalRef(hashArray);
+    }
+};
+
+/**
+ * Process-wide cache of global-ref strings for element names and attribute keys.
+ *
+ * The vocabulary of a layout (`LinearLayout`, `layout_width`, ...) is small and shared by
+ * every document, so those strings are created once per process instead of once per
+ * parse. Bounded in entry count and string length; values and text are never cached.
+ */
+class GlobalStringCache {
+public:
+    // Returns a global ref for the string, creating it if there is room, or nullptr
+    jstring get(JNIEnv *env, const char *value, size_t length) {
+        if (length > MAX_LENGTH) return nullptr;
+        lock_guard<mutex> guard(lock);
+        uint32_t id = table.find(value, length);
+        if (id != InternTable::NO_ID) return refs[id];
+        if (refs.size() >= MAX_ENTRIES) return nullptr;
+
+        jstring local = env->NewStringUTF(value);
+        if (!local) {
+            env->ExceptionClear();
+            return nullptr;
+        }
+        auto global = static_cast<jstring>(env->NewGlobalRef(local));
+        env->DeleteLocalRef(local);
+        table.intern(value, length, true);
+        refs.push_back(global);
+        return global;
+    }
+
+    void clear(JNIEnv *env) {
+        lock_guard<mutex> guard(lock);
+        for (jstring ref: refs) env->DeleteGlobalRef(ref);
+        refs.clear();
+        table.clear();
+    }
+
+private:
+    static constexpr size_t MAX_ENTRIES = 1024;
+    static constexpr size_t MAX_LENGTH = 64;
+
+    mutex lock;
+    InternTable table;
+    vector<jstring> refs;
+};
+
+GlobalStringCache g_stringCache;
+
+// Flat trees from earlier processes keyed by content fingerprint; inert until opened
+CompiledLayoutStore g_layoutStore;
+
+/**
+ * Bridges the session's InternTable to Java.
+ *
+ * Each interned id becomes a `jstring` at most once per parse and is stored in a Java
+ * `String[]` indexed by id. The batched transport hands that array to Kotlin with every
+ * batch, so tokens only need to carry ids; the object transport reads strings back out
+ * of it instead of calling NewStringUTF for every occurrence.
+ *
+ * A table that spans several native calls holds its array as a global reference, so
+ * strings published by one call are still there in the next.
+ */
+class JavaStringTable {
+public:
+    JavaStringTable(ParserSession &session, JNIEnv *env, bool spansCalls = false)
+            : session(session), env(env), spansCalls(spansCalls) {}
+
+    ~JavaStringTable() {
+        release(table);
+    }
+
+    void rebind(JNIEnv *next) {
+        env = next;
+    }
+
+    JavaStringTable(const JavaStringTable &) = delete;
+
+    JavaStringTable &operator=(const JavaStringTable &) = delete;
+
+    // Makes sure the string for `id` is present in the Java array
+    bool publish(uint32_t id) {
+        if (id < published.size() && published[id]) return true;
+        if (!ensureCapacity(id + 1)) return false;
+
+        const InternTable &strings = session.strings;
+        string_view view = strings.get(id);
+        jstring cached = strings.isCacheable(id) ?
+                         g_stringCache.get(env, strings.c_str(id), view.size()) : nullptr;
+        jstring value = cached ? cached : env->NewStringUTF(strings.c_str(id));
+        session.jniCalls++;
+        if (!value) return false;
+
+        env->SetObjectArrayElement(table, static_cast<jsize>(id), value);
+        if (!cached) env->DeleteLocalRef(value);
+        published[id] = true;
+        return true;
+    }
+
+    // Publishes every id interned so far
+    bool publishAll() {
+        for (uint32_t id = 0, size = session.strings.size(); id < size; id++) {
+            if (!publish(id)) return false;
+        }
+        return true;
+    }
+
+    // Returns a new local reference to the string for `id`; the caller deletes it
+    jstring newLocalRef(uint32_t id) {
+        if (!publish(id)) return nullptr;
+        session.jniCalls++;
+        return static_cast<jstring>(env->GetObjectArrayElement(table, static_cast<jsize>(id)));
+    }
+
+    jobjectArray array() const {
+        return table;
+    }
+
+private:
+    static constexpr uint32_t INITIAL_CAPACITY = 128;
+
+    ParserSession &session;
+    JNIEnv *env;
+    bool spansCalls;
+    jobjectArray table = nullptr;
+    vector<bool> published;
+
+    void release(jobjectArray array) {
+        if (!array) return;
+        if (spansCalls) {
+            env->DeleteGlobalRef(array);
+        } else {
+            env->DeleteLocalRef(array);
+        }
+    }
+
+    bool ensureCapacity(uint32_t required) {
+        if (required <= published.size()) return true;
+        auto capacity = static_cast<uint32_t>(max<size_t>(published.size(), INITIAL_CAPACITY));
+        while (capacity < required) capacity *= 2;
+
+        auto grown = static_cast<jobjectArray>(
+                env->NewObjectArray(static_cast<jsize>(capacity), g_jni.stringClass, nullptr));
+        session.jniCalls++;
+        if (!grown) return false;
+        for (uint32_t id = 0; id < published.size(); id++) {
+            if (!published[id]) continue;
+            jobject value = env->GetObjectArrayElement(table, static_cast<jsize>(id));
+            env->SetObjectArrayElement(grown, static_cast<jsize>(id), value);
+            env->DeleteLocalRef(value);
+        }
+        release(table);
+        if (spansCalls) {
+            auto global = static_cast<jobjectArray>(env->NewGlobalRef(grown));
+            env->DeleteLocalRef(grown);
+            grown = global;
+        }
+        table = grown;
+        published.resize(capacity, false);
+        return true;
+    }
+};
+
+/**
+ * Delivers every token as its own `XmlToken` object through `XmlTokenStream.onToken`.
+ * Names, keys and values go through the session's intern table, so each distinct string
+ * is created once per parse.
+ */
+class ObjectTokenSink : public TokenSink {
+public:
+    ObjectTokenSink(ParserSession &session, JNIEnv *env) : session(session), strings(session, env) {}
+
+    void startElement(const char *name, const char **attributes) override {
+        JNIEnv *env = session.env;
+        uint64_t start = nowNanos();
+
+        // Create attribute map
+        jobject attrMap = createAttributeMap(env, attributes);
+
+        // Create StartElement token
+        jstring typeStr = strings.newLocalRef(session.strings.intern(name, strlen(name), true));
+        jobject token = env->NewObject(g_jni.startElementClass, g_jni.startElementConstructor,
+                                       typeStr, attrMap);
+
+        // Call onToken
+        env->CallVoidMethod(session.tokenStream, g_jni.onTokenMethod, token);
+
+        // Clean up
+        env->DeleteLocalRef(token);
+        env->DeleteLocalRef(typeStr);
+        env->DeleteLocalRef(attrMap);
+
+        session.tokens++;
+        session.jniCalls += 2;
+        session.tokenNanos += nowNanos() - start;
+    }
+
+    void endElement(const char *name) override {
+        JNIEnv *env = session.env;
+        uint64_t start = nowNanos();
+
+        jstring typeStr = strings.newLocalRef(session.strings.intern(name, strlen(name), true));
+        jobject token = env->NewObject(g_jni.endElementClass, g_jni.endElementConstructor,
+                                       typeStr);
+
+        // Call onToken
+        env->CallVoidMethod(session.tokenStream, g_jni.onTokenMethod, token);
+
+        // Clean up
+        env->DeleteLocalRef(token);
+        env->DeleteLocalRef(typeStr);
+
+        session.tokens++;
+        session.jniCalls += 2;
+        session.tokenNanos += nowNanos() - start;
+    }
+
+    void text(const char *data, size_t length) override {
+        JNIEnv *env = session.env;
+        uint64_t start = nowNanos();
+
+        jstring textStr = strings.newLocalRef(session.strings.intern(data, length));
+        jobject token = env->NewObject(g_jni.textClass, g_jni.textConstructor, textStr);
+
+        // Call onToken
+        env->CallVoidMethod(session.tokenStream, g_jni.onTokenMethod, token);
+
+        // Clean up
+        env->DeleteLocalRef(token);
+        env->DeleteLocalRef(textStr);
+
+        session.tokens++;
+        session.jniCalls += 2;
+        session.tokenNanos += nowNanos() - start;
+    }
+
+private:
+    ParserSession &session;
+    JavaStringTable strings;
+
+    // Helper function to create a Java Map from attributes
+    jobject createAttributeMap(JNIEnv *env, const char **attributes) {
+        jint count = 0;
+        for (const char **attr = attributes; *attr; attr += 2) count++;
+
+        jobject map = env->NewObject(g_jni.arrayMapClass, g_jni.arrayMapConstructor, count);
+        session.jniCalls++;
+
+        for (const char **attr = attributes; *attr; attr += 2) {
+            const char *key = localName(*attr);
+            const char *value = attr[1] ? attr[1] : "";
+            jstring keyStr = strings.newLocalRef(session.strings.intern(key, strlen(key), true));
+            jstring valueStr = strings.newLocalRef(session.strings.intern(value, strlen(value)));
+            env->CallObjectMethod(map, g_jni.arrayMapPut, keyStr, valueStr);
+            env->DeleteLocalRef(keyStr);
+            env->DeleteLocalRef(valueStr);
+            session.jniCalls++;
+        }
+
+        return map;
+    }
+};
+
+/**
+ * Encodes tokens into a reusable direct `ByteBuffer` and hands them to
+ * `XmlTokenStream.onTokenBatch` only when the buffer is full or the parse ends.
+ *
+ * Batch layout (little-endian), decoded by `TokenBatchDecoder` on the Kotlin side:
+ * - `START_ELEMENT [nameId:u32][attrCount:u16]([keyId:u32][valueId:u32])*`
+ * - `END_ELEMENT [nameId:u32]`
+ * - `TEXT [textId:u32]`
+ *
+ * Ids index the session's string table, which is published into a Java `String[]` right
+ * before each flush and passed along with the batch. Encoding itself makes no JNI calls.
+ */
+class BatchTokenSink : public TokenSink {
+public:
+    BatchTokenSink(ParserSession &session, JNIEnv *env, bool spansCalls = false)
+            : session(session), env(env), strings(session, env, spansCalls),
+              storage(session.batchStorage) {
+        if (storage.size() < BATCH_CAPACITY) storage.resize(BATCH_CAPACITY);
+    }
+
+    ~BatchTokenSink() override {
+        if (byteBuffer) env->DeleteLocalRef(byteBuffer);
+        // Don't let one oversized document pin its buffer in the session forever
+        if (storage.size() > MAX_RETAINED_CAPACITY) {
+            storage.resize(BATCH_CAPACITY);
+            storage.shrink_to_fit();
+        }
+    }
+
+    // While deferred the buffer grows instead of being flushed
+    void setDeferred(bool value) override {
+        deferred = value;
+    }
+
+    void rebind(JNIEnv *next) override {
+        env = next;
+        // The wrapping ByteBuffer was a local ref of the previous call; the next flush remakes it
+        byteBuffer = nullptr;
+        strings.rebind(next);
+    }
+
+    void startElement(const char *name, const char **attributes) override {
+        uint64_t start = nowNanos();
+
+        size_t attrCount = 0;
+        for (const char **attr = attributes; *attr; attr += 2) attrCount++;
+        reserve(1 + 4 + 2 + 8 * attrCount);
+
+        putU8(OP_START_ELEMENT);
+        putU32(session.strings.intern(name, strlen(name), true));
+        putU16(static_cast<uint16_t>(attrCount));
+        for (const char **attr = attributes; *attr; attr += 2) {
+            const char *key = localName(*attr);
+            const char *value = attr[1] ? attr[1] : "";
+            putU32(session.strings.intern(key, strlen(key), true));
+            putU32(session.strings.intern(value, strlen(value)));
+        }
+
+        count++;
+        session.tokens++;
+        session.tokenNanos += nowNanos() - start;
+    }
+
+    void endElement(const char *name) override {
+        uint64_t start = nowNanos();
+        reserve(1 + 4);
+        putU8(OP_END_ELEMENT);
+        putU32(session.strings.intern(name, strlen(name), true));
+        count++;
+        session.tokens++;
+        session.tokenNanos += nowNanos() - start;
+    }
+
+    void text(const char *data, size_t length) override {
+        uint64_t start = nowNanos();
+        reserve(1 + 4);
+        putU8(OP_TEXT);
+        putU32(session.strings.intern(data, length));
+        count++;
+        session.tokens++;
+        session.tokenNanos += nowNanos() - start;
+    }
+
+    void flush() override {
+        if (count == 0 || deferred) return;
+        uint64_t start = nowNanos();
+        if (!byteBuffer || bufferCapacity != storage.size()) {
+            if (byteBuffer) env->DeleteLocalRef(byteBuffer);
+            bufferCapacity = storage.size();
+            byteBuffer = env->NewDirectByteBuffer(storage.data(),
+                                                  static_cast<jlong>(bufferCapacity));
+            session.jniCalls++;
+            if (!byteBuffer) return;
+        }
+        if (!strings.publishAll()) return;
+        env->CallVoidMethod(session.tokenStream, g_jni.onTokenBatchMethod, byteBuffer,
+                            static_cast<jint>(count), strings.array());
+        session.jniCalls++;
+        position = 0;
+        count = 0;
+        session.tokenNanos += nowNanos() - start;
+    }
+
+private:
+    static constexpr size_t BATCH_CAPACITY = 32 * 1024;
+    static constexpr size_t MAX_RETAINED_CAPACITY = 256 * 1024;
+    static constexpr uint8_t OP_START_ELEMENT = 0x02;
+    static constexpr uint8_t OP_END_ELEMENT = 0x03;
+    static constexpr uint8_t OP_TEXT = 0x04;
+
+    ParserSession &session;
+    JNIEnv *env;
+    JavaStringTable strings;
+    // Native backing store, owned by the session and reused by its batched parses
+    vector<uint8_t> &storage;
+    jobject byteBuffer = nullptr;
+    size_t bufferCapacity = 0;
+    bool deferred = false;
+    size_t position = 0;
+    size_t count = 0;
+
+    // Makes room for a record of the given size, flushing or growing as needed
+    void reserve(size_t required) {
+        if (position + required <= storage.size()) return;
+        if (!deferred) flush();
+        if (position + required > storage.size()) {
+            storage.resize(max(storage.size() * 2, position + required));
+        }
+    }
+
+    void putU8(uint8_t value) {
+        storage[position++] = value;
+    }
+
+    void putU16(uint16_t value) {
+        storage[position++] = static_cast<uint8_t>(value);
+        storage[position++] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void putU32(uint32_t value) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            storage[position++] = static_cast<uint8_t>(value >> shift);
+        }
+    }
+};
+
+/**
+ * Builds the view tree natively (see FlatTreeBuilder for the layout) and hands it to
+ * `FlatTreeStream.onFlatTree` as a single byte array once the parse completes, so the
+ * whole document costs one JNI crossing. Without a JNI env, e.g. on a batch worker, the
+ * serialized tree is written to a native buffer instead.
+ *
+ * Text runs are dropped, as `ViewNodeTokenStream` does. Finished trees are also kept in
+ * the compiled-layout store when it is open, and restored from it by content hash.
+ */
+class FlatTreeSink : public TokenSink {
+public:
+    FlatTreeSink(ParserSession &session, JNIEnv * /* env */)
+            : session(session), builder(session.arena, session.strings) {}
+
+    // Sink for a JNI-free parse; the finished tree replaces the contents of `output`
+    FlatTreeSink(ParserSession &session, vector<uint8_t> &output)
+            : session(session), builder(session.arena, session.strings), output(&output) {}
+
+    void startElement(const char *name, const char **attributes) override {
+        uint64_t start = nowNanos();
+        builder.startElement(name, attributes);
+        session.tokens++;
+        session.tokenNanos += nowNanos() - start;
+    }
+
+    void endElement(const char * /* name */) override {
+        uint64_t start = nowNanos();
+        builder.endElement();
+        session.tokens++;
+        session.tokenNanos += nowNanos() - start;
+    }
+
+    void text(const char * /* data */, size_t /* length */) override {
+        session.tokens++;
+    }
+
+    void complete(JNIEnv *env, jobject tokenStream, const uint8_t *hash,
+                  size_t hashLength) override {
+        uint64_t start = nowNanos();
+        size_t total = builder.serializedSize(hashLength);
+        if (total > static_cast<size_t>(INT32_MAX)) {
+            LOGE("Flat tree of %zu bytes is too large for a Java array", total);
+            return;
+        }
+
+        if (output) {
+            output->resize(total);
+            builder.serialize(output->data(), hash, hashLength);
+            g_layoutStore.put(STORE_KIND, hash, hashLength, output->data(), total);
+            session.tokenNanos += nowNanos() - start;
+            return;
+        }
+
+        uint8_t *out = session.arena.allocateArray<uint8_t>(total);
+        builder.serialize(out, hash, hashLength);
+        g_layoutStore.put(STORE_KIND, hash, hashLength, out, total);
+        deliver(env, tokenStream, out, total);
+        session.tokenNanos += nowNanos() - start;
+    }
+
+    bool restore(JNIEnv *env, jobject tokenStream, const uint8_t *hash,
+                 size_t hashLength) override {
+        // Copied out under the store's lock: compaction may unmap the file right after
+        vector<uint8_t> copy;
+        vector<uint8_t> &tree = output ? *output : copy;
+        if (!g_layoutStore.find(STORE_KIND, hash, hashLength, tree)) return false;
+        if (tree.size() > static_cast<size_t>(INT32_MAX)) {
+            tree.clear();
+            return false;
+        }
+        return output || deliver(env, tokenStream, tree.data(), tree.size());
+    }
+
+private:
+    // Store kind of flat trees: "FT" and the format version, so older trees never match
+    static constexpr uint32_t STORE_KIND = 0x46540000u | FlatTreeBuilder::VERSION;
+
+    ParserSession &session;
+    FlatTreeBuilder builder;
+    vector<uint8_t> *output = nullptr;
+
+    // Hands a serialized tree to `FlatTreeStream.onFlatTree`
+    bool deliver(JNIEnv *env, jobject tokenStream, const uint8_t *tree, size_t length) {
+        jbyteArray array = env->NewByteArray(static_cast<jsize>(length));
+        if (!array) {
+            LOGE("Failed to allocate flat tree array");
+            return false;
+        }
+        env->SetByteArrayRegion(array, 0, static_cast<jsize>(length),
+                                reinterpret_cast<const jbyte *>(tree));
+        env->CallVoidMethod(tokenStream, g_jni.onFlatTreeMethod, array);
+        env->DeleteLocalRef(array);
+        session.jniCalls += 3;
+        return true;
+    }
+};
+
+/**
+ * Compiles the layout to bytecode during the parse (see BytecodeCompiler) instead of
+ * delivering tokens. Makes no JNI calls; the compiled layout is left in the session's
+ * arena, valid until the session is reused, for the caller to copy out.
+ */
+class BytecodeSink : public TokenSink {
+public:
+    BytecodeSink(ParserSession &session, string_view activityName, uint8_t version,
+                 int32_t timestamp)
+            : session(session), compiler(session.arena, session.strings, activityName, version),
+              timestamp(timestamp) {}
+
+    void startElement(const char *name, const char **attributes) override {
+        uint64_t start = nowNanos();
+        compiler.startElement(name, attributes);
+        session.tokens++;
+        session.tokenNanos += nowNanos() - start;
+    }
+
+    void endElement(const char * /* name */) override {
+        compiler.endElement();
+        session.tokens++;
+    }
+
+    void text(const char * /* data */, size_t /* length */) override {
+        session.tokens++;
+    }
+
+    void complete(JNIEnv * /* env */, jobject /* tokenStream */, const uint8_t * /* hash */,
+                  size_t /* hashLength */) override {
+        if (compiler.views() == 0) {
+            LOGE("Layout has no root element; nothing to compile");
+            return;
+        }
+        size_t total = compiler.serializedSize();
+        if (total > static_cast<size_t>(INT32_MAX)) {
+            LOGE("Compiled layout of %zu bytes is too large for a Java array", total);
+            return;
+        }
+        uint8_t *out = session.arena.allocateArray<uint8_t>(total);
+        compiler.serialize(out, timestamp);
+        compiled = out;
+        compiledSize = total;
+    }
+
+    // The compiled layout as a new Java array, or nullptr if the parse failed
+    jbyteArray toJavaArray(JNIEnv *env) const {
+        if (!compiled) return nullptr;
+        jbyteArray array = env->NewByteArray(static_cast<jsize>(compiledSize));
+        if (array) {
+            env->SetByteArrayRegion(array, 0, static_cast<jsize>(compiledSize),
+                                    reinterpret_cast<const jbyte *>(compiled));
+        }
+        return array;
+    }
+
+private:
+    ParserSession &session;
+    BytecodeCompiler compiler;
+    int32_t timestamp;
+    const uint8_t *compiled = nullptr;
+    size_t compiledSize = 0;
+};
+
+/**
+ * Writes tokens into a TokenRing for a consumer on another thread (see TokenRing for the
+ * record layout). Makes no JNI calls, so it runs on a ParsePool worker. Once the consumer
+ * goes away every later token is dropped and the parse is reported as failed.
+ */
+class RingTokenSink : public TokenSink {
+public:
+    RingTokenSink(ParserSession &session, TokenRing &ring, uint32_t publishDepth)
+            : session(session), ring(ring), writer(ring, session.strings, publishDepth) {}
+
+    void startElement(const char *name, const char **attributes) override {
+        uint64_t start = nowNanos();
+        ok = ok && writer.startElement(name, attributes);
+        session.tokens++;
+        session.tokenNanos += nowNanos() - start;
+    }
+
+    void endElement(const char *name) override {
+        uint64_t start = nowNanos();
+        ok = ok && writer.endElement(name);
+        session.tokens++;
+        session.tokenNanos += nowNanos() - start;
+    }
+
+    void text(const char *data, size_t length) override {
+        uint64_t start = nowNanos();
+        ok = ok && writer.text(data, length);
+        session.tokens++;
+        session.tokenNanos += nowNanos() - start;
+    }
+
+    void complete(JNIEnv * /* env */, jobject /* tokenStream */, const uint8_t *hash,
+                  size_t hashLength) override {
+        completed = ok && writer.complete(hash, hashLength);
+    }
+
+    // Ends the ring; a parse that never completed gets a FAILED record first
+    void close() {
+        if (!completed && !ring.isCancelled()) writer.fail();
+        ring.close();
+    }
+
+private:
+    ParserSession &session;
+    TokenRing &ring;
+    TokenRingWriter writer;
+    bool ok = true;
+    bool completed = false;
+};
+
+/**
+ * Picks the sink for a batched parse: streams that can take a finished tree get one,
+ * everything else gets encoded token batches. `spansCalls` is for a parse fed over
+ * several native calls.
+ */
+unique_ptr<TokenSink> createSink(ParserSession &session, JNIEnv *env, jobject tokenStream,
+                                 bool spansCalls = false) {
+    if (env->IsInstanceOf(tokenStream, g_jni.flatTreeStreamClass)) {
+        return unique_ptr<TokenSink>(new FlatTreeSink(session, env));
+    }
+    return unique_ptr<TokenSink>(new BatchTokenSink(session, env, spansCalls));
+}
+
+/**
+ * Whether a handler may deliver its event. Once the session's cancellation flag is set,
+ * Expat is stopped for good and every event it still reports is dropped.
+ */
+bool admitEvent(ParserSession &session) {
+    if (session.halted) return false;
+    if (session.cancel && session.cancel->load(memory_order_relaxed)) {
+        session.halted = true;
+        XML_StopParser(session.parser.get(), XML_FALSE);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * For a time-sliced parse, suspends Expat once the slice deadline has passed. Called
+ * after an event is delivered; the clock is only read every SLICE_CLOCK_INTERVAL events.
+ */
+void checkSliceDeadline(ParserSession &session) {
+    if (session.sliceDeadline == 0 || session.suspending) return;
+    if (++session.eventsSinceClock < SLICE_CLOCK_INTERVAL) return;
+    session.eventsSinceClock = 0;
+    if (nowNanos() >= session.sliceDeadline) {
+        session.suspending = true;
+        XML_StopParser(session.parser.get(), XML_TRUE);
+    }
+}
+
+// XML start element handler
+void XMLCALL startElement(void *userData, const char *name, const char **attributes) {
+    auto *session = static_cast<ParserSession *>(userData);
+    if (!admitEvent(*session)) return;
+    // Send any accumulated text
+    if (!session->currentText.empty()) {
+        session->sink->text(session->currentText.data(), session->currentText.size());
+        session->currentText.clear();
+    }
+
+    session->sink->startElement(name, attributes);
+    checkSliceDeadline(*session);
+}
+
+// XML end element handler
+void XMLCALL endElement(void *userData, const char *name) {
+    auto *session = static_cast<ParserSession *>(userData);
+    if (!admitEvent(*session)) return;
+    // Send any accumulated text
+    if (!session->currentText.empty()) {
+        session->sink->text(session->currentText.data(), session->currentText.size());
+        session->currentText.clear();
+    }
+
+    session->sink->endElement(name);
+    checkSliceDeadline(*session);
+}
+
+// XML character data handler
+void XMLCALL characterData(void *userData, const char *s, int len) {
+    auto *session = static_cast<ParserSession *>(userData);
+    if (session->halted) return;
+    session->currentText.append(s, len);
+}
+
+// Wires the session's Expat parser to the token handlers, with the session as its userData
+void armParser(ParserSession &session) {
+    XML_Parser parser = session.parser.get();
+    XML_SetUserData(parser, &session);
+    XML_SetElementHandler(parser, startElement, endElement);
+    XML_SetCharacterDataHandler(parser, characterData);
+}
+
+/**
+ * Readies the session's Expat parser for a new document. A pooled parser is rewound with
+ * XML_ParserReset, which keeps its hash tables and buffers but forgets the handlers, so
+ * they are set again; otherwise a new parser is created on the session's SlabHeap.
+ */
+bool prepareParser(ParserSession &session) {
+    static const XML_Memory_Handling_Suite memorySuite = {
+            SlabHeap::suiteMalloc, SlabHeap::suiteRealloc, SlabHeap::suiteFree};
+
+    SlabHeap::Scope heapScope(session.expatHeap);
+    if (session.parser && XML_ParserReset(session.parser.get(), nullptr)) {
+        g_stats.poolHits.fetch_add(1, memory_order_relaxed);
+    } else {
+        // The old parser hands its blocks back first, then the heap drops them all at once
+        session.parser.reset();
+        session.expatHeap.release();
+        session.parser.reset(XML_ParserCreate_MM(nullptr, &memorySuite, nullptr));
+        g_stats.poolMisses.fetch_add(1, memory_order_relaxed);
+        if (!session.parser) return false;
+    }
+    armParser(session);
+    return true;
+}
+
+/**
+ * Resets the session and binds it to the given sink, token stream and fingerprint.
+ * Returns false if no Expat parser could be created.
+ */
+bool beginParse(ParserSession &session, JNIEnv *env, jobject tokenStream, TokenSink &sink,
+                Fingerprint fingerprint) {
+    session.env = env;
+    session.tokenStream = tokenStream;
+    session.sink = &sink;
+    session.hasher = fingerprint == Fingerprint::XXH3_128 ?
+                     static_cast<ContentHasher *>(&session.xxh3) : &session.sha256;
+    session.hasher->reset();
+    session.hashLength = 0;
+    session.hashFinal = false;
+    session.tokens = 0;
+    session.jniCalls = 0;
+    session.tokenNanos = 0;
+    session.strings.clear();
+    session.arena.reset();
+    session.currentText.abandon();
+    session.expatHeap.resetPeak();
+    session.expatAllocationsAtStart = session.expatHeap.allocationCount();
+    session.systemAllocationsAtStart = session.systemAllocations();
+    session.cancel = nullptr;
+    session.halted = false;
+    session.sliceDeadline = 0;
+    session.suspending = false;
+    session.eventsSinceClock = 0;
+    if (!prepareParser(session)) {
+        LOGE("Error creating XML parser");
+        return false;
+    }
+    return true;
+}
+
+// Logs why Expat stopped, unless it was stopped on purpose
+void logParseError(ParserSession &session) {
+    XML_Parser parser = session.parser.get();
+    if (session.halted) {
+        LOGD("Parse cancelled at line %lu",
+             static_cast<unsigned long>(XML_GetCurrentLineNumber(parser)));
+        return;
+    }
+    LOGE("XML Parse error: %s at line %lu", XML_ErrorString(XML_GetErrorCode(parser)),
+         static_cast<unsigned long>(XML_GetCurrentLineNumber(parser)));
+}
+
+// Parses one chunk of input that was already hashed; false on a parse error or once cancelled
+bool parseChunk(ParserSession &session, const char *data, size_t len, bool isFinal) {
+    if (session.cancel && session.cancel->load(memory_order_relaxed)) session.halted = true;
+    if (session.halted) return false;
+    SlabHeap::Scope heapScope(session.expatHeap);
+    if (XML_Parse(session.parser.get(), data, static_cast<int>(len), isFinal) ==
+        XML_STATUS_ERROR) {
+        logParseError(session);
+        return false;
+    }
+    return true;
+}
+
+// Hashes and parses one chunk of input; see parseChunk
+bool feedChunk(ParserSession &session, const char *data, size_t len, bool isFinal) {
+    if (len > 0 && !session.hashFinal) {
+        session.hasher->update(reinterpret_cast<const uint8_t *>(data), len);
+    }
+    return parseChunk(session, data, len, isFinal);
+}
+
+// Flushes the sink and reports the finalized hash through the sink
+void completeParse(ParserSession &session) {
+    // Deliver any tokens still buffered by the sink
+    session.sink->flush();
+
+    if (!session.hashFinal) {
+        session.hashLength = session.hasher->finish(session.hash);
+        session.hashFinal = true;
+    }
+    session.sink->complete(session.env, session.tokenStream, session.hash, session.hashLength);
+}
+
+/**
+ * Asks the CacheProbe about the session's final digest; true if parsing is skipped. On a
+ * miss the sink may still restore the result of an earlier process from the store.
+ */
+bool askProbe(ParserSession &session, jobject cacheProbe) {
+    JNIEnv *env = session.env;
+    jbyteArray hashArray = newHashArray(env, session.hash, session.hashLength);
+    if (!hashArray) return false;
+    jboolean cached = env->CallBooleanMethod(cacheProbe, g_jni.isCachedMethod, hashArray);
+    env->DeleteLocalRef(hashArray);
+    session.jniCalls += 2;
+    if (env->ExceptionCheck()) {
+        LOGE("CacheProbe.isCached threw; abandoning the parse");
+        return true;
+    }
+    return cached == JNI_TRUE ||
+           session.sink->restore(env, session.tokenStream, session.hash, session.hashLength);
+}
+
+/**
+ * Second phase of a probed parse: the hasher has seen the whole input, so the digest is
+ * final. Asks the caller's CacheProbe whether the result is already known; returns true
+ * if parsing should be skipped, including when the probe threw.
+ */
+bool probeCache(ParserSession &session, jobject cacheProbe) {
+    session.hashLength = session.hasher->finish(session.hash);
+    session.hashFinal = true;
+    return askProbe(session, cacheProbe);
+}
+
+// Hashes an in-memory document up front and probes the cache; true if it can be skipped
+bool probeMemory(ParserSession &session, jobject cacheProbe, const char *data, size_t length) {
+    if (!cacheProbe) return false;
+    session.hasher->update(reinterpret_cast<const uint8_t *>(data), length);
+    return probeCache(session, cacheProbe);
+}
+
+/**
+ * Publishes this parse's JNI cost and memory report and unbinds the session from the
+ * caller's objects. In the steady state a pooled session reports zero system allocations.
+ */
+void endParse(ParserSession &session) {
+    size_t expatAllocations = session.expatHeap.allocationCount() - session.expatAllocationsAtStart;
+    size_t systemAllocations = session.systemAllocations() - session.systemAllocationsAtStart;
+    uint64_t peakBytes = session.arena.peakBytesUsed() + session.expatHeap.peakBytes();
+    LOGD("Parse memory: %zu Expat allocations, %zu from malloc, peak %llu bytes",
+         expatAllocations, systemAllocations, static_cast<unsigned long long>(peakBytes));
+
+    g_stats.parses.fetch_add(1, memory_order_relaxed);
+    g_stats.tokens.fetch_add(session.tokens, memory_order_relaxed);
+    g_stats.jniCalls.fetch_add(session.jniCalls, memory_order_relaxed);
+    g_stats.tokenNanos.fetch_add(session.tokenNanos, memory_order_relaxed);
+    g_stats.expatAllocations.fetch_add(expatAllocations, memory_order_relaxed);
+    g_stats.systemAllocations.fetch_add(systemAllocations, memory_order_relaxed);
+    uint64_t peak = g_stats.peakParseBytes.load(memory_order_relaxed);
+    while (peak < peakBytes &&
+           !g_stats.peakParseBytes.compare_exchange_weak(peak, peakBytes, memory_order_relaxed)) {}
+
+    // The references were only valid for this native call; the parser stays for reuse
+    session.env = nullptr;
+    session.tokenStream = nullptr;
+    session.sink = nullptr;
+}
+
+/**
+ * Parses a memory-resident document to the end in one pass, hashing each window right
+ * before Expat reads it. Makes no JNI calls of its own.
+ */
+bool feedMemory(ParserSession &session, const char *data, size_t len) {
+    bool ok = true;
+    size_t offset = 0;
+    while (ok && offset < len) {
+        size_t window = min(MAPPED_WINDOW_SIZE, len - offset);
+        ok = feedChunk(session, data + offset, window, offset + window == len);
+        offset += window;
+    }
+    if (ok && len == 0) ok = feedChunk(session, data, 0, true);
+    return ok;
+}
+
+/**
+ * Reads the InputStream to EOF through `javaBuffer`, handing each chunk to `consume`.
+ * Returns false if reading throws or `consume` returns false.
+ */
+template<typename Consumer>
+bool readStream(ParserSession &session, jobject inputStream, jbyteArray javaBuffer,
+                Consumer consume) {
+    JNIEnv *env = session.env;
+    // Allocate native buffer for processing
+    char nativeBuffer[BUFFER_SIZE];
+
+    while (true) {
+        // Read chunk from InputStream; the read method ID comes from the JNI registry
+        jint bytesRead = env->CallIntMethod(inputStream, g_jni.readMethod, javaBuffer);
+        session.jniCalls++;
+
+        if (env->ExceptionCheck()) {
+            LOGE("Error reading from InputStream");
+            return false;
+        }
+        if (bytesRead < 0) {
+            LOGD("Finished reading from InputStream");
+            return true;
+        }
+        if (bytesRead == 0) continue;
+
+        // Copy data to native buffer and hand it on
+        env->GetByteArrayRegion(javaBuffer, 0, bytesRead,
+                                reinterpret_cast<jbyte *>(nativeBuffer));
+        if (!consume(nativeBuffer, static_cast<size_t>(bytesRead))) return false;
+    }
+}
+
+/**
+ * Parses the rest of an InputStream while a helper thread reads ahead of the parser.
+ *
+ * The helper, attached to the VM, reads into a ChunkRing slot and hashes it while the
+ * calling thread parses the previous slot, so a blocking read no longer stalls Expat.
+ * Read sizes adapt to the stream through ChunkSizer. An exception from `read` is rethrown
+ * on the calling thread. Returns false if reading fails or the document is malformed.
+ *
+ * Expat parses a slot in place (XML_Parse only copies the unparsed tail), so slots are
+ * not read into XML_GetBuffer memory: that buffer belongs to the parser thread and moves
+ * on every call.
+ */
+bool readAheadStream(ParserSession &session, jobject inputStream) {
+    JNIEnv *env = session.env;
+    jobject stream = env->NewGlobalRef(inputStream);
+    ContentHasher *hasher = session.hashFinal ? nullptr : session.hasher;
+    ChunkRing ring;
+    jobject failure = nullptr;
+    uint64_t readerCalls = 0;
+
+    thread reader([&] {
+        JNIEnv *readerEnv = attachedEnv();
+        ChunkSizer sizer(BUFFER_SIZE, READ_AHEAD_MAX_CHUNK);
+        jbyteArray array = nullptr;
+        size_t arrayLength = 0;
+        while (ChunkRing::Slot *slot = ring.acquireFree()) {
+            size_t requested = sizer.next();
+            if (readerEnv && arrayLength < requested) {
+                if (array) readerEnv->DeleteLocalRef(array);
+                array = readerEnv->NewByteArray(static_cast<jsize>(requested));
+                arrayLength = array ? requested : 0;
+                readerCalls++;
+            }
+            jint received = -1;
+            if (array) {
+                received = readerEnv->CallIntMethod(stream, g_jni.readRangeMethod, array, 0,
+                                                    static_cast<jint>(requested));
+                readerCalls++;
+            }
+            if (!array || readerEnv->ExceptionCheck()) {
+                if (readerEnv && readerEnv->ExceptionCheck()) {
+                    jthrowable thrown = readerEnv->ExceptionOccurred();
+                    readerEnv->ExceptionClear();
+                    failure = readerEnv->NewGlobalRef(thrown);
+                    readerEnv->DeleteLocalRef(thrown);
+                }
+                LOGE("Error reading ahead from InputStream");
+                slot->failed = slot->last = true;
+                ring.publish();
+                break;
+            }
+            if (received < 0) {
+                slot->last = true;
+                ring.publish();
+                break;
+            }
+            if (received == 0) continue;
+
+            auto length = static_cast<size_t>(received);
+            sizer.observe(requested, length);
+            if (slot->data.size() < length) slot->data.resize(length);
+            readerEnv->GetByteArrayRegion(array, 0, received,
+                                          reinterpret_cast<jbyte *>(slot->data.data()));
+            if (hasher) hasher->update(reinterpret_cast<const uint8_t *>(slot->data.data()), length);
+            slot->length = length;
+            ring.publish();
+        }
+        if (array) readerEnv->DeleteLocalRef(array);
+    });
+
+    bool ok = true;
+    while (ChunkRing::Slot *slot = ring.acquireFilled()) {
+        bool last = slot->last;
+        ok = !slot->failed && parseChunk(session, slot->data.data(), slot->length, last);
+        ring.release();
+        if (last || !ok) break;
+    }
+    // A malformed document stops the reader after its current read
+    if (!ok) ring.cancel();
+    reader.join();
+
+    session.jniCalls += readerCalls;
+    if (failure) {
+        env->Throw(static_cast<jthrowable>(failure));
+        env->DeleteGlobalRef(failure);
+    }
+    env->DeleteGlobalRef(stream);
+    return ok;
+}
+
+/**
+ * Streams the InputStream through Expat into the given sink, then reports the hash.
+ *
+ * The first READ_AHEAD_THRESHOLD bytes are read and parsed inline; a stream that goes on
+ * past that is handed to readAheadStream, so a small layout never pays for a thread.
+ *
+ * With a cache probe the stream can't be rewound, so the document is first read into the
+ * session arena and hashed, and Expat only runs on it if the probe misses.
+ */
+void parseStream(ParserSession &session, JNIEnv *env, jobject inputStream, jobject tokenStream,
+                 TokenSink &sink, Fingerprint fingerprint, jobject cacheProbe) {
+    if (!beginParse(session, env, tokenStream, sink, fingerprint)) {
+        endParse(session);
+        return;
+    }
+
+    // Allocate Java byte array for reading
+    jbyteArray byteBuffer = env->NewByteArray(BUFFER_SIZE);
+    if (!byteBuffer) {
+        LOGE("Failed to allocate byte array");
+        endParse(session);
+        return;
+    }
+
+    bool ok;
+    if (cacheProbe) {
+        ArenaVector<char> document(session.arena);
+        ok = readStream(session, inputStream, byteBuffer, [&](const char *data, size_t length) {
+            document.append(data, length);
+            return true;
+        });
+        ok = ok && !probeMemory(session, cacheProbe, document.data(), document.size()) &&
+             feedMemory(session, document.data(), document.size());
+    } else {
+        size_t readInline = 0;
+        bool handOff = false;
+        ok = readStream(session, inputStream, byteBuffer, [&](const char *data, size_t length) {
+            if (!feedChunk(session, data, length, false)) return false;
+            readInline += length;
+            handOff = readInline >= READ_AHEAD_THRESHOLD;
+            return !handOff;
+        });
+        if (handOff) {
+            // readAheadStream parses everything up to and including the final chunk
+            ok = readAheadStream(session, inputStream);
+        } else {
+            // Finalize parsing
+            ok = ok && feedChunk(session, nullptr, 0, true);
+        }
+    }
+    if (ok) completeParse(session);
+
+    env->DeleteLocalRef(byteBuffer);
+    endParse(session);
+}
+
+/**
+ * A read-only memory mapping of a file region, unmapped on destruction.
+ * Handles offsets that are not page aligned.
+ */
+class MappedRegion {
+public:
+    MappedRegion(int fd, off_t offset, size_t length) {
+        long pageSize = sysconf(_SC_PAGESIZE);
+        off_t alignedOffset = offset - offset % pageSize;
+        size_t delta = static_cast<size_t>(offset - alignedOffset);
+        mappedLength = length + delta;
+        if (length == 0) return;
+
+        void *address = mmap(nullptr, mappedLength, PROT_READ, MAP_PRIVATE, fd, alignedOffset);
+        if (address == MAP_FAILED) {
+            LOGE("mmap failed: %s", strerror(errno));
+            return;
+        }
+        madvise(address, mappedLength, MADV_SEQUENTIAL);
+        base = address;
+        data = static_cast<const char *>(address) + delta;
+        size = length;
+    }
+
+    ~MappedRegion() {
+        if (base) munmap(base, mappedLength);
+    }
+
+    MappedRegion(const MappedRegion &) = delete;
+
+    MappedRegion &operator=(const MappedRegion &) = delete;
+
+    const char *data = nullptr;
+    size_t size = 0;
+
 private:
-    uint32_t state[8];
-    uint8_t data[64];
-    size_t datalen;
-    uint64_t bitlen;
+    void *base = nullptr;
+    size_t mappedLength = 0;
+};
+
+// Fingerprints of whole local files keyed on their stat tuple; inert until opened
+StatKeyIndex g_statKeyIndex;
 
-    static const uint32_t k[64];
+/**
+ * Maps [offset, offset + length) of the file and parses it without copying through Java.
+ * Returns false without touching the token stream if the descriptor is not a mappable
+ * regular file (e.g. a pipe handed out by a content provider), so callers can fall back
+ * to the stream path.
+ *
+ * When the region is the whole file and the stat key index knows its (device, inode,
+ * size, mtime), the recorded fingerprint is trusted: the probe is asked without reading
+ * the file and a hit returns before anything is mapped.
+ */
+bool parseFileDescriptor(ParserSession &session, JNIEnv *env, int fd, jlong offset, jlong length,
+                         jobject tokenStream, TokenSink &sink, Fingerprint fingerprint,
+                         jobject cacheProbe) {
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || offset < 0 ||
+        offset > info.st_size) {
+        LOGD("Descriptor %d is not a mappable file region", fd);
+        return false;
+    }
 
-    static uint32_t rotr(uint32_t x, uint32_t n) {
-        return (x >> n) | (x << (32 - n));
+    if (!beginParse(session, env, tokenStream, sink, fingerprint)) {
+        endParse(session);
+        return true;
+    }
+    // A negative length means "to the end of the file"
+    jlong available = info.st_size - offset;
+    size_t size = static_cast<size_t>(length < 0 ? available : min(length, available));
+
+    bool wholeFile = offset == 0 && size == static_cast<size_t>(info.st_size);
+    FileIdentity identity = FileIdentity::of(info);
+    bool indexed = false;
+    if (wholeFile) {
+        size_t known = g_statKeyIndex.lookup(identity, static_cast<uint32_t>(fingerprint),
+                                             session.hash);
+        if (known > 0) {
+            session.hashLength = known;
+            session.hashFinal = true;
+            indexed = true;
+            if (cacheProbe && askProbe(session, cacheProbe)) {
+                endParse(session);
+                return true;
+            }
+        }
     }
 
-    static uint32_t choose(uint32_t e, uint32_t f, uint32_t g) {
-        return (e & f) ^ (~e & g);
+    MappedRegion region(fd, static_cast<off_t>(offset), size);
+    if (size > 0 && !region.data) {
+        LOGE("Error preparing mapped parse");
+        endParse(session);
+        return true;
     }
 
-    static uint32_t majority(uint32_t a, uint32_t b, uint32_t c) {
-        return (a & (b | c)) | (b & c);
+    bool skipped = !indexed && probeMemory(session, cacheProbe, region.data, region.size);
+    if (!skipped && feedMemory(session, region.data, region.size)) {
+        completeParse(session);
+    }
+    if (wholeFile && !indexed && session.hashFinal) {
+        g_statKeyIndex.record(identity, static_cast<uint32_t>(fingerprint), session.hash,
+                              session.hashLength);
     }
+    endParse(session);
+    return true;
+}
 
-    static uint32_t ep0(uint32_t x) {
-        return rotr(x, 2) ^ rotr(x, 13) ^ rotr(x, 22);
+// Parses a document that is already in native memory (e.g. a direct ByteBuffer)
+void parseNativeMemory(ParserSession &session, JNIEnv *env, const char *data, size_t length,
+                       jobject tokenStream, TokenSink &sink, Fingerprint fingerprint,
+                       jobject cacheProbe) {
+    if (beginParse(session, env, tokenStream, sink, fingerprint) &&
+        !probeMemory(session, cacheProbe, data, length) && feedMemory(session, data, length)) {
+        completeParse(session);
     }
+    endParse(session);
+}
 
-    static uint32_t ep1(uint32_t x) {
-        return rotr(x, 6) ^ rotr(x, 11) ^ rotr(x, 25);
+// Feeds a region of a Java byte array to the hasher only, for a cache probe
+void hashJavaBytes(ParserSession &session, jbyteArray bytes, jint offset, jint length) {
+    JNIEnv *env = session.env;
+    if (static_cast<size_t>(length) <= CRITICAL_PIN_LIMIT) {
+        auto *pinned = static_cast<const uint8_t *>(env->GetPrimitiveArrayCritical(bytes, nullptr));
+        if (!pinned) return;
+        session.hasher->update(pinned + offset, static_cast<size_t>(length));
+        env->ReleasePrimitiveArrayCritical(bytes, const_cast<uint8_t *>(pinned), JNI_ABORT);
+        return;
     }
+    uint8_t window[BUFFER_SIZE];
+    for (jint position = 0; position < length; position += BUFFER_SIZE) {
+        jint chunk = min(BUFFER_SIZE, length - position);
+        env->GetByteArrayRegion(bytes, offset + position, chunk, reinterpret_cast<jbyte *>(window));
+        session.hasher->update(window, static_cast<size_t>(chunk));
+    }
+}
 
-    static uint32_t sig0(uint32_t x) {
-        return rotr(x, 7) ^ rotr(x, 18) ^ (x >> 3);
+/**
+ * Parses a region of a Java byte array without read callbacks.
+ *
+ * Arrays up to CRITICAL_PIN_LIMIT are parsed inside a single critical-region pin; the sink
+ * is deferred meanwhile so no JNI call happens until the array is released, and the
+ * tokens are delivered right after. Larger arrays are copied out in windows instead so
+ * the GC is never held off for long.
+ *
+ * With a cache probe the array is hashed in a first pass, since the probe is a JNI call
+ * and can't run while the array is pinned.
+ */
+void parseJavaBytes(ParserSession &session, JNIEnv *env, jbyteArray bytes, jint offset,
+                    jint length, jobject tokenStream, TokenSink &sink, Fingerprint fingerprint,
+                    jobject cacheProbe) {
+    if (!beginParse(session, env, tokenStream, sink, fingerprint)) {
+        endParse(session);
+        return;
+    }
+    if (cacheProbe) {
+        hashJavaBytes(session, bytes, offset, length);
+        if (probeCache(session, cacheProbe)) {
+            endParse(session);
+            return;
+        }
     }
 
-    static uint32_t sig1(uint32_t x) {
-        return rotr(x, 17) ^ rotr(x, 19) ^ (x >> 10);
+    bool ok;
+    if (static_cast<size_t>(length) <= CRITICAL_PIN_LIMIT) {
+        sink.setDeferred(true);
+        auto *pinned = static_cast<const char *>(env->GetPrimitiveArrayCritical(bytes, nullptr));
+        ok = pinned && feedMemory(session, pinned + offset, static_cast<size_t>(length));
+        if (pinned) env->ReleasePrimitiveArrayCritical(bytes, const_cast<char *>(pinned), JNI_ABORT);
+        sink.setDeferred(false);
+    } else {
+        char window[BUFFER_SIZE];
+        ok = true;
+        for (jint position = 0; ok && position < length; position += BUFFER_SIZE) {
+            jint chunk = min(BUFFER_SIZE, length - position);
+            env->GetByteArrayRegion(bytes, offset + position, chunk,
+                                    reinterpret_cast<jbyte *>(window));
+            ok = feedChunk(session, window, chunk, position + chunk == length);
+        }
     }
 
-    void transform() {
-        uint32_t a, b, c, d, e, f, g, h, i, j, t1, t2, m[64];
+    if (ok) completeParse(session);
+    endParse(session);
+}
+
+/**
+ * One input of a batch parse: either a file region (`fd` >= 0), mapped by the worker,
+ * or native memory. `tree` receives the serialized flat tree, and stays empty on failure.
+ */
+struct BatchDocument {
+    int fd = -1;
+    jlong offset = 0;
+    jlong length = -1;
+    const char *data = nullptr;
+    size_t size = 0;
+    vector<uint8_t> tree;
+};
 
-        for (i = 0, j = 0; i < 16; ++i, j += 4)
-            m[i] = (data[j] << 24) | (data[j + 1] << 16) | (data[j + 2] << 8) | (data[j + 3]);
-        for (; i < 64; ++i)
-            m[i] = sig1(m[i - 2]) + m[i - 7] + sig0(m[i - 15]) + m[i - 16];
+/**
+ * Parses a memory-resident document without JNI, writing its flat tree to `tree`. Setting
+ * `cancel` stops the parse at the next element and leaves `tree` empty.
+ */
+void parseToFlatTree(const char *data, size_t length, Fingerprint fingerprint,
+                     vector<uint8_t> &tree, const atomic<bool> *cancel = nullptr) {
+    SessionLease lease;
+    ParserSession &session = *lease;
+    FlatTreeSink sink(session, tree);
+    if (beginParse(session, nullptr, nullptr, sink, fingerprint)) {
+        session.cancel = cancel;
+        if (feedMemory(session, data, length)) completeParse(session);
+    }
+    endParse(session);
+}
 
-        a = state[0];
-        b = state[1];
-        c = state[2];
-        d = state[3];
-        e = state[4];
-        f = state[5];
-        g = state[6];
-        h = state[7];
+// Runs on a ParsePool worker
+void parseBatchDocument(BatchDocument &document, Fingerprint fingerprint,
+                        const atomic<bool> *cancel = nullptr) {
+    if (document.fd < 0) {
+        parseToFlatTree(document.data, document.size, fingerprint, document.tree, cancel);
+        return;
+    }
+    struct stat info{};
+    if (fstat(document.fd, &info) != 0 || !S_ISREG(info.st_mode) || document.offset < 0 ||
+        document.offset > info.st_size) {
+        LOGE("Batch input %d is not a mappable file region", document.fd);
+        return;
+    }
+    jlong available = info.st_size - document.offset;
+    jlong length = document.length < 0 ? available : min(document.length, available);
+    MappedRegion region(document.fd, static_cast<off_t>(document.offset),
+                        static_cast<size_t>(length));
+    if (length > 0 && !region.data) return;
+    parseToFlatTree(region.data, region.size, fingerprint, document.tree, cancel);
+}
 
-        for (i = 0; i < 64; ++i) {
-            t1 = h + ep1(e) + choose(e, f, g) + k[i] + m[i];
-            t2 = ep0(a) + majority(a, b, c);
-            h = g;
-            g = f;
-            f = e;
-            e = d + t1;
-            d = c;
-            c = b;
-            b = a;
-            a = t1 + t2;
+/**
+ * Parses every document on the shared ParsePool at the given priority and reports each
+ * flat tree through `BatchParseCallback.onResult(index, tree)` on the calling thread, in
+ * completion order.
+ * Returns only after every worker is done with `documents`, even if a callback throws;
+ * results after an exception are dropped.
+ */
+void parseBatch(JNIEnv *env, vector<BatchDocument> &documents, Fingerprint fingerprint,
+                ParsePriority priority, jobject callback) {
+    CompletionQueue completions;
+    vector<ParsePool::Task> tasks;
+    tasks.reserve(documents.size());
+    for (size_t i = 0; i < documents.size(); i++) {
+        tasks.emplace_back([&documents, &completions, fingerprint, i] {
+            parseBatchDocument(documents[i], fingerprint);
+            completions.push(i);
+        });
+    }
+    // A cancelled document (see cancelQueuedParses) is reported with a null tree
+    ParsePool::shared().submit(std::move(tasks), priority, [&completions](size_t i) {
+        return [&completions, i] { completions.push(i); };
+    });
+
+    for (size_t delivered = 0; delivered < documents.size(); delivered++) {
+        size_t index = completions.pop();
+        vector<uint8_t> tree = std::move(documents[index].tree);
+        if (env->ExceptionCheck()) continue;
+
+        jbyteArray array = nullptr;
+        if (!tree.empty()) {
+            array = env->NewByteArray(static_cast<jsize>(tree.size()));
+            if (!array) continue;
+            env->SetByteArrayRegion(array, 0, static_cast<jsize>(tree.size()),
+                                    reinterpret_cast<const jbyte *>(tree.data()));
         }
+        env->CallVoidMethod(callback, g_jni.onBatchResultMethod, static_cast<jint>(index), array);
+        if (array) env->DeleteLocalRef(array);
+    }
+}
+
+/**
+ * A parse submitted through the scheduler API. Holds global refs to its input buffer and
+ * callback, or its own dup of the descriptor, until the result has been delivered.
+ */
+struct ScheduledParse {
+    jlong id = 0;
+    BatchDocument document;
+    Fingerprint fingerprint = Fingerprint::SHA256;
+    jobject buffer = nullptr;
+    jobject callback = nullptr;
+    // Stops the parse once a worker has started it
+    atomic<bool> cancelled{false};
+};
+
+struct ScheduledEntry {
+    JobHandle job;
+    shared_ptr<ScheduledParse> parse;
+};
 
-        state[0] += a;
-        state[1] += b;
-        state[2] += c;
-        state[3] += d;
-        state[4] += e;
-        state[5] += f;
-        state[6] += g;
-        state[7] += h;
+// Scheduled parses by id, so Kotlin can boost or cancel them; entries leave on delivery
+mutex g_scheduledLock;
+unordered_map<jlong, ScheduledEntry> g_scheduled;
+atomic<jlong> g_nextScheduledId{1};
+
+/**
+ * Hands a scheduled parse's tree (null if it failed or was cancelled) to
+ * `ParseJobCallback.onFinished` and releases everything the parse held. Runs on the
+ * worker, or on the cancelling thread.
+ */
+void finishScheduledParse(ScheduledParse &parse) {
+    {
+        lock_guard<mutex> guard(g_scheduledLock);
+        g_scheduled.erase(parse.id);
+    }
+    if (parse.document.fd >= 0) close(parse.document.fd);
+
+    JNIEnv *env = attachedEnv();
+    if (!env) return;
+    vector<uint8_t> &tree = parse.document.tree;
+    jbyteArray array = nullptr;
+    if (!tree.empty()) {
+        array = env->NewByteArray(static_cast<jsize>(tree.size()));
+        if (array) {
+            env->SetByteArrayRegion(array, 0, static_cast<jsize>(tree.size()),
+                                    reinterpret_cast<const jbyte *>(tree.data()));
+        } else {
+            env->ExceptionClear();
+        }
     }
+    env->CallVoidMethod(parse.callback, g_jni.onJobFinishedMethod, array);
+    if (env->ExceptionCheck()) {
+        LOGE("ParseJobCallback.onFinished threw for job %lld", static_cast<long long>(parse.id));
+        env->ExceptionClear();
+    }
+    // Worker threads never return to Java, so their local refs must go by hand
+    if (array) env->DeleteLocalRef(array);
+    env->DeleteGlobalRef(parse.callback);
+    if (parse.buffer) env->DeleteGlobalRef(parse.buffer);
+}
+
+// Queues a prepared parse on the shared pool and returns its id
+jlong scheduleParse(JNIEnv *env, shared_ptr<ScheduledParse> parse, jobject callback,
+                    ParsePriority priority) {
+    parse->id = g_nextScheduledId.fetch_add(1, memory_order_relaxed);
+    parse->callback = env->NewGlobalRef(callback);
+
+    // Registered under the lock so a fast worker can't unregister the job before this does
+    lock_guard<mutex> guard(g_scheduledLock);
+    JobHandle job = ParsePool::shared().submit(
+            [parse] {
+                parseBatchDocument(parse->document, parse->fingerprint, &parse->cancelled);
+                if (parse->cancelled.load(memory_order_relaxed)) parse->document.tree.clear();
+                finishScheduledParse(*parse);
+            },
+            priority,
+            [parse] {
+                parse->document.tree.clear();
+                finishScheduledParse(*parse);
+            });
+    g_scheduled[parse->id] = ScheduledEntry{std::move(job), parse};
+    return parse->id;
+}
+
+ScheduledEntry findScheduledParse(jlong id) {
+    lock_guard<mutex> guard(g_scheduledLock);
+    auto entry = g_scheduled.find(id);
+    return entry == g_scheduled.end() ? ScheduledEntry{} : entry->second;
+}
 
+/**
+ * A parse run in time slices: each call to advance() parses until its budget is spent,
+ * then suspends Expat with XML_StopParser(resumable) and returns, so a large layout can
+ * be spread over several frames without holding a thread. The next call picks up with
+ * XML_ResumeParser exactly where the last one stopped.
+ *
+ * The parse owns its session rather than leasing one, since slices may run on different
+ * threads; they must not overlap. The document is a direct buffer kept alive by a global
+ * ref, and the result is a flat tree.
+ */
+class SlicedParse {
 public:
-    SHA256() {
-        reset();
+    enum Status : jint {
+        SUSPENDED = 0,
+        FINISHED = 1,
+        FAILED = 2,
+        CANCELLED = 3,
+    };
+
+    SlicedParse(const char *data, size_t size, Fingerprint fingerprint)
+            : data(data), size(size), sink(session, tree) {
+        if (!beginParse(session, nullptr, nullptr, sink, fingerprint)) {
+            status = FAILED;
+            return;
+        }
+        session.cancel = &cancelled;
+    }
+
+    ~SlicedParse() {
+        endParse(session);
     }
 
-    void reset() {
-        datalen = 0;
-        bitlen = 0;
-        state[0] = 0x6a09e667;
-        state[1] = 0xbb67ae85;
-        state[2] = 0x3c6ef372;
-        state[3] = 0xa54ff53a;
-        state[4] = 0x510e527f;
-        state[5] = 0x9b05688c;
-        state[6] = 0x1f83d9ab;
-        state[7] = 0x5be0cd19;
-    }
-
-    void update(const uint8_t *inputData, size_t len) {
-        for (size_t i = 0; i < len; ++i) {
-            this->data[datalen] = inputData[i];
-            datalen++;
-            if (datalen == 64) {
-                transform();
-                bitlen += 512;
-                datalen = 0;
+    SlicedParse(const SlicedParse &) = delete;
+
+    SlicedParse &operator=(const SlicedParse &) = delete;
+
+    // Parses for about `budgetNanos` and reports where the parse stands
+    Status advance(uint64_t budgetNanos) {
+        if (status != SUSPENDED) return status;
+        session.sliceDeadline = nowNanos() + max<uint64_t>(budgetNanos, 1);
+        session.suspending = false;
+        SlabHeap::Scope heapScope(session.expatHeap);
+        XML_Parser parser = session.parser.get();
+
+        while (true) {
+            if (cancelled.load(memory_order_relaxed)) return status = CANCELLED;
+            XML_Status result;
+            if (windowSuspended) {
+                result = XML_ResumeParser(parser);
+            } else {
+                if (finalFed) break;
+                size_t window = min(MAPPED_WINDOW_SIZE, size - offset);
+                bool isFinal = offset + window == size;
+                if (window > 0) {
+                    session.hasher->update(reinterpret_cast<const uint8_t *>(data + offset),
+                                           window);
+                }
+                result = XML_Parse(parser, data + offset, static_cast<int>(window), isFinal);
+                offset += window;
+                finalFed = isFinal;
+            }
+
+            windowSuspended = result == XML_STATUS_SUSPENDED;
+            if (windowSuspended) return status;
+            if (result == XML_STATUS_ERROR) {
+                logParseError(session);
+                return status = session.halted ? CANCELLED : FAILED;
             }
+            // Between windows Expat isn't running, so the deadline is checked here too
+            if (!finalFed && nowNanos() >= session.sliceDeadline) return status;
         }
+
+        completeParse(session);
+        return status = tree.empty() ? FAILED : FINISHED;
     }
 
-    void final(uint8_t *hash) {
-        uint32_t i = datalen;
+    Status current() const {
+        return status;
+    }
 
-        if (datalen < 56) {
-            data[i++] = 0x80;
-            while (i < 56)
-                data[i++] = 0x00;
-        } else {
-            data[i++] = 0x80;
-            while (i < 64)
-                data[i++] = 0x00;
-            transform();
-            memset(data, 0, 56);
-        }
-
-        bitlen += datalen * 8;
-        data[63] = bitlen;
-        data[62] = bitlen >> 8;
-        data[61] = bitlen >> 16;
-        data[60] = bitlen >> 24;
-        data[59] = bitlen >> 32;
-        data[58] = bitlen >> 40;
-        data[57] = bitlen >> 48;
-        data[56] = bitlen >> 56;
-        transform();
-
-        for (i = 0; i < 4; ++i) {
-            hash[i] = (state[0] >> (24 - i * 8)) & 0x000000ff;
-            hash[i + 4] = (state[1] >> (24 - i * 8)) & 0x000000ff;
-            hash[i + 8] = (state[2] >> (24 - i * 8)) & 0x000000ff;
-            hash[i + 12] = (state[3] >> (24 - i * 8)) & 0x000000ff;
-            hash[i + 16] = (state[4] >> (24 - i * 8)) & 0x000000ff;
-            hash[i + 20] = (state[5] >> (24 - i * 8)) & 0x000000ff;
-            hash[i + 24] = (state[6] >> (24 - i * 8)) & 0x000000ff;
-            hash[i + 28] = (state[7] >> (24 - i * 8)) & 0x000000ff;
-        }
+    // Safe from any thread; the running or next slice stops at the next element
+    void cancel() {
+        cancelled.store(true, memory_order_relaxed);
+    }
+
+    vector<uint8_t> &result() {
+        return tree;
     }
+
+    jobject buffer = nullptr;
+
+private:
+    const char *data;
+    size_t size;
+    size_t offset = 0;
+    bool finalFed = false;
+    // Expat holds a window it has only partly parsed and must be resumed, not fed
+    bool windowSuspended = false;
+    Status status = SUSPENDED;
+    atomic<bool> cancelled{false};
+    ParserSession session;
+    vector<uint8_t> tree;
+    FlatTreeSink sink;
 };
 
-// SHA256 constants
-const uint32_t SHA256::k[64] = {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b,
-                                0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01,
-                                0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7,
-                                0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
-                                0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152,
-                                0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
-                                0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
-                                0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-                                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819,
-                                0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08,
-                                0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
-                                0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
-                                0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
-
-/**
- * Thread-local storage for parser state.
- * This structure maintains the state of the XML parsing process.
- */
-thread_local struct ParserState {
-    JNIEnv *env;
-    jobject tokenStream;
-    jmethodID onTokenMethod;
-    jmethodID onCompleteMethod;
-    SHA256 sha256;
-    uint8_t hash[SHA256_DIGEST_LENGTH];
-    string currentText;
+/**
+ * A parse streaming its tokens through a TokenRing to a Kotlin consumer. The parse runs
+ * on the shared ParsePool; the consumer reads the ring's data through a direct buffer and
+ * only calls in (awaitTokenRing) when it has drained everything published.
+ */
+struct RingParse {
+    explicit RingParse(size_t capacity) : ring(capacity) {}
+
+    TokenRing ring;
+    const char *data = nullptr;
+    size_t size = 0;
+    Fingerprint fingerprint = Fingerprint::SHA256;
+    uint32_t publishDepth = TokenRingWriter::PUBLISH_EVERY_RECORD;
+    jobject buffer = nullptr;
+    JobHandle job;
+    // Set when the consumer closes early, so the parse stops at the next element
+    atomic<bool> cancelled{false};
+    mutex lock;
+    condition_variable producerDone;
+    bool finished = false;
+
+    // Runs on a ParsePool worker
+    void produce() {
+        {
+            SessionLease lease;
+            ParserSession &session = *lease;
+            RingTokenSink sink(session, ring, publishDepth);
+            if (beginParse(session, nullptr, nullptr, sink, fingerprint)) {
+                session.cancel = &cancelled;
+                if (feedMemory(session, data, size)) completeParse(session);
+            }
+            sink.close();
+            endParse(session);
+        }
+        markFinished();
+    }
 
-    // Constructor initializes the state
-    ParserState() : env(nullptr), tokenStream(nullptr), onTokenMethod(nullptr),
-                    onCompleteMethod(nullptr) {
-        sha256.reset();
+    void markFinished() {
+        lock_guard<mutex> guard(lock);
+        finished = true;
+        producerDone.notify_all();
     }
-} g_state;
-
-// Helper function to create a Java Map from attributes
-jobject createAttributeMap(JNIEnv *env, const char **attributes) {
-    jclass mapClass = env->FindClass("androidx/collection/ArrayMap");
-    jmethodID mapConstructor = env->GetMethodID(mapClass, "<init>", "()V");
-    jmethodID putMethod = env->GetMethodID(mapClass, "put",
-                                           "(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;");
-
-    jobject map = env->NewObject(mapClass, mapConstructor);
-
-    for (const char **attr = attributes; *attr; attr += 2) {
-        const char *key = *attr;
-        while (*key && *key != ':') key++;
-        if (*key) key++;
-        jstring keyStr = env->NewStringUTF(key);
-        jstring value = env->NewStringUTF(attr[1] ? attr[1] : "");
-        env->CallObjectMethod(map, putMethod, keyStr, value);
-        env->DeleteLocalRef(keyStr);
-        env->DeleteLocalRef(value);
+
+    // Stops the parse if it is still going and waits until it no longer reads the document
+    void stop() {
+        cancelled.store(true, memory_order_relaxed);
+        ring.cancel();
+        if (ParsePool::shared().cancel(job)) return;
+        unique_lock<mutex> guard(lock);
+        producerDone.wait(guard, [this] { return finished; });
     }
+};
 
-    return map;
-}
+/**
+ * A parse fed by the caller, chunk by chunk, as bytes arrive (e.g. from the network), over
+ * any number of native calls. Each chunk is hashed and parsed on arrival, so the result
+ * is ready right after the last one.
+ *
+ * Like SlicedParse it owns its session, since feeds may come from different threads; they
+ * must not overlap. The token stream is held as a global ref, and the sink is rebound to
+ * each call's JNIEnv.
+ */
+class PushParse {
+public:
+    PushParse(JNIEnv *env, jobject tokenStream, Fingerprint fingerprint)
+            : tokenStream(env->NewGlobalRef(tokenStream)),
+              sink(createSink(session, env, this->tokenStream, true)) {
+        ok = beginParse(session, env, this->tokenStream, *sink, fingerprint);
+    }
 
-// Helper function to create a StartElement token
-void createStartElementToken(const char *name, const char **attributes) {
-    JNIEnv *env = g_state.env;
+    PushParse(const PushParse &) = delete;
 
-    // Create attribute map
-    jobject attrMap = createAttributeMap(env, attributes);
+    PushParse &operator=(const PushParse &) = delete;
 
-    // Create StartElement token
-    jclass tokenClass = env->FindClass("com/voyager/core/data/utils/XmlToken$StartElement");
-    jmethodID constructor = env->GetMethodID(tokenClass, "<init>",
-                                             "(Ljava/lang/String;Landroidx/collection/ArrayMap;)V");
+    // Parses the next chunk and hands its tokens on; false once the document is malformed
+    bool feed(JNIEnv *env, const char *data, size_t length) {
+        bind(env);
+        ok = ok && feedChunk(session, data, length, false);
+        if (ok) sink->flush();
+        return ok;
+    }
 
-    jstring typeStr = env->NewStringUTF(name);
-    jobject token = env->NewObject(tokenClass, constructor, typeStr, attrMap);
+    // Feeds a Java array region through a native window, never pinning the array
+    bool feed(JNIEnv *env, jbyteArray bytes, jint offset, jint length) {
+        char window[BUFFER_SIZE];
+        for (jint position = 0; ok && position < length; position += BUFFER_SIZE) {
+            jint chunk = min(BUFFER_SIZE, length - position);
+            env->GetByteArrayRegion(bytes, offset + position, chunk,
+                                    reinterpret_cast<jbyte *>(window));
+            bind(env);
+            ok = feedChunk(session, window, static_cast<size_t>(chunk), false);
+        }
+        if (ok) sink->flush();
+        return ok;
+    }
 
-    // Call onToken
-    env->CallVoidMethod(g_state.tokenStream, g_state.onTokenMethod, token);
+    // Ends the document and reports the result through the token stream
+    bool finish(JNIEnv *env) {
+        bind(env);
+        ok = ok && feedChunk(session, nullptr, 0, true);
+        if (ok) completeParse(session);
+        return ok;
+    }
 
-    // Clean up
-    env->DeleteLocalRef(token);
-    env->DeleteLocalRef(typeStr);
-    env->DeleteLocalRef(attrMap);
-}
+    // Drops the parse's JNI references; call once, right before deleting it
+    void release(JNIEnv *env) {
+        bind(env);
+        endParse(session);
+        sink.reset();
+        env->DeleteGlobalRef(tokenStream);
+    }
 
-// Helper function to create an EndElement token
-void createEndElementToken(const char *name) {
-    JNIEnv *env = g_state.env;
+private:
+    ParserSession session;
+    jobject tokenStream;
+    unique_ptr<TokenSink> sink;
+    bool ok = false;
 
-    jclass tokenClass = env->FindClass("com/voyager/core/data/utils/XmlToken$EndElement");
-    jmethodID constructor = env->GetMethodID(tokenClass, "<init>", "(Ljava/lang/String;)V");
+    void bind(JNIEnv *env) {
+        session.env = env;
+        sink->rebind(env);
+    }
+};
 
-    jstring typeStr = env->NewStringUTF(name);
-    jobject token = env->NewObject(tokenClass, constructor, typeStr);
+extern "C" JNIEXPORT void JNICALL
+Java_com_voyager_core_data_utils_FileHelper_parseXML(JNIEnv *env, jobject /* this */,
+                                                     jobject inputStream, jobject tokenStream,
+                                                     jint fingerprint) {
+    LOGD("parseXML JNI function called");
+    SessionLease session;
+    ObjectTokenSink sink(*session, env);
+    parseStream(*session, env, inputStream, tokenStream, sink, toFingerprint(fingerprint),
+                nullptr);
+}
 
-    // Call onToken
-    env->CallVoidMethod(g_state.tokenStream, g_state.onTokenMethod, token);
+extern "C" JNIEXPORT void JNICALL
+Java_com_voyager_core_data_utils_FileHelper_parseXMLBatched(JNIEnv *env, jobject /* this */,
+                                                            jobject inputStream,
+                                                            jobject tokenStream,
+                                                            jint fingerprint,
+                                                            jobject cacheProbe) {
+    LOGD("parseXMLBatched JNI function called");
+    SessionLease session;
+    unique_ptr<TokenSink> sink = createSink(*session, env, tokenStream);
+    parseStream(*session, env, inputStream, tokenStream, *sink, toFingerprint(fingerprint),
+                cacheProbe);
+}
 
-    // Clean up
-    env->DeleteLocalRef(token);
-    env->DeleteLocalRef(typeStr);
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_voyager_core_data_utils_FileHelper_parseXMLFd(JNIEnv *env, jobject /* this */, jint fd,
+                                                       jlong offset, jlong length,
+                                                       jobject tokenStream, jint fingerprint,
+                                                       jobject cacheProbe) {
+    LOGD("parseXMLFd JNI function called");
+    SessionLease session;
+    unique_ptr<TokenSink> sink = createSink(*session, env, tokenStream);
+    return parseFileDescriptor(*session, env, fd, offset, length, tokenStream, *sink,
+                               toFingerprint(fingerprint), cacheProbe) ? JNI_TRUE : JNI_FALSE;
 }
 
-// Helper function to create a Text token
-void createTextToken(const string &text) {
-    if (text.empty()) return;
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_voyager_core_data_utils_FileHelper_openStatKeyIndex(JNIEnv *env, jobject /* this */,
+                                                             jstring path) {
+    const char *chars = env->GetStringUTFChars(path, nullptr);
+    if (!chars) return JNI_FALSE;
+    bool opened = g_statKeyIndex.open(chars);
+    env->ReleaseStringUTFChars(path, chars);
+    if (!opened) LOGE("Could not open the stat key index");
+    return opened ? JNI_TRUE : JNI_FALSE;
+}
 
-    JNIEnv *env = g_state.env;
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_voyager_core_data_utils_FileHelper_openLayoutStore(JNIEnv *env, jobject /* this */,
+                                                            jstring directory, jlong maxBytes) {
+    const char *chars = env->GetStringUTFChars(directory, nullptr);
+    if (!chars) return JNI_FALSE;
+    bool opened = maxBytes > 0 && g_layoutStore.open(chars, static_cast<size_t>(maxBytes));
+    env->ReleaseStringUTFChars(directory, chars);
+    if (!opened) LOGE("Could not open the compiled layout store");
+    return opened ? JNI_TRUE : JNI_FALSE;
+}
 
-    jclass tokenClass = env->FindClass("com/voyager/core/data/utils/XmlToken$Text");
-    jmethodID constructor = env->GetMethodID(tokenClass, "<init>", "(Ljava/lang/String;)V");
+extern "C" JNIEXPORT void JNICALL
+Java_com_voyager_core_data_utils_FileHelper_parseXMLDirect(JNIEnv *env, jobject /* this */,
+                                                           jobject buffer, jint offset,
+                                                           jint length, jobject tokenStream,
+                                                           jint fingerprint, jobject cacheProbe) {
+    LOGD("parseXMLDirect JNI function called");
+    auto *address = static_cast<const char *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (!address || offset < 0 || length < 0 || offset + static_cast<jlong>(length) > capacity) {
+        LOGE("Invalid direct buffer region for parseXMLBuffer");
+        return;
+    }
+    SessionLease session;
+    unique_ptr<TokenSink> sink = createSink(*session, env, tokenStream);
+    parseNativeMemory(*session, env, address + offset, static_cast<size_t>(length), tokenStream,
+                      *sink, toFingerprint(fingerprint), cacheProbe);
+}
 
-    jstring textStr = env->NewStringUTF(text.c_str());
-    jobject token = env->NewObject(tokenClass, constructor, textStr);
+extern "C" JNIEXPORT void JNICALL
+Java_com_voyager_core_data_utils_FileHelper_parseXMLBytes(JNIEnv *env, jobject /* this */,
+                                                          jbyteArray bytes, jint offset,
+                                                          jint length, jobject tokenStream,
+                                                          jint fingerprint, jobject cacheProbe) {
+    LOGD("parseXMLBytes JNI function called");
+    if (offset < 0 || length < 0 || offset + static_cast<jlong>(length) > env->GetArrayLength(bytes)) {
+        LOGE("Invalid byte array region for parseXMLBytes");
+        return;
+    }
+    SessionLease session;
+    unique_ptr<TokenSink> sink = createSink(*session, env, tokenStream);
+    parseJavaBytes(*session, env, bytes, offset, length, tokenStream, *sink,
+                   toFingerprint(fingerprint), cacheProbe);
+}
 
-    // Call onToken
-    env->CallVoidMethod(g_state.tokenStream, g_state.onTokenMethod, token);
+/**
+ * Compiles a layout to bytecode of the given format `version` in one parse (see
+ * BytecodeCompiler), with `activityName` recorded in the output. Returns nullptr for
+ * malformed XML. The bytecode is copied to Java once; no token or string crosses JNI.
+ */
+template<typename Parse>
+jbyteArray compileLayout(JNIEnv *env, jstring activityName, jint version, Parse &&parse) {
+    if (version != BytecodeCompiler::VERSION_1 && version != BytecodeCompiler::VERSION_2) {
+        LOGE("Unknown bytecode version %d", version);
+        return nullptr;
+    }
+    const char *activity = env->GetStringUTFChars(activityName, nullptr);
+    if (!activity) return nullptr;
+    auto timestamp = static_cast<int32_t>(chrono::duration_cast<chrono::milliseconds>(
+            chrono::system_clock::now().time_since_epoch()).count());
+    SessionLease session;
+    BytecodeSink sink(*session, activity, static_cast<uint8_t>(version), timestamp);
+    parse(*session, sink);
+    env->ReleaseStringUTFChars(activityName, activity);
+    return sink.toJavaArray(env);
+}
 
-    // Clean up
-    env->DeleteLocalRef(token);
-    env->DeleteLocalRef(textStr);
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_voyager_core_data_utils_FileHelper_compileLayoutDirect(JNIEnv *env, jobject /* this */,
+                                                                jobject buffer, jint offset,
+                                                                jint length, jstring activityName,
+                                                                jint version) {
+    auto *address = static_cast<const char *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (!address || offset < 0 || length < 0 || offset + static_cast<jlong>(length) > capacity) {
+        LOGE("Invalid direct buffer region for compileLayoutDirect");
+        return nullptr;
+    }
+    return compileLayout(env, activityName, version, [&](ParserSession &session, TokenSink &sink) {
+        parseNativeMemory(session, env, address + offset, static_cast<size_t>(length), nullptr,
+                          sink, Fingerprint::XXH3_128, nullptr);
+    });
 }
 
-// XML start element handler
-void XMLCALL startElement(void *userData, const char *name, const char **attributes) {
-    // Send any accumulated text
-    if (!g_state.currentText.empty()) {
-        createTextToken(g_state.currentText);
-        g_state.currentText.clear();
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_voyager_core_data_utils_FileHelper_compileLayoutBytes(JNIEnv *env, jobject /* this */,
+                                                               jbyteArray bytes, jint offset,
+                                                               jint length, jstring activityName,
+                                                               jint version) {
+    if (offset < 0 || length < 0 || offset + static_cast<jlong>(length) > env->GetArrayLength(bytes)) {
+        LOGE("Invalid byte array region for compileLayoutBytes");
+        return nullptr;
     }
+    return compileLayout(env, activityName, version, [&](ParserSession &session, TokenSink &sink) {
+        parseJavaBytes(session, env, bytes, offset, length, nullptr, sink, Fingerprint::XXH3_128,
+                       nullptr);
+    });
+}
 
-    createStartElementToken(name, attributes);
+extern "C" JNIEXPORT void JNICALL
+Java_com_voyager_core_data_utils_FileHelper_parseXMLBatchFds(JNIEnv *env, jobject /* this */,
+                                                             jintArray fds, jlongArray offsets,
+                                                             jlongArray lengths, jint fingerprint,
+                                                             jint priority, jobject callback) {
+    LOGD("parseXMLBatchFds JNI function called");
+    jsize count = env->GetArrayLength(fds);
+    if (env->GetArrayLength(offsets) != count || env->GetArrayLength(lengths) != count) {
+        LOGE("parseXMLBatchFds: fds, offsets and lengths differ in size");
+        return;
+    }
+    vector<jint> fdValues(count);
+    vector<jlong> offsetValues(count);
+    vector<jlong> lengthValues(count);
+    env->GetIntArrayRegion(fds, 0, count, fdValues.data());
+    env->GetLongArrayRegion(offsets, 0, count, offsetValues.data());
+    env->GetLongArrayRegion(lengths, 0, count, lengthValues.data());
+
+    vector<BatchDocument> documents(static_cast<size_t>(count));
+    for (jsize i = 0; i < count; i++) {
+        documents[i].fd = fdValues[i];
+        documents[i].offset = offsetValues[i];
+        documents[i].length = lengthValues[i];
+    }
+    parseBatch(env, documents, toFingerprint(fingerprint), toPriority(priority), callback);
 }
 
-// XML end element handler
-void XMLCALL endElement(void *userData, const char *name) {
-    // Send any accumulated text
-    if (!g_state.currentText.empty()) {
-        createTextToken(g_state.currentText);
-        g_state.currentText.clear();
+extern "C" JNIEXPORT void JNICALL
+Java_com_voyager_core_data_utils_FileHelper_parseXMLBatchDirect(JNIEnv *env, jobject /* this */,
+                                                                jobjectArray buffers,
+                                                                jint fingerprint, jint priority,
+                                                                jobject callback) {
+    LOGD("parseXMLBatchDirect JNI function called");
+    jsize count = env->GetArrayLength(buffers);
+    vector<BatchDocument> documents(static_cast<size_t>(count));
+    for (jsize i = 0; i < count; i++) {
+        jobject buffer = env->GetObjectArrayElement(buffers, i);
+        documents[i].data = static_cast<const char *>(env->GetDirectBufferAddress(buffer));
+        jlong capacity = env->GetDirectBufferCapacity(buffer);
+        env->DeleteLocalRef(buffer);
+        if (!documents[i].data || capacity < 0) {
+            LOGE("parseXMLBatchDirect: buffer %d is not a direct buffer", i);
+            return;
+        }
+        documents[i].size = static_cast<size_t>(capacity);
     }
+    // The buffers stay reachable through `buffers` until this call returns
+    parseBatch(env, documents, toFingerprint(fingerprint), toPriority(priority), callback);
+}
 
-    createEndElementToken(name);
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_voyager_core_data_utils_FileHelper_submitParseDirect(JNIEnv *env, jobject /* this */,
+                                                              jobject buffer, jint fingerprint,
+                                                              jint priority, jobject callback) {
+    auto parse = make_shared<ScheduledParse>();
+    parse->document.data = static_cast<const char *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (!parse->document.data || capacity < 0) {
+        LOGE("submitParseDirect: not a direct buffer");
+        return 0;
+    }
+    parse->document.size = static_cast<size_t>(capacity);
+    parse->fingerprint = toFingerprint(fingerprint);
+    parse->buffer = env->NewGlobalRef(buffer);
+    return scheduleParse(env, parse, callback, toPriority(priority));
 }
 
-// XML character data handler
-void XMLCALL characterData(void *userData, const char *s, int len) {
-    g_state.currentText.append(s, len);
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_voyager_core_data_utils_FileHelper_submitParseFd(JNIEnv *env, jobject /* this */, jint fd,
+                                                          jlong offset, jlong length,
+                                                          jint fingerprint, jint priority,
+                                                          jobject callback) {
+    // The job keeps its own descriptor, so the caller may close theirs right away
+    int owned = dup(fd);
+    if (owned < 0) {
+        LOGE("submitParseFd: dup failed: %s", strerror(errno));
+        return 0;
+    }
+    auto parse = make_shared<ScheduledParse>();
+    parse->document.fd = owned;
+    parse->document.offset = offset;
+    parse->document.length = length;
+    parse->fingerprint = toFingerprint(fingerprint);
+    return scheduleParse(env, parse, callback, toPriority(priority));
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_voyager_core_data_utils_FileHelper_parseXML(JNIEnv *env, jobject /* this */,
-                                                     jobject inputStream, jobject tokenStream) {
-    LOGD("parseXML JNI function called");
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_voyager_core_data_utils_FileHelper_boostParse(JNIEnv * /* env */, jobject /* this */,
+                                                       jlong jobId, jint priority) {
+    JobHandle job = findScheduledParse(jobId).job;
+    return job && ParsePool::shared().boost(job, toPriority(priority)) ? JNI_TRUE : JNI_FALSE;
+}
 
-    // Store JNI references
-    g_state.env = env;
-    g_state.tokenStream = env->NewGlobalRef(tokenStream);
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_voyager_core_data_utils_FileHelper_cancelParse(JNIEnv * /* env */, jobject /* this */,
+                                                        jlong jobId) {
+    ScheduledEntry entry = findScheduledParse(jobId);
+    if (!entry.job) return JNI_FALSE;
+    if (ParsePool::shared().cancel(entry.job)) return JNI_TRUE;
+    // Already running: ask it to stop at the next element. It may finish first, so this
+    // doesn't count as cancelled
+    entry.parse->cancelled.store(true, memory_order_relaxed);
+    return JNI_FALSE;
+}
 
-    // Prepare variables at the top to avoid goto over declaration
-    jbyteArray hashArray = nullptr;
-    bool done = false;
-    jbyteArray byteBuffer = nullptr;
+extern "C" JNIEXPORT jint JNICALL
+Java_com_voyager_core_data_utils_FileHelper_cancelQueuedParses(JNIEnv * /* env */,
+                                                               jobject /* this */,
+                                                               jint priority) {
+    return static_cast<jint>(ParsePool::shared().cancelQueued(toPriority(priority)));
+}
 
-    // Create and configure XML parser
-    unique_ptr<XML_ParserStruct, decltype(&XML_ParserFree)> parser(XML_ParserCreate(nullptr),
-                                                                   XML_ParserFree);
+/**
+ * Starts parsing a whole direct buffer (position 0 to capacity) on the shared ParsePool
+ * into a new token ring of at least `capacity` bytes. Records are published once the
+ * element depth after them is at most `publishDepth` (1: whole subtrees of the root; a
+ * negative value: every record). Returns a handle for the other `*TokenRing` functions,
+ * or 0 if `buffer` is not direct.
+ */
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_voyager_core_data_utils_FileHelper_openTokenRing(JNIEnv *env, jobject /* this */,
+                                                          jobject buffer, jint fingerprint,
+                                                          jint priority, jint capacity,
+                                                          jint publishDepth) {
+    auto *data = static_cast<const char *>(env->GetDirectBufferAddress(buffer));
+    jlong size = env->GetDirectBufferCapacity(buffer);
+    if (!data || size < 0 || capacity <= 0) {
+        LOGE("openTokenRing: not a direct buffer");
+        return 0;
+    }
+    auto parse = make_shared<RingParse>(static_cast<size_t>(capacity));
+    parse->data = data;
+    parse->size = static_cast<size_t>(size);
+    parse->fingerprint = toFingerprint(fingerprint);
+    if (publishDepth >= 0) parse->publishDepth = static_cast<uint32_t>(publishDepth);
+    parse->buffer = env->NewGlobalRef(buffer);
+    parse->job = ParsePool::shared().submit(
+            [parse] { parse->produce(); },
+            toPriority(priority),
+            [parse] {
+                parse->ring.close();
+                parse->markFinished();
+            });
+    return reinterpret_cast<jlong>(new shared_ptr<RingParse>(parse));
+}
 
-    // Get token stream methods
-    jclass tokenStreamClass = env->GetObjectClass(tokenStream);
-    g_state.onTokenMethod = env->GetMethodID(tokenStreamClass, "onToken",
-                                             "(Lcom/voyager/core/data/utils/XmlToken;)V");
-    g_state.onCompleteMethod = env->GetMethodID(tokenStreamClass, "onComplete", "([B)V");
+// A direct ByteBuffer over the ring's data area, valid until closeTokenRing
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_voyager_core_data_utils_FileHelper_tokenRingBuffer(JNIEnv *env, jobject /* this */,
+                                                            jlong handle) {
+    TokenRing &ring = (*reinterpret_cast<shared_ptr<RingParse> *>(handle))->ring;
+    return env->NewDirectByteBuffer(ring.data(), static_cast<jlong>(ring.capacity()));
+}
 
-    // Get InputStream class and read method
-    jclass inputStreamClass = env->GetObjectClass(inputStream);
-    jmethodID readMethod = env->GetMethodID(inputStreamClass, "read", "([B)I");
-    if (!readMethod) {
-        LOGE("Failed to find InputStream.read method");
-        goto cleanup;
-    }
+/**
+ * Releases the ring up to `consumed` and blocks until records past it are published.
+ * Returns the end of the readable records; equal to `consumed` once the ring is closed
+ * and drained.
+ */
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_voyager_core_data_utils_FileHelper_awaitTokenRing(JNIEnv * /* env */,
+                                                           jobject /* this */, jlong handle,
+                                                           jlong consumed) {
+    TokenRing &ring = (*reinterpret_cast<shared_ptr<RingParse> *>(handle))->ring;
+    return static_cast<jlong>(ring.await(static_cast<uint64_t>(consumed)));
+}
 
-    // Allocate Java byte array for reading
-    byteBuffer = env->NewByteArray(BUFFER_SIZE);
-    if (!byteBuffer) {
-        LOGE("Failed to allocate byte array");
-        goto cleanup;
+// Stops the parse if it is still running and frees the ring; the handle is invalid afterwards
+extern "C" JNIEXPORT void JNICALL
+Java_com_voyager_core_data_utils_FileHelper_closeTokenRing(JNIEnv *env, jobject /* this */,
+                                                           jlong handle) {
+    unique_ptr<shared_ptr<RingParse>> parse(reinterpret_cast<shared_ptr<RingParse> *>(handle));
+    (*parse)->stop();
+    env->DeleteGlobalRef((*parse)->buffer);
+}
+
+/**
+ * Maps the layout bundle in `length` bytes at `offset` of `fd` (to the end if negative)
+ * and returns its handle for the other `*LayoutBundle*` functions, or 0 if it is not a
+ * valid bundle. The descriptor may be closed afterwards.
+ */
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_voyager_core_data_utils_FileHelper_openLayoutBundle(JNIEnv * /* env */,
+                                                             jobject /* this */, jint fd,
+                                                             jlong offset, jlong length) {
+    auto bundle = make_unique<LayoutBundle>();
+    if (!bundle->open(fd, offset, length)) {
+        LOGE("Descriptor %d does not hold a valid layout bundle", fd);
+        return 0;
     }
+    return reinterpret_cast<jlong>(bundle.release());
+}
 
-    if (!parser) {
-        LOGE("Error creating XML parser");
-        env->DeleteLocalRef(byteBuffer);
-        goto cleanup;
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_voyager_core_data_utils_FileHelper_layoutBundleNames(JNIEnv *env, jobject /* this */,
+                                                              jlong handle) {
+    auto *bundle = reinterpret_cast<LayoutBundle *>(handle);
+    jobjectArray names = env->NewObjectArray(static_cast<jsize>(bundle->size()),
+                                             g_jni.stringClass, nullptr);
+    if (!names) return nullptr;
+    string name;
+    for (uint32_t i = 0; i < bundle->size(); i++) {
+        name.assign(bundle->name(i));
+        jstring value = env->NewStringUTF(name.c_str());
+        if (!value) return nullptr;
+        env->SetObjectArrayElement(names, static_cast<jsize>(i), value);
+        env->DeleteLocalRef(value);
     }
+    return names;
+}
 
-    // Set up element handlers
-    XML_SetElementHandler(parser.get(), startElement, endElement);
-    XML_SetCharacterDataHandler(parser.get(), characterData);
+/**
+ * Returns the flat tree of layout `name` as a direct buffer over the mapped bundle, or
+ * null if there is none. Short names are looked up without allocating.
+ */
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_voyager_core_data_utils_FileHelper_layoutBundleRecord(JNIEnv *env, jobject /* this */,
+                                                               jlong handle, jstring name) {
+    auto *bundle = reinterpret_cast<LayoutBundle *>(handle);
+    LayoutBundle::Record record{};
+    bool found;
+    jsize length = env->GetStringUTFLength(name);
+    char chars[256];
+    if (static_cast<size_t>(length) < sizeof(chars)) {
+        env->GetStringUTFRegion(name, 0, env->GetStringLength(name), chars);
+        found = bundle->find(string_view(chars, static_cast<size_t>(length)), record);
+    } else {
+        const char *longName = env->GetStringUTFChars(name, nullptr);
+        if (!longName) return nullptr;
+        found = bundle->find(longName, record);
+        env->ReleaseStringUTFChars(name, longName);
+    }
+    if (!found) return nullptr;
+    return env->NewDirectByteBuffer(const_cast<uint8_t *>(record.data),
+                                    static_cast<jlong>(record.length));
+}
 
-    // Allocate native buffer for processing
-    char nativeBuffer[BUFFER_SIZE];
+extern "C" JNIEXPORT void JNICALL
+Java_com_voyager_core_data_utils_FileHelper_closeLayoutBundle(JNIEnv * /* env */,
+                                                              jobject /* this */, jlong handle) {
+    delete reinterpret_cast<LayoutBundle *>(handle);
+}
 
-    // Process XML data in chunks
-    while (!done) {
-        // Read chunk from InputStream
-        jint bytesRead = env->CallIntMethod(inputStream, readMethod, byteBuffer);
+/**
+ * Starts a push parse delivering to `tokenStream` and returns its handle for the other
+ * `*PushParse` functions. Ends with finishPushParse, or abortPushParse to drop it.
+ */
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_voyager_core_data_utils_FileHelper_beginPushParse(JNIEnv *env, jobject /* this */,
+                                                           jobject tokenStream, jint fingerprint) {
+    return reinterpret_cast<jlong>(new PushParse(env, tokenStream, toFingerprint(fingerprint)));
+}
 
-        if (bytesRead < 0) {
-            LOGE("Error reading from InputStream");
-            break;
-        }
+// Parses `length` bytes of a direct buffer from `offset`; false once the parse has failed
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_voyager_core_data_utils_FileHelper_feedPushParseDirect(JNIEnv *env, jobject /* this */,
+                                                                jlong handle, jobject buffer,
+                                                                jint offset, jint length) {
+    auto *address = static_cast<const char *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (!address || offset < 0 || length < 0 || offset + static_cast<jlong>(length) > capacity) {
+        LOGE("Invalid direct buffer region for feedPushParseDirect");
+        return JNI_FALSE;
+    }
+    auto *parse = reinterpret_cast<PushParse *>(handle);
+    return parse->feed(env, address + offset, static_cast<size_t>(length)) ? JNI_TRUE : JNI_FALSE;
+}
 
-        if (bytesRead == 0) {
-            done = true;
-            LOGD("Finished reading from InputStream");
-        } else {
-            LOGD("Read %d bytes from InputStream", bytesRead);
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_voyager_core_data_utils_FileHelper_feedPushParseBytes(JNIEnv *env, jobject /* this */,
+                                                               jlong handle, jbyteArray bytes,
+                                                               jint offset, jint length) {
+    if (offset < 0 || length < 0 || offset + static_cast<jlong>(length) > env->GetArrayLength(bytes)) {
+        LOGE("Invalid byte array region for feedPushParseBytes");
+        return JNI_FALSE;
+    }
+    auto *parse = reinterpret_cast<PushParse *>(handle);
+    return parse->feed(env, bytes, offset, length) ? JNI_TRUE : JNI_FALSE;
+}
 
-            // Copy data to native buffer and parse
-            env->GetByteArrayRegion(byteBuffer, 0, bytesRead,
-                                    reinterpret_cast<jbyte *>(nativeBuffer));
+// Completes the document, reports it through the token stream and frees the parse
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_voyager_core_data_utils_FileHelper_finishPushParse(JNIEnv *env, jobject /* this */,
+                                                            jlong handle) {
+    unique_ptr<PushParse> parse(reinterpret_cast<PushParse *>(handle));
+    bool ok = parse->finish(env);
+    parse->release(env);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
 
-            // Update SHA256 hash
-            g_state.sha256.update(reinterpret_cast<uint8_t *>(nativeBuffer), bytesRead);
+extern "C" JNIEXPORT void JNICALL
+Java_com_voyager_core_data_utils_FileHelper_abortPushParse(JNIEnv *env, jobject /* this */,
+                                                           jlong handle) {
+    unique_ptr<PushParse> parse(reinterpret_cast<PushParse *>(handle));
+    parse->release(env);
+}
 
-            if (XML_Parse(parser.get(), nativeBuffer, bytesRead, 0) == XML_STATUS_ERROR) {
-                LOGE("XML Parse error: %s", XML_ErrorString(XML_GetErrorCode(parser.get())));
-                env->DeleteLocalRef(byteBuffer);
-                goto cleanup;
-            }
-        }
+/**
+ * Starts a time-sliced parse of a whole direct buffer (position 0 to capacity) and returns
+ * its handle for the other `*SlicedParse` functions, or 0 if `buffer` is not direct.
+ * Nothing is parsed until the first continueSlicedParse.
+ */
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_voyager_core_data_utils_FileHelper_beginSlicedParse(JNIEnv *env, jobject /* this */,
+                                                             jobject buffer, jint fingerprint) {
+    auto *data = static_cast<const char *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (!data || capacity < 0) {
+        LOGE("beginSlicedParse: not a direct buffer");
+        return 0;
     }
+    auto *parse = new SlicedParse(data, static_cast<size_t>(capacity), toFingerprint(fingerprint));
+    parse->buffer = env->NewGlobalRef(buffer);
+    return reinterpret_cast<jlong>(parse);
+}
 
-    // Finalize parsing
-    if (XML_Parse(parser.get(), nativeBuffer, 0, 1) == XML_STATUS_ERROR) {
-        LOGE("Final XML Parse error: %s", XML_ErrorString(XML_GetErrorCode(parser.get())));
-        env->DeleteLocalRef(byteBuffer);
-        goto cleanup;
-    }
+// Parses for up to `budgetMicros` and returns a SlicedParse::Status
+extern "C" JNIEXPORT jint JNICALL
+Java_com_voyager_core_data_utils_FileHelper_continueSlicedParse(JNIEnv * /* env */,
+                                                                jobject /* this */, jlong handle,
+                                                                jlong budgetMicros) {
+    auto *parse = reinterpret_cast<SlicedParse *>(handle);
+    return parse->advance(static_cast<uint64_t>(max<jlong>(budgetMicros, 0)) * 1000);
+}
 
-    // Finalize SHA256 hash
-    g_state.sha256.final(g_state.hash);
+extern "C" JNIEXPORT void JNICALL
+Java_com_voyager_core_data_utils_FileHelper_cancelSlicedParse(JNIEnv * /* env */,
+                                                              jobject /* this */, jlong handle) {
+    reinterpret_cast<SlicedParse *>(handle)->cancel();
+}
 
-    // Create byte array for hash
-    hashArray = env->NewByteArray(SHA256_DIGEST_LENGTH);
-    if (!hashArray) {
-        LOGE("Failed to create hash byte array");
-        env->DeleteLocalRef(byteBuffer);
-        goto cleanup;
+/**
+ * Frees a sliced parse, returning its flat tree if it finished, or null. The handle is
+ * invalid afterwards.
+ */
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_voyager_core_data_utils_FileHelper_endSlicedParse(JNIEnv *env, jobject /* this */,
+                                                           jlong handle) {
+    unique_ptr<SlicedParse> parse(reinterpret_cast<SlicedParse *>(handle));
+    jbyteArray tree = nullptr;
+    vector<uint8_t> &result = parse->result();
+    if (parse->current() == SlicedParse::FINISHED) {
+        tree = env->NewByteArray(static_cast<jsize>(result.size()));
+        if (tree) {
+            env->SetByteArrayRegion(tree, 0, static_cast<jsize>(result.size()),
+                                    reinterpret_cast<const jbyte *>(result.data()));
+        }
     }
+    env->DeleteGlobalRef(parse->buffer);
+    return tree;
+}
 
-    // Copy hash to Java byte array
-    env->SetByteArrayRegion(hashArray, 0, SHA256_DIGEST_LENGTH,
-                            reinterpret_cast<jbyte *>(g_state.hash));
+/**
+ * Returns the scheduler's per-class latency histograms as one array: for each priority
+ * in order, LatencyHistogram::BUCKETS queue-wait counts followed by as many run-time
+ * counts. Optionally resets them.
+ */
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_voyager_core_data_utils_FileHelper_nativeSchedulerStats(JNIEnv *env, jobject /* this */,
+                                                                 jboolean reset) {
+    constexpr size_t BUCKETS = LatencyHistogram::BUCKETS;
+    ParsePool &pool = ParsePool::shared();
+    jlong values[PRIORITY_COUNT * 2 * BUCKETS];
+    for (size_t priority = 0; priority < PRIORITY_COUNT; priority++) {
+        auto parsePriority = static_cast<ParsePriority>(priority);
+        jlong *wait = values + priority * 2 * BUCKETS;
+        for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+            wait[bucket] = static_cast<jlong>(pool.queueWait(parsePriority).count(bucket));
+            wait[BUCKETS + bucket] = static_cast<jlong>(pool.runTime(parsePriority).count(bucket));
+        }
+    }
+    if (reset) pool.resetHistograms();
+    constexpr jsize count = sizeof(values) / sizeof(values[0]);
+    jlongArray result = env->NewLongArray(count);
+    if (result) env->SetLongArrayRegion(result, 0, count, values);
+    return result;
+}
 
-    // Call onComplete with hash
-    env->CallVoidMethod(tokenStream, g_state.onCompleteMethod, hashArray);
+/**
+ * Returns the accumulated JNI cost, parser pool and memory counters as `[parses, tokens,
+ * jniCalls, tokenNanos, poolHits, poolMisses, expatAllocations, systemAllocations,
+ * peakParseBytes]`, optionally resetting them.
+ */
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_voyager_core_data_utils_FileHelper_nativeParserStats(JNIEnv *env, jobject /* this */,
+                                                              jboolean reset) {
+    jlong values[] = {
+            static_cast<jlong>(g_stats.parses.load(memory_order_relaxed)),
+            static_cast<jlong>(g_stats.tokens.load(memory_order_relaxed)),
+            static_cast<jlong>(g_stats.jniCalls.load(memory_order_relaxed)),
+            static_cast<jlong>(g_stats.tokenNanos.load(memory_order_relaxed)),
+            static_cast<jlong>(g_stats.poolHits.load(memory_order_relaxed)),
+            static_cast<jlong>(g_stats.poolMisses.load(memory_order_relaxed)),
+            static_cast<jlong>(g_stats.expatAllocations.load(memory_order_relaxed)),
+            static_cast<jlong>(g_stats.systemAllocations.load(memory_order_relaxed)),
+            static_cast<jlong>(g_stats.peakParseBytes.load(memory_order_relaxed)),
+    };
+    if (reset) {
+        g_stats.parses = 0;
+        g_stats.tokens = 0;
+        g_stats.jniCalls = 0;
+        g_stats.tokenNanos = 0;
+        g_stats.poolHits = 0;
+        g_stats.poolMisses = 0;
+        g_stats.expatAllocations = 0;
+        g_stats.systemAllocations = 0;
+        g_stats.peakParseBytes = 0;
+    }
+    constexpr jsize count = sizeof(values) / sizeof(values[0]);
+    jlongArray result = env->NewLongArray(count);
+    if (result) env->SetLongArrayRegion(result, 0, count, values);
+    return result;
+}
 
-    // Clean up
-    env->DeleteLocalRef(hashArray);
-    env->DeleteLocalRef(byteBuffer);
+extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void * /* reserved */) {
+    JNIEnv *env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
+    }
+    g_vm = vm;
+    if (!initJniRegistry(env)) {
+        LOGE("JNI registry initialization failed; refusing to load xmlParser");
+        releaseJniRegistry(env);
+        return JNI_ERR;
+    }
+    return JNI_VERSION_1_6;
+}
 
-    cleanup:
-    // Clean up global references
-    if (g_state.tokenStream) {
-        env->DeleteGlobalRef(g_state.tokenStream);
+extern "C" JNIEXPORT void JNICALL JNI_OnUnload(JavaVM *vm, void * /* reserved */) {
+    JNIEnv *env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) == JNI_OK) {
+        g_stringCache.clear(env);
+        releaseJniRegistry(env);
     }
 }
\ No newline at end of file
@@ -3,22 +3,45 @@ package com.voyager.core
 import android.content.Context
 import android.net.Uri
 import android.view.View
+import android.view.ViewGroup
 import com.voyager.core.cache.LayoutCache
+import com.voyager.core.cache.LayoutCacheProbe
+import com.voyager.core.cache.LayoutKey
+import com.voyager.core.data.utils.CacheProbe
+import com.voyager.core.data.utils.ContentFingerprint
 import com.voyager.core.data.utils.FileHelper
 import com.voyager.core.data.utils.FileHelper.getFileExtension
+import com.voyager.core.data.utils.FlatViewTree
+import com.voyager.core.data.utils.LayoutBundle
+import com.voyager.core.data.utils.ParsePriority
+import com.voyager.core.data.utils.ParseScheduler
+import com.voyager.core.data.utils.PushParse
+import com.voyager.core.data.utils.SlicedParse
+import com.voyager.core.data.utils.TokenRing
 import com.voyager.core.data.utils.ViewNodeTokenStream
+import com.voyager.core.data.utils.XmlTokenStream
 import com.voyager.core.exceptions.VoyagerParsingException.XmlParsingException
 import com.voyager.core.exceptions.VoyagerRenderingException.ViewInflationException
 import com.voyager.core.model.ConfigManager
 import com.voyager.core.model.ViewNode
+import com.voyager.core.renderer.RenderTimings
 import com.voyager.core.renderer.XmlRenderer
 import com.voyager.core.utils.ContextUtils.name
 import com.voyager.core.utils.logging.LoggerFactory
 import com.voyager.core.view.processor.BaseViewAttributes
 import com.voyager.core.view.utils.ViewExtensions.getGeneratedViewInfo
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.coroutineScope
+import kotlinx.coroutines.ensureActive
+import kotlinx.coroutines.flow.Flow
+import kotlinx.coroutines.launch
 import kotlinx.coroutines.rx3.rxSingle
 import kotlinx.coroutines.withContext
+import kotlinx.coroutines.yield
+import java.io.File
+import java.io.FileNotFoundException
+import java.nio.ByteBuffer
 
 /**
  * Core class for the Voyager XML runtime engine.
@@ -41,19 +64,47 @@ class Voyager internal constructor(
 
     private val isLoggingEnabled by lazy { ConfigManager.config.isLoggingEnabled }
 
+    /**
+     * Timings of the most recent successful [render] or [renderProgressively], parsing
+     * included, or `null` before the first one.
+     */
+    @Volatile
+    var lastRenderTimings: RenderTimings? = null
+        private set
+
+    /**
+     * Opens the native stat key index on first use, so unchanged local files are matched
+     * against [layoutCache] by their file metadata instead of being read and hashed.
+     */
+    private val statKeyIndexOpened by lazy {
+        val indexFile = File(context.noBackupFilesDir, STAT_KEY_INDEX_PATH)
+        indexFile.parentFile?.mkdirs()
+        FileHelper.openStatKeyIndex(indexFile.path)
+    }
+
+    /**
+     * Opens the native compiled-layout store on first use. Layouts parsed by an earlier
+     * process are then restored from it on a [layoutCache] miss instead of being parsed.
+     */
+    private val layoutStoreOpened by lazy { openLayoutStore(context) }
+
     /**
      * Parses XML content from a given Uri.
      *
      * This function performs the following steps:
      * 1. Validates that the file extension is "xml".
-     * 2. Attempts to retrieve the parsed layout from the `layoutCache` using the file's SHA256 hash as the key.
-     *    If found, it returns the cached result.
-     * 3. If not found in the cache, it opens an `InputStream` for the `xmlFile`.
-     * 4. Parses the XML from the `InputStream` using `FileHelper.parseXML`.
-     * 5. Converts the parsed XML (which is expected to be in a specific JSON format) into a `ViewNode` structure
+     * 2. Opens a file descriptor for the `xmlFile` and hands the mapped file to `FileHelper.parseXMLFd`,
+     *    falling back to an `InputStream` and `FileHelper.parseXMLBatched` when the content is not
+     *    backed by a regular file.
+     * 3. The native parser hashes the content first (128-bit XXH3) and probes the `layoutCache`;
+     *    on a hit the cached layout is returned without tokenizing the XML at all. For an
+     *    unchanged local file the hash comes from the stat key index and the file is not read.
+     *    On a miss, a layout parsed by an earlier process is restored from the on-disk
+     *    compiled-layout store without running the parser.
+     * 4. Converts the parsed XML (which is expected to be in a specific JSON format) into a `ViewNode` structure
      *    using `ViewNodeParser.fromJson`.
-     * 6. Stores the successfully parsed `ViewNode` into the `layoutCache` with its SHA256 hash.
-     * 7. Returns a `Result` object containing the parsed layout (`ViewNode`) on success, or an `Exception` on failure.
+     * 5. Stores the successfully parsed `ViewNode` into the `layoutCache` under its fingerprint.
+     * 6. Returns a `Result` object containing the parsed layout (`ViewNode`) on success, or an `Exception` on failure.
      *
      * This function is executed on an I/O dispatcher provided by `dispatcherProvider`.
      *
@@ -75,26 +126,299 @@ class Voyager internal constructor(
                 )
             ) throw XmlParsingException("Unsupported file type: $extension")
 
-            context.contentResolver.openInputStream(xmlFile)?.use { inputStream ->
-                val tokenStream = ViewNodeTokenStream()
-                FileHelper.parseXML(inputStream, tokenStream)
+            val tokenStream = ViewNodeTokenStream()
+            val probe = LayoutCacheProbe(layoutCache)
+            layoutStoreOpened
+            if (!parseFromFileDescriptor(xmlFile, tokenStream, probe)) {
+                context.contentResolver.openInputStream(xmlFile)?.use { inputStream ->
+                    FileHelper.parseXMLBatched(
+                        inputStream, tokenStream, CACHE_FINGERPRINT.id, probe
+                    )
+                } ?: throw XmlParsingException("Failed to open inputStream for URI: $xmlFile")
+            }
 
-                val parseResult = tokenStream.getResult()
-                if (parseResult == null) throw XmlParsingException("Failed to parse XML from URI: $xmlFile")
+            probe.cached ?: cacheParsedLayout(tokenStream, "URI: $xmlFile")
+        }
+    }
 
-                //check cache using the hash from ParseResult
-                val node = layoutCache.getOrPut(parseResult.sha256Hash.contentHashCode()) {
-                    parseResult.jsonString.apply {
-                        activityName = context.name
-                    }
+    /**
+     * Parses an XML layout that is already in memory, such as a server-driven layout
+     * received from the network layer, without wrapping it in an `InputStream`.
+     *
+     * @param xmlContent The XML bytes between the buffer's position and limit. Direct
+     *                   buffers are parsed in place.
+     * @return A [Result] containing the parsed (or cached) [ViewNode], or the parsing failure.
+     */
+    suspend fun parseXml(xmlContent: ByteBuffer) = withContext(Dispatchers.IO) {
+        Result.runCatching {
+            val tokenStream = ViewNodeTokenStream()
+            val probe = LayoutCacheProbe(layoutCache)
+            layoutStoreOpened
+            FileHelper.parseXMLBuffer(xmlContent, tokenStream, CACHE_FINGERPRINT, probe)
+            probe.cached ?: cacheParsedLayout(tokenStream, "buffer (${xmlContent.remaining()} bytes)")
+        }
+    }
+
+    /**
+     * Parses an XML layout on the native parse pool at the given [priority] instead of on
+     * the calling thread, so it can overtake queued prefetches or yield to the current
+     * screen. Cancelling the calling coroutine cancels the parse if it has not started.
+     *
+     * @param xmlContent The XML bytes between the buffer's position and limit
+     * @param priority Scheduling class of the parse
+     * @return A [Result] containing the parsed (or cached) [ViewNode], or the parsing failure.
+     */
+    suspend fun parseXml(xmlContent: ByteBuffer, priority: ParsePriority) = withContext(Dispatchers.IO) {
+        Result.runCatching {
+            val tree = ParseScheduler.parse(xmlContent, priority, CACHE_FINGERPRINT)
+                ?: throw XmlParsingException("Failed to parse buffer (${xmlContent.remaining()} bytes)")
+            cacheFlatTree(tree) ?: throw XmlParsingException("Layout has no root element")
+        }
+    }
+
+    /**
+     * Parses an XML layout while it is still arriving, e.g. the chunks of an HTTP body,
+     * so parsing overlaps the transfer and the layout is ready right after the last chunk.
+     *
+     * @param xmlChunks The document in order, each chunk between its buffer's position and
+     *                  limit; a buffer may be reused once the next one is requested
+     * @return A [Result] containing the parsed (or cached) [ViewNode], or the parsing failure.
+     */
+    suspend fun parseXml(xmlChunks: Flow<ByteBuffer>) = withContext(Dispatchers.IO) {
+        Result.runCatching {
+            val tokenStream = ViewNodeTokenStream()
+            var bytes = 0L
+            PushParse(tokenStream, CACHE_FINGERPRINT).use { parse ->
+                xmlChunks.collect { chunk ->
+                    bytes += chunk.remaining()
+                    if (!parse.feed(chunk)) throw XmlParsingException("Malformed streamed XML")
                 }
+                if (!parse.finish()) throw XmlParsingException("Malformed streamed XML")
+            }
+            cacheParsedLayout(tokenStream, "stream ($bytes bytes)")
+        }
+    }
 
-                if (isLoggingEnabled) {
-                    LoggerFactory.getLogger().debug("parseXml", "Parsed Xml file for URI: $xmlFile")
+    /**
+     * Parses an XML layout on the calling dispatcher in slices of at most [sliceMicros],
+     * yielding between them. On the main thread this spreads a large layout over several
+     * frames instead of stalling one; cancelling the coroutine abandons the parse between
+     * slices.
+     *
+     * @param xmlContent The XML bytes between the buffer's position and limit
+     * @param sliceMicros Parse budget per slice, in microseconds
+     * @return A [Result] containing the parsed (or cached) [ViewNode], or the parsing failure.
+     */
+    suspend fun parseXmlSliced(
+        xmlContent: ByteBuffer,
+        sliceMicros: Long = DEFAULT_SLICE_MICROS,
+    ) = Result.runCatching {
+        SlicedParse(xmlContent, CACHE_FINGERPRINT).use { parse ->
+            // yield() throws once the coroutine is cancelled, and use {} frees the parse
+            while (parse.advance(sliceMicros) == SlicedParse.Status.SUSPENDED) yield()
+            if (parse.status != SlicedParse.Status.FINISHED) {
+                throw XmlParsingException("Sliced parse ended ${parse.status}")
+            }
+            val tree = parse.finish() ?: throw XmlParsingException("Sliced parse produced no tree")
+            cacheFlatTree(tree) ?: throw XmlParsingException("Layout has no root element")
+        }
+    }
+
+    /**
+     * Parses a large XML layout on the native parse pool while this coroutine builds the
+     * [ViewNode] tree from its tokens as they arrive, so parsing and tree building overlap
+     * on two cores. Tokens are passed through a shared ring buffer rather than JNI calls.
+     *
+     * @param xmlContent A direct buffer holding the whole document (position 0 to capacity)
+     * @return A [Result] containing the parsed [ViewNode], or the parsing failure.
+     */
+    suspend fun parseXmlPipelined(xmlContent: ByteBuffer) = withContext(Dispatchers.IO) {
+        Result.runCatching {
+            val tokenStream = ViewNodeTokenStream()
+            TokenRing(xmlContent, CACHE_FINGERPRINT).use { ring ->
+                val hash = if (ring.drain(tokenStream)) ring.hash else null
+                tokenStream.onComplete(hash ?: throw XmlParsingException("Malformed pipelined XML"))
+            }
+            cacheParsedLayout(tokenStream, "pipelined buffer (${xmlContent.capacity()} bytes)")
+        }
+    }
+
+    /**
+     * Parses an XML layout held in a [ByteArray]. See [parseXml] for [ByteBuffer].
+     */
+    suspend fun parseXml(xmlContent: ByteArray) = parseXml(ByteBuffer.wrap(xmlContent))
+
+    /**
+     * Loads layout [name] from a precompiled [LayoutBundle], reading its tree in place from
+     * the mapped bundle without any XML parsing, and stores it in [layoutCache].
+     *
+     * @return A [Result] containing the (possibly cached) [ViewNode], or a failure if the
+     *         bundle has no such layout
+     */
+    suspend fun loadLayout(bundle: LayoutBundle, name: String) = withContext(Dispatchers.IO) {
+        Result.runCatching {
+            val tree = bundle.tree(name) ?: throw XmlParsingException("No layout $name in the bundle")
+            cacheFlatTree(tree) ?: throw XmlParsingException("Layout $name has no root element")
+        }
+    }
+
+    /**
+     * Loads layout [name] compiled at build time by the Gradle plugin's `precompileLayouts`
+     * task (from `res/raw/name.xml`, say), so no XML is parsed at runtime. The layout is
+     * read from the bundle asset the task writes, or from its own `.vft` asset when the
+     * plugin is set to `bundleLayouts = false`.
+     *
+     * @return A [Result] containing the (possibly cached) [ViewNode], or a failure if the
+     *         app ships no such precompiled layout or its bundle cannot be mapped (e.g. it
+     *         was compressed in the APK)
+     */
+    suspend fun loadPrecompiledLayout(name: String) = withContext(Dispatchers.IO) {
+        Result.runCatching {
+            val tree = precompiledBundle(context)?.tree(name) ?: precompiledTree(name)
+                ?: throw XmlParsingException("No precompiled layout $name")
+            cacheFlatTree(tree) ?: throw XmlParsingException("Layout $name has no root element")
+        }
+    }
+
+    // A layout the plugin wrote to its own asset instead of the bundle
+    private fun precompiledTree(name: String): FlatViewTree? = try {
+        context.assets.open("$PRECOMPILED_LAYOUTS_DIR/$name.vft").use { FlatViewTree(it.readBytes()) }
+    } catch (e: FileNotFoundException) {
+        null
+    }
+
+    /**
+     * Parses a whole set of layouts up front, spread over the native parse pool (one worker
+     * per core), and stores them in [layoutCache]. Later [parseXml] calls for the same
+     * content are then cache hits. Meant for app start, e.g. for server-delivered layouts.
+     *
+     * Runs at [ParsePriority.PREFETCH] by default, so layouts for the screen being shown
+     * are parsed first; [cancelPrefetch] drops whatever is still queued.
+     *
+     * @param xmlContents The XML documents, each between its buffer's position and limit
+     * @param priority Scheduling class of the documents
+     * @return A [Result] with the number of layouts cached; documents that fail to parse
+     *         or are cancelled are skipped
+     */
+    suspend fun preloadXml(
+        xmlContents: List<ByteBuffer>,
+        priority: ParsePriority = ParsePriority.PREFETCH,
+    ) = withContext(Dispatchers.IO) {
+        Result.runCatching {
+            var cached = 0
+            layoutStoreOpened // Preloaded layouts are stored for the next process too
+            FileHelper.parseXMLBatch(xmlContents, CACHE_FINGERPRINT, priority) { _, tree ->
+                if (tree != null && cacheFlatTree(tree) != null) cached++
+            }
+            cached
+        }
+    }
+
+    /**
+     * Like [preloadXml] for [ByteBuffer]s, for layouts behind [Uri]s. Files that can't be
+     * opened as a descriptor are skipped.
+     */
+    @JvmName("preloadXmlFiles")
+    suspend fun preloadXml(
+        xmlFiles: List<Uri>,
+        priority: ParsePriority = ParsePriority.PREFETCH,
+    ) = withContext(Dispatchers.IO) {
+        Result.runCatching {
+            val descriptors = xmlFiles.mapNotNull {
+                try {
+                    context.contentResolver.openAssetFileDescriptor(it, "r")
+                } catch (e: FileNotFoundException) {
+                    null
                 }
+            }
+            try {
+                var cached = 0
+                layoutStoreOpened
+                FileHelper.parseXMLBatchFds(
+                    IntArray(descriptors.size) { descriptors[it].parcelFileDescriptor.fd },
+                    LongArray(descriptors.size) { descriptors[it].startOffset },
+                    LongArray(descriptors.size) { descriptors[it].declaredLength },
+                    CACHE_FINGERPRINT.id,
+                    priority.id,
+                ) { _, tree ->
+                    if (tree != null && cacheFlatTree(tree) != null) cached++
+                }
+                cached
+            } finally {
+                descriptors.forEach { it.close() }
+            }
+        }
+    }
+
+    /**
+     * Drops every preload still waiting on the native parse pool, e.g. after navigating
+     * away from the screen they were for. Their documents are reported as not cached.
+     *
+     * @return The number of documents cancelled
+     */
+    fun cancelPrefetch(): Int = ParseScheduler.cancelQueued(ParsePriority.PREFETCH)
+
+    /**
+     * Stores a tree from the parse pool or a bundle in [layoutCache] under the fingerprint
+     * it carries.
+     * @return The cached layout, or `null` if the tree has no root element
+     */
+    private fun cacheFlatTree(tree: ByteArray): ViewNode? = cacheFlatTree(FlatViewTree(tree))
+
+    private fun cacheFlatTree(flatTree: FlatViewTree): ViewNode? {
+        val node = flatTree.toViewNode() ?: return null
+        return layoutCache.getOrPut(LayoutKey.of(flatTree.hash)) {
+            node.apply { activityName = context.name }
+        }
+    }
+
+    /**
+     * Looks up the parsed layout in [layoutCache] by its content hash, storing it on a miss.
+     *
+     * @param tokenStream The stream that received the parse
+     * @param source Description of the input, used in errors and logs
+     */
+    private fun cacheParsedLayout(tokenStream: ViewNodeTokenStream, source: String): ViewNode {
+        val parseResult = tokenStream.getResult()
+        if (parseResult == null) throw XmlParsingException("Failed to parse XML from $source")
+
+        //check cache using the hash from ParseResult
+        val node = layoutCache.getOrPut(LayoutKey.of(parseResult.hash)) {
+            parseResult.jsonString.apply {
+                activityName = context.name
+            }
+        }
+
+        if (isLoggingEnabled) {
+            LoggerFactory.getLogger().debug("parseXml", "Parsed Xml from $source")
+        }
+
+        return node
+    }
+
+    /**
+     * Parses [xmlFile] through the zero-copy `mmap` path when it resolves to a file descriptor.
+     *
+     * @return `false` if no mappable descriptor is available and the caller should fall back
+     *         to streaming the content
+     */
+    private fun parseFromFileDescriptor(
+        xmlFile: Uri,
+        tokenStream: XmlTokenStream,
+        probe: CacheProbe,
+    ): Boolean {
+        val descriptor = try {
+            context.contentResolver.openAssetFileDescriptor(xmlFile, "r")
+        } catch (e: FileNotFoundException) {
+            null
+        } ?: return false
 
-                node
-            } ?: throw XmlParsingException("Failed to open inputStream for URI: $xmlFile")
+        statKeyIndexOpened // Opens the index before the first mapped parse
+        return descriptor.use {
+            FileHelper.parseXMLFd(
+                it.parcelFileDescriptor.fd, it.startOffset, it.declaredLength, tokenStream,
+                CACHE_FINGERPRINT.id, probe
+            )
         }
     }
 
@@ -134,16 +458,87 @@ class Voyager internal constructor(
         Result.runCatching {
             if (xmlFile == null && node == null) throw ViewInflationException("No XML or ViewNode provided")
 
+            val start = System.nanoTime()
             val parsedLayout = if (xmlFile != null) parseXml(xmlFile).getOrThrow() else node
             if (parsedLayout == null) throw XmlParsingException("Failed to parse XML")
 
             // Render the parsed layout
             val result = renderer.render(parsedLayout)
 
+            // Nothing is shown before the whole tree is inflated
+            val elapsed = System.nanoTime() - start
+            lastRenderTimings = RenderTimings(elapsed, elapsed, subtrees = 0, progressive = false)
             result
         }
     }
 
+    /**
+     * Renders a layout while it is still being parsed, so the top of a long screen shows up
+     * before the rest of the XML is read. The parse runs on the native parse pool and hands
+     * over the root as soon as its start tag is parsed, then each child of the root once
+     * its end tag is. Every such subtree is inflated on the main thread and appended to the
+     * root right away while later ones are still parsing.
+     *
+     * @param xmlContent A direct buffer holding the whole document (position 0 to capacity)
+     * @param onRootView Called on the main thread with the root view before any of its
+     *                   children, e.g. to attach it so children appear as they are inflated
+     * @return A [Result] containing the root view once the whole layout is inflated, or the
+     *         parsing or rendering failure. [lastRenderTimings] then holds its time to first
+     *         view.
+     */
+    suspend fun renderProgressively(
+        xmlContent: ByteBuffer,
+        onRootView: (View) -> Unit = {},
+    ) = Result.runCatching {
+        val start = System.nanoTime()
+        val completed = Channel<ViewNode>(Channel.UNLIMITED)
+        val tokenStream = ViewNodeTokenStream(object : ViewNodeTokenStream.SubtreeListener {
+            override fun onRootStarted(root: ViewNode) {
+                completed.trySend(root)
+            }
+
+            override fun onSubtreeComplete(node: ViewNode) {
+                completed.trySend(node)
+            }
+        })
+        var firstView = 0L
+        var subtrees = 0
+        val rootView = coroutineScope {
+            launch(Dispatchers.IO) {
+                try {
+                    TokenRing(
+                        xmlContent, CACHE_FINGERPRINT, publishDepth = TokenRing.PUBLISH_SUBTREES
+                    ).use { ring ->
+                        // Closing the ring on cancellation stops the parse
+                        while (ring.next(tokenStream)) ensureActive()
+                        val hash = ring.hash ?: throw XmlParsingException("Malformed progressive XML")
+                        tokenStream.onComplete(hash)
+                    }
+                } finally {
+                    completed.close()
+                }
+            }
+            withContext(Dispatchers.Main) {
+                var root: View? = null
+                for (node in completed) {
+                    val parent = root
+                    if (parent == null) {
+                        root = renderer.renderRoot(node).also(onRootView)
+                        firstView = System.nanoTime() - start
+                    } else if (parent is ViewGroup) {
+                        renderer.renderSubtree(parent, node)
+                        if (subtrees++ == 0) firstView = System.nanoTime() - start
+                    }
+                }
+                root
+            }
+        } ?: throw XmlParsingException("Progressive XML has no root element")
+
+        cacheParsedLayout(tokenStream, "progressive buffer (${xmlContent.capacity()} bytes)")
+        lastRenderTimings = RenderTimings(firstView, System.nanoTime() - start, subtrees, progressive = true)
+        rootView
+    }
+
     /**
      * Renders XML content or a pre-parsed [ViewNode] into a view hierarchy with reactive programming support (RxJava).
      *
@@ -170,4 +565,65 @@ class Voyager internal constructor(
     fun setDelegate(view: View?, delegate: Any) {
         view?.getGeneratedViewInfo()?.delegate = delegate
     }
+
+    private companion object {
+        /** Fingerprint used for [layoutCache] keys; they never need cryptographic strength. */
+        val CACHE_FINGERPRINT = ContentFingerprint.XXH3_128
+
+        const val STAT_KEY_INDEX_PATH = "voyager/stat-keys.idx"
+
+        const val LAYOUT_STORE_PATH = "voyager/layouts"
+
+        /** Bound on the compiled-layout store; a flat tree is a few KB per hundred views. */
+        const val LAYOUT_STORE_BYTES = 8L * 1024 * 1024
+
+        /** Default [parseXmlSliced] budget: a quarter of a 60 Hz frame. */
+        const val DEFAULT_SLICE_MICROS = 4_000L
+
+        /** Where the Gradle plugin puts precompiled layouts in the APK's assets. */
+        const val PRECOMPILED_BUNDLE_ASSET = "voyager/layouts.bundle"
+
+        const val PRECOMPILED_LAYOUTS_DIR = "voyager/layouts"
+
+        @Volatile
+        private var layoutStoreOpen = false
+
+        /**
+         * Opens the compiled-layout store once per process, as instances are created per
+         * injection and need not each go to the native side.
+         */
+        fun openLayoutStore(context: Context): Boolean {
+            if (!layoutStoreOpen) synchronized(this) {
+                if (!layoutStoreOpen) {
+                    val directory = File(context.noBackupFilesDir, LAYOUT_STORE_PATH)
+                    directory.mkdirs()
+                    layoutStoreOpen = FileHelper.openLayoutStore(directory.path, LAYOUT_STORE_BYTES)
+                }
+            }
+            return layoutStoreOpen
+        }
+
+        @Volatile
+        private var precompiledBundle: LayoutBundle? = null
+
+        @Volatile
+        private var precompiledBundleChecked = false
+
+        /**
+         * The app's precompiled layout bundle, mapped once per process and kept for its
+         * lifetime; `null` if the app ships none. A bundle that cannot be mapped throws
+         * on every call rather than being taken for a missing one.
+         */
+        fun precompiledBundle(context: Context): LayoutBundle? {
+            if (!precompiledBundleChecked) synchronized(this) {
+                if (!precompiledBundleChecked) {
+                    precompiledBundle = LayoutBundle.openAsset(
+                        context.applicationContext.assets, PRECOMPILED_BUNDLE_ASSET
+                    )
+                    precompiledBundleChecked = true
+                }
+            }
+            return precompiledBundle
+        }
+    }
 }
\ No newline at end of file
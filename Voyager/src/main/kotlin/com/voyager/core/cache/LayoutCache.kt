@@ -22,10 +22,11 @@ import java.util.concurrent.ConcurrentHashMap
  * Example Usage:
  * ```kotlin
  * val cache = LayoutCache(maxSize = 50)
+ * val key = LayoutKey.of(parseResult.hash)
  * // Cache a layout
- * cache.put(xmlContent, viewNode)
+ * cache[key] = viewNode
  * // Retrieve a layout
- * val layout = cache.get(xmlContent)
+ * val layout = cache[key]
  * // Clear cache
  * cache.clear()
  * ```
@@ -39,10 +40,10 @@ internal class LayoutCache(
     private val config = ConfigManager.config
 
     /** LruCache for memory-efficient storage with automatic eviction */
-    private val cache = LruCache<Int, ViewNode>(maxSize)
+    private val cache = LruCache<LayoutKey, ViewNode>(maxSize)
 
     /** Thread-safe permanent storage for all cached layouts */
-    private val cacheMap = ConcurrentHashMap<Int, ViewNode>()
+    private val cacheMap = ConcurrentHashMap<LayoutKey, ViewNode>()
 
     init {
         if (config.isLoggingEnabled) {
@@ -51,25 +52,25 @@ internal class LayoutCache(
     }
 
     /**
-     * Retrieves a cached layout by its XML content.
+     * Retrieves a cached layout by the content fingerprint of its XML.
      * First checks the LruCache for fast access, then falls back to the permanent storage.
      * This operation is thread-safe.
      *
-     * @param xmlContent The XML content used as the cache key
+     * @param key The layout's content fingerprint
      * @return The cached ViewNode or null if not found
      */
-    operator fun get(xmlContent: Int): ViewNode? {
-        val result = cache.get(xmlContent) ?: cacheMap[xmlContent]
+    operator fun get(key: LayoutKey): ViewNode? {
+        val result = cache.get(key) ?: cacheMap[key]
         if (config.isLoggingEnabled) {
             if (result != null) {
                 logger.debug(
                     "get",
-                    "Cache hit for XML content (length: ${xmlContent}, " + "cache size: ${cache.size()}, total size: ${cacheMap.size})"
+                    "Cache hit for layout $key (" + "cache size: ${cache.size()}, total size: ${cacheMap.size})"
                 )
             } else {
                 logger.debug(
                     "get",
-                    "Cache miss for XML content (length: ${xmlContent}, " + "cache size: ${cache.size()}, total size: ${cacheMap.size})"
+                    "Cache miss for layout $key (" + "cache size: ${cache.size()}, total size: ${cacheMap.size})"
                 )
             }
         }
@@ -81,31 +82,31 @@ internal class LayoutCache(
      * If the LruCache is full, it will automatically evict the least recently used item.
      * This operation is thread-safe.
      *
-     * @param xmlContent The XML content used as the cache key
+     * @param key The layout's content fingerprint
      * @param layout The ViewNode to cache
      */
-    operator fun set(xmlContent: Int, layout: ViewNode) {
+    operator fun set(key: LayoutKey, layout: ViewNode) {
         if (config.isLoggingEnabled) {
             logger.debug(
                 "put",
-                "Caching layout for XML content (length: ${xmlContent}, " + "current cache size: ${cache.size()}, total size: ${cacheMap.size})"
+                "Caching layout $key (" + "current cache size: ${cache.size()}, total size: ${cacheMap.size})"
             )
         }
-        cache.put(xmlContent, layout)
-        cacheMap[xmlContent] = layout
+        cache.put(key, layout)
+        cacheMap[key] = layout
     }
 
     /**
      * Retrieves a layout from the cache, or computes and caches it if not present.
      * This operation is thread-safe and leverages the logging within get/put.
      *
-     * @param xmlContent The XML content used as the cache key.
+     * @param key The layout's content fingerprint.
      * @param defaultValue A lambda to compute the ViewNode if it's not in the cache.
      * @return The cached or newly computed ViewNode.
      */
-    inline fun getOrPut(xmlContent: Int, crossinline defaultValue: () -> ViewNode): ViewNode {
+    inline fun getOrPut(key: LayoutKey, crossinline defaultValue: () -> ViewNode): ViewNode {
         // First, check the fast, non-blocking LruCache. This handles frequent, hot access.
-        val cached = this[xmlContent] // Using the operator get
+        val cached = this[key] // Using the operator get
         if (cached != null) {
             // Your existing `get` operator already handles logging, so no extra logging is needed here.
             return cached
@@ -113,7 +114,7 @@ internal class LayoutCache(
 
         // If not in the hot cache, use the atomic, thread-safe operation on the permanent cache.
         // The lambda inside `computeIfAbsent` is guaranteed to execute only once per key across all threads.
-        val result = cacheMap.computeIfAbsent(xmlContent) { key ->
+        val result = cacheMap.computeIfAbsent(key) {
             if (config.isLoggingEnabled) {
                 logger.debug("getOrPut", "Cache Miss. Computing value for key: $key")
             }
@@ -124,7 +125,7 @@ internal class LayoutCache(
         // Now that the value is guaranteed to be in the permanent map,
         // also place it in the LruCache for subsequent fast hits.
         // The `set` operator here will handle logging the "put" operation.
-        this[xmlContent] = result
+        this[key] = result
 
         return result
     }
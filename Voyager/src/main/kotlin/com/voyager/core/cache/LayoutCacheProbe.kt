@@ -0,0 +1,19 @@
+package com.voyager.core.cache
+
+import com.voyager.core.data.utils.CacheProbe
+import com.voyager.core.model.ViewNode
+
+/**
+ * [CacheProbe] backed by a [LayoutCache]: a hit keeps the cached layout in [cached] and
+ * tells the native parser to skip tokenization. Use one instance per parse.
+ */
+internal class LayoutCacheProbe(private val layoutCache: LayoutCache) : CacheProbe {
+    /** The cached layout found for the input, or null on a miss or before the probe ran. */
+    var cached: ViewNode? = null
+        private set
+
+    override fun isCached(hash: ByteArray): Boolean {
+        cached = layoutCache[LayoutKey.of(hash)]
+        return cached != null
+    }
+}
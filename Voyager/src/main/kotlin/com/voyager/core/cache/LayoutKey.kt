@@ -0,0 +1,25 @@
+package com.voyager.core.cache
+
+import java.nio.ByteBuffer
+
+/**
+ * 128-bit [LayoutCache] key derived from a layout's content fingerprint.
+ *
+ * XXH3-128 digests are used whole; longer digests such as SHA256 contribute their first
+ * 128 bits. Unlike folding the digest into an `Int`, this keeps accidental collisions
+ * between distinct layouts out of reach.
+ */
+internal data class LayoutKey(val high: Long, val low: Long) {
+    override fun toString(): String = "%016x%016x".format(high, low)
+
+    companion object {
+        /**
+         * @param hash A content fingerprint of at least 16 bytes
+         */
+        fun of(hash: ByteArray): LayoutKey {
+            require(hash.size >= 16) { "Fingerprint too short for a layout key: ${hash.size} bytes" }
+            val buffer = ByteBuffer.wrap(hash)
+            return LayoutKey(buffer.long, buffer.long)
+        }
+    }
+}
@@ -8,11 +8,14 @@ import java.io.ByteArrayOutputStream
 import java.nio.ByteBuffer
 import java.nio.ByteOrder
 
-//make the layoutCompiler to be in the c++ code integrated with the xml straightly and make the output is Bytecode structure and when backing the results to the kt code make it as stream to avoid the string allocations and these things and make the Bytecode header to contain the activity name and when returning the bytecode result make the code to handle it and be ware of saving the result for the activity reopens
-
 /**
  * Bytecode generator for creating optimized layout instructions.
  *
+ * Layouts available as XML are better compiled natively with [LayoutCompiler.compileXml],
+ * which writes the bytecode during the parse (`bytecodeCompiler.h`): by default version 2,
+ * with a constant pool and a view index, or this format, with an `activity`
+ * [OpCode.OPTIMIZE_HINT] ahead of the first view, when asked for version 1.
+ *
  * This generator creates a custom instruction set for maximum performance:
  * - Compact binary format
  * - Type-safe operations
@@ -183,11 +186,18 @@ enum class OpCode(val value: Int) {
  * Bytecode interpreter for executing compiled layouts.
  * This interpreter provides maximum performance by directly executing
  * bytecode instructions without intermediate parsing.
+ *
+ * Both formats run here: v1 as written by [BytecodeGenerator], and v2 from the native
+ * compiler, whose constant pool is decoded once per bytecode and whose view index lets
+ * [executeSubtree] build a single subtree.
  */
 class BytecodeInterpreter(private val context: Context) {
     private val viewStack = ArrayList<View>()
     private val viewMap = mutableMapOf<String, View>()
 
+    // The v2 program decoded last, reused while the same bytecode runs again
+    private var program: BytecodeProgram? = null
+
     /**
      * Executes the bytecode and returns the resulting view hierarchy.
      */
@@ -196,6 +206,7 @@ class BytecodeInterpreter(private val context: Context) {
 
         // Read header
         val version = buffer.get().toInt()
+        if (version == BytecodeProgram.VERSION) return executeSubtree(bytecode, 0)
         if (version != 1) {
             throw IllegalArgumentException("Unsupported bytecode version: $version")
         }
@@ -210,7 +221,7 @@ class BytecodeInterpreter(private val context: Context) {
 
         // Execute instructions
         while (buffer.hasRemaining()) {
-            val opCode = buffer.get().toInt()
+            val opCode = buffer.get().toInt() and 0xFF
 
             when (opCode) {
                 OpCode.CREATE_VIEW.value -> executeCreateView(buffer)
@@ -228,6 +239,55 @@ class BytecodeInterpreter(private val context: Context) {
         return viewStack.firstOrNull()
     }
 
+    /**
+     * Builds the subtree of one view of v2 [bytecode], e.g. a single list row, without
+     * running the rest of the layout. Views are numbered in document order from the
+     * root, which is 0.
+     *
+     * @return The subtree's root view, not attached to a parent
+     */
+    fun executeSubtree(bytecode: ByteArray, viewIndex: Int): View? {
+        val program = program?.takeIf { it.bytecode === bytecode }
+            ?: BytecodeProgram(bytecode).also { program = it }
+        require(viewIndex in 0 until program.viewCount) { "No view $viewIndex in the bytecode" }
+
+        val last = viewIndex + program.descendants(viewIndex)
+        val buffer = ByteBuffer.wrap(bytecode).order(ByteOrder.LITTLE_ENDIAN)
+        buffer.limit(program.codeStart + program.codeEnd(last))
+        buffer.position(program.codeStart + program.codeOffset(viewIndex))
+
+        viewStack.clear()
+        viewStack.ensureCapacity(last - viewIndex + 1)
+        val constants = program.constants
+        while (buffer.hasRemaining()) {
+            when (val opCode = buffer.get().toInt() and 0xFF) {
+                OpCode.CREATE_VIEW.value -> {
+                    val viewType = constants[readVarint(buffer)] as String
+                    viewStack.add(ViewFactory.createView(context, viewType))
+                }
+
+                OpCode.ADD_CHILD.value -> {
+                    // The subtree's own root names a parent outside the subtree
+                    val parentIndex = readVarint(buffer) - viewIndex
+                    if (parentIndex >= 0) {
+                        (viewStack[parentIndex] as? android.view.ViewGroup)?.addView(viewStack.last())
+                    }
+                }
+
+                OpCode.SET_ID.value -> setViewId(constants[readVarint(buffer)] as String)
+                OpCode.SET_ATTRIBUTE.value -> {
+                    val attributeName = constants[readVarint(buffer)] as String
+                    val attributeValue = constants[readVarint(buffer)]
+                    viewStack.lastOrNull()?.let { applyAttribute(it, attributeName, attributeValue) }
+                }
+
+                else -> throw IllegalArgumentException("Unknown opcode: $opCode")
+            }
+        }
+
+        return viewStack.firstOrNull()
+    }
+
     private fun executeCreateView(buffer: ByteBuffer) {
         val viewType = readString(buffer)
         val view = ViewFactory.createView(context, viewType)
@@ -270,7 +330,10 @@ class BytecodeInterpreter(private val context: Context) {
     }
 
     private fun executeSetId(buffer: ByteBuffer) {
-        val id = readString(buffer)
+        setViewId(readString(buffer))
+    }
+
+    private fun setViewId(id: String) {
         val currentView = viewStack.lastOrNull()
 
         currentView?.let { view ->
@@ -0,0 +1,118 @@
+package com.voyager.core.compiler
+
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * A dimension attribute from the v2 constant pool, e.g. `16dp`. [toString] gives back the
+ * attribute's text exactly.
+ */
+data class BytecodeDimension(val value: Int, val unit: String) {
+    override fun toString() = "$value$unit"
+}
+
+/**
+ * A `#RRGGBB` or `#AARRGGBB` color from the v2 constant pool. [argb] is always opaque for
+ * the six digit form, and [toString] gives back the attribute's text exactly.
+ */
+data class BytecodeColor(val argb: Int, val hasAlpha: Boolean, val lowercase: Boolean) {
+    override fun toString(): String {
+        val text = if (hasAlpha) "#%08X".format(argb) else "#%06X".format(argb and 0xFFFFFF)
+        return if (lowercase) text.lowercase() else text
+    }
+}
+
+/**
+ * A decoded v2 bytecode: the header, the constant pool as Kotlin values ([String], [Int],
+ * [Boolean], [BytecodeDimension] or [BytecodeColor]), and where the view index and the
+ * code are. See `bytecodeCompiler.h` for the layout.
+ */
+internal class BytecodeProgram(val bytecode: ByteArray) {
+    val viewCount: Int
+    val rootType: String
+    val activityName: String
+    val constants: Array<Any>
+    val codeStart: Int
+    private val codeLength: Int
+    private val index: ByteBuffer
+
+    init {
+        val buffer = ByteBuffer.wrap(bytecode).order(ByteOrder.LITTLE_ENDIAN)
+        val version = buffer.get().toInt()
+        require(version == VERSION) { "Unsupported bytecode version: $version" }
+        buffer.int // timestamp
+        viewCount = readVarint(buffer)
+        val rootTypeConstant = readVarint(buffer)
+        val activityConstant = readVarint(buffer)
+
+        constants = Array(readVarint(buffer)) { readConstant(buffer) }
+        rootType = constants[rootTypeConstant] as String
+        activityName = constants[activityConstant] as String
+
+        index = buffer.slice().order(ByteOrder.LITTLE_ENDIAN)
+        buffer.position(buffer.position() + viewCount * 8)
+        codeLength = readVarint(buffer)
+        codeStart = buffer.position()
+    }
+
+    /** Where the code of [view] starts, relative to [codeStart]. */
+    fun codeOffset(view: Int) = index.getInt(view * 8)
+
+    /** How many views follow [view] inside its subtree. */
+    fun descendants(view: Int) = index.getInt(view * 8 + 4)
+
+    /** Where the code of [view] ends, relative to [codeStart]; FINALIZE for the last view. */
+    fun codeEnd(view: Int) = if (view + 1 < viewCount) codeOffset(view + 1) else codeLength - 1
+
+    private fun readConstant(buffer: ByteBuffer): Any = when (val tag = buffer.get().toInt()) {
+        TYPE_STRING -> {
+            val bytes = ByteArray(readVarint(buffer))
+            buffer.get(bytes)
+            String(bytes, Charsets.UTF_8)
+        }
+
+        TYPE_INT -> unzigzag(readVarint(buffer))
+        TYPE_BOOLEAN -> buffer.get().toInt() == 1
+        TYPE_DIMENSION -> {
+            val unit = UNITS[buffer.get().toInt()]
+            BytecodeDimension(unzigzag(readVarint(buffer)), unit)
+        }
+
+        TYPE_COLOR -> {
+            val form = buffer.get().toInt()
+            BytecodeColor(buffer.int, form and COLOR_HAS_ALPHA != 0, form and COLOR_LOWERCASE != 0)
+        }
+
+        else -> throw IllegalArgumentException("Unknown constant type: $tag")
+    }
+
+    companion object {
+        const val VERSION = 2
+
+        private const val TYPE_STRING = 0x01
+        private const val TYPE_INT = 0x02
+        private const val TYPE_BOOLEAN = 0x04
+        private const val TYPE_DIMENSION = 0x05
+        private const val TYPE_COLOR = 0x06
+
+        private const val COLOR_HAS_ALPHA = 0x01
+        private const val COLOR_LOWERCASE = 0x02
+
+        // Same order as BytecodeCompiler::UNITS
+        private val UNITS = arrayOf("px", "dp", "sp", "pt", "in", "mm", "dip")
+
+        private fun unzigzag(value: Int) = (value ushr 1) xor -(value and 1)
+    }
+}
+
+/** Reads an unsigned LEB128 varint, as the v2 format writes its counts and operands. */
+internal fun readVarint(buffer: ByteBuffer): Int {
+    var result = 0
+    var shift = 0
+    while (true) {
+        val byte = buffer.get().toInt()
+        result = result or ((byte and 0x7F) shl shift)
+        if (byte and 0x80 == 0) return result
+        shift += 7
+    }
+}
@@ -1,9 +1,12 @@
 package com.voyager.core.compiler
 
+import com.voyager.core.data.utils.FileHelper
 import com.voyager.core.model.ViewNode
 import com.voyager.core.utils.logging.LoggerFactory
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.withContext
+import java.nio.ByteBuffer
+import java.security.MessageDigest
 import java.util.ArrayDeque
 import java.util.concurrent.ConcurrentHashMap
 
@@ -14,6 +17,7 @@ import java.util.concurrent.ConcurrentHashMap
 class LayoutCompiler {
     private val logger = LoggerFactory.getLogger("LayoutCompiler")
     private val compiledLayouts = ConcurrentHashMap<String, CompiledLayout>()
+    private val compiledBytecode = ConcurrentHashMap<String, ByteArray>()
     private val optimizationRules = OptimizationRuleEngine()
 
     /**
@@ -50,9 +54,43 @@ class LayoutCompiler {
         }
     }
 
+    /**
+     * Compiles layout XML straight to bytecode in the native parser, in a single pass with
+     * no [ViewNode] and no Kotlin traversal. The result is kept per SHA-256 of the XML, so
+     * an activity that is reopened gets the same bytecode without compiling again, while a
+     * changed layout under the same [layoutId] is compiled afresh.
+     *
+     * @param xmlContent The XML bytes between the buffer's position and limit
+     * @param activityName Recorded in the bytecode for the activity the layout belongs to
+     * @param version The bytecode format; see [FileHelper.compileLayout]
+     * @return Bytecode for [BytecodeInterpreter.execute]
+     */
+    suspend fun compileXml(
+        layoutId: String,
+        xmlContent: ByteBuffer,
+        activityName: String,
+        version: Int = 2,
+    ): ByteArray = withContext(Dispatchers.Default) {
+        val key = "${contentKey(xmlContent)}#$activityName#$version"
+        compiledBytecode[key] ?: run {
+            val bytecode = FileHelper.compileLayout(xmlContent, activityName, version)
+                ?: throw LayoutCompilationException("Failed to compile layout $layoutId")
+            compiledBytecode.putIfAbsent(key, bytecode) ?: bytecode.also {
+                logger.info("compileXml", "Compiled layout natively: $layoutId")
+            }
+        }
+    }
+
     companion object {
         const val MAX_RECOMMENDED_DEPTH = 10
         const val MAX_RECOMMENDED_VIEWS = 50
+
+        /** Hex SHA-256 of the bytes between [xml]'s position and limit; [xml] is not moved. */
+        private fun contentKey(xml: ByteBuffer): String =
+            MessageDigest.getInstance("SHA-256").run {
+                update(xml.duplicate())
+                digest().joinToString("") { "%02x".format(it) }
+            }
     }
 }
 
@@ -0,0 +1,17 @@
+package com.voyager.core.data.utils
+
+/**
+ * Receives the results of a batch parse ([FileHelper.parseXMLBatch]).
+ *
+ * Documents are parsed on native worker threads, but [onResult] is always called on the
+ * thread that started the batch, once per document, in the order the documents finish.
+ */
+fun interface BatchParseCallback {
+    /**
+     * @param index Position of the document in the batch input
+     * @param tree The finished tree in the format read by [FlatViewTree], with the content
+     *             fingerprint in its header, or `null` if the document could not be parsed.
+     *             The array belongs to the receiver.
+     */
+    fun onResult(index: Int, tree: ByteArray?)
+}
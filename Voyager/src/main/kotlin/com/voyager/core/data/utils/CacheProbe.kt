@@ -0,0 +1,17 @@
+package com.voyager.core.data.utils
+
+/**
+ * Lets a caller skip parsing a document whose result it already holds.
+ *
+ * When a probe is passed to a batched parse, the native side first hashes the whole input
+ * (in place for mapped files and direct buffers) and calls [isCached] before running
+ * Expat. If it returns `true`, nothing else happens: no tokens, no tree and no
+ * [XmlTokenStream.onComplete].
+ */
+fun interface CacheProbe {
+    /**
+     * @param hash The content fingerprint of the input, as requested for the parse
+     * @return `true` to skip parsing because the result for [hash] is already available
+     */
+    fun isCached(hash: ByteArray): Boolean
+}
@@ -0,0 +1,16 @@
+package com.voyager.core.data.utils
+
+/**
+ * The content fingerprint the native parser computes over the raw XML bytes, in the same
+ * pass as parsing, and reports through [XmlTokenStream.onComplete].
+ *
+ * @property id The value passed to the native parser
+ * @property length Digest length in bytes
+ */
+enum class ContentFingerprint(val id: Int, val length: Int) {
+    /** Cryptographic SHA256, for callers that need a tamper-evident digest. */
+    SHA256(0, 32),
+
+    /** 128-bit XXH3. Much faster, and strong enough for cache keys. */
+    XXH3_128(1, 16),
+}
@@ -57,6 +57,7 @@ import com.voyager.core.utils.logging.LogLevel
 import com.voyager.core.utils.logging.LoggerFactory
 import kotlinx.coroutines.Dispatchers
 import java.io.InputStream
+import java.nio.ByteBuffer
 
 /**
  * `FileHelper` provides utility functions for file operations, focusing on robustly
@@ -114,17 +115,470 @@ internal object FileHelper {
      * - Uses native code for efficient parsing
      * - Avoids intermediate string allocations
      * - Optimized for large XML files
-     * - Calculates SHA256 hash in a single pass
+     * - Calculates the content fingerprint in a single pass
      * - Streams tokens directly to Kotlin layer
      *
      * @param inputStream The [InputStream] containing the XML data to be parsed
      * @param tokenStream The [XmlTokenStream] to receive parsed tokens
+     * @param fingerprint The [ContentFingerprint.id] of the hash reported through
+     *                    [XmlTokenStream.onComplete]
      */
     external fun parseXML(
         @Suppress("UNUSED_PARAMETER") inputStream: InputStream,
         @Suppress("UNUSED_PARAMETER") tokenStream: XmlTokenStream,
+        @Suppress("UNUSED_PARAMETER") fingerprint: Int,
     )
 
+    /**
+     * Batched variant of [parseXML]: the native side encodes tokens into a reused direct
+     * buffer and delivers them through [XmlTokenStream.onTokenBatch] only when the buffer
+     * fills up or the document ends, so a layout costs a handful of JNI transitions
+     * instead of one per token.
+     *
+     * Past its first 32 KB the stream is read ahead on a helper thread, with read sizes
+     * adapting to the stream, so blocking reads overlap the parse. [InputStream.read] may
+     * therefore be called from that thread; an exception it throws is rethrown here.
+     *
+     * @param inputStream The [InputStream] containing the XML data to be parsed
+     * @param tokenStream The [XmlTokenStream] to receive parsed token batches
+     * @param fingerprint The [ContentFingerprint.id] to compute
+     * @param cacheProbe If set, consulted with the fingerprint before any parsing; the
+     *                   stream is then buffered natively so it can be hashed first
+     */
+    external fun parseXMLBatched(
+        @Suppress("UNUSED_PARAMETER") inputStream: InputStream,
+        @Suppress("UNUSED_PARAMETER") tokenStream: XmlTokenStream,
+        @Suppress("UNUSED_PARAMETER") fingerprint: Int,
+        @Suppress("UNUSED_PARAMETER") cacheProbe: CacheProbe?,
+    )
+
+    /**
+     * Zero-copy variant of [parseXMLBatched] for inputs backed by a file descriptor.
+     *
+     * The native side `mmap`s the region and feeds it straight to Expat and the hasher in a
+     * single pass, with no Java heap buffer and no per-chunk JNI upcall. The descriptor is
+     * not closed.
+     *
+     * @param fd A readable file descriptor, e.g. from [android.os.ParcelFileDescriptor.getFd]
+     * @param offset Byte offset of the document within the file
+     * @param length Length of the document in bytes, or a negative value for "to end of file"
+     * @param tokenStream The [XmlTokenStream] to receive parsed token batches
+     * @param fingerprint The [ContentFingerprint.id] to compute
+     * @param cacheProbe If set, consulted with the fingerprint of the mapped region before
+     *                   any parsing (see [CacheProbe])
+     * @return `false` if the descriptor is not a mappable regular file (e.g. a pipe) and
+     *         nothing was parsed; `true` once a parse was attempted
+     */
+    external fun parseXMLFd(
+        @Suppress("UNUSED_PARAMETER") fd: Int,
+        @Suppress("UNUSED_PARAMETER") offset: Long,
+        @Suppress("UNUSED_PARAMETER") length: Long,
+        @Suppress("UNUSED_PARAMETER") tokenStream: XmlTokenStream,
+        @Suppress("UNUSED_PARAMETER") fingerprint: Int,
+        @Suppress("UNUSED_PARAMETER") cacheProbe: CacheProbe?,
+    ): Boolean
+
+    /**
+     * Opens (creating if needed) the persistent index that lets [parseXMLFd] reuse the
+     * fingerprint of a whole local file whose device, inode, size and modification time
+     * are unchanged, skipping the read and the hash entirely on a cache hit.
+     *
+     * Optional: without it every mapped file is hashed. Safe to call again; the last
+     * successfully opened path wins.
+     *
+     * @param path Location of the index file; its directory must exist
+     * @return `false` if the file could not be created or mapped
+     */
+    external fun openStatKeyIndex(@Suppress("UNUSED_PARAMETER") path: String): Boolean
+
+    /**
+     * Opens (creating if needed) the persistent store of parsed layouts, kept as flat trees
+     * keyed by content fingerprint. Every parse that produces a flat tree adds to it, and a
+     * probed parse whose [CacheProbe] misses is answered from it without running the
+     * parser, e.g. on a cold start. Together with [openStatKeyIndex], an unchanged local
+     * file is then neither read, hashed nor parsed.
+     *
+     * Optional and safe to call again: reopening the open directory does nothing, and
+     * opening another one replaces the current store. Restored trees are copied out of the
+     * store, so neither affects them.
+     *
+     * @param directory Where the store keeps its two files; it must exist
+     * @param maxBytes Bound on the store's data file; the least recently used layouts are
+     *                 dropped to stay under it
+     * @return `false` if the files could not be created or mapped
+     */
+    external fun openLayoutStore(
+        @Suppress("UNUSED_PARAMETER") directory: String,
+        @Suppress("UNUSED_PARAMETER") maxBytes: Long,
+    ): Boolean
+
+    /**
+     * Parses a layout that is already in memory, e.g. a server-driven layout handed over by
+     * the network layer, without wrapping it in an [InputStream] or any read callbacks.
+     *
+     * Direct buffers are read in place through their native address; heap buffers go
+     * through [parseXMLBytes]. The buffer's position is not modified.
+     *
+     * @param buffer The XML bytes between the buffer's position and limit
+     * @param tokenStream The [XmlTokenStream] to receive parsed token batches
+     * @param fingerprint The content hash to compute
+     * @param cacheProbe If set, consulted with the fingerprint before any parsing
+     */
+    fun parseXMLBuffer(
+        buffer: ByteBuffer,
+        tokenStream: XmlTokenStream,
+        fingerprint: ContentFingerprint = ContentFingerprint.SHA256,
+        cacheProbe: CacheProbe? = null,
+    ) {
+        when {
+            buffer.isDirect -> parseXMLDirect(
+                buffer, buffer.position(), buffer.remaining(), tokenStream, fingerprint.id,
+                cacheProbe
+            )
+
+            buffer.hasArray() -> parseXMLBytes(
+                buffer.array(), buffer.arrayOffset() + buffer.position(), buffer.remaining(),
+                tokenStream, fingerprint.id, cacheProbe
+            )
+
+            else -> {
+                val bytes = ByteArray(buffer.remaining())
+                buffer.duplicate().get(bytes)
+                parseXMLBytes(bytes, 0, bytes.size, tokenStream, fingerprint.id, cacheProbe)
+            }
+        }
+    }
+
+    /**
+     * External JNI function parsing `bytes[offset, offset + length)`.
+     *
+     * Small arrays are parsed under a single critical-region pin with tokens delivered right
+     * after it is released; large ones are copied out natively in windows.
+     *
+     * @param bytes The array holding the XML document
+     * @param offset Start of the document within [bytes]
+     * @param length Length of the document in bytes
+     * @param tokenStream The [XmlTokenStream] to receive parsed token batches
+     * @param fingerprint The [ContentFingerprint.id] to compute
+     * @param cacheProbe If set, consulted with the fingerprint before any parsing
+     */
+    external fun parseXMLBytes(
+        @Suppress("UNUSED_PARAMETER") bytes: ByteArray,
+        @Suppress("UNUSED_PARAMETER") offset: Int,
+        @Suppress("UNUSED_PARAMETER") length: Int,
+        @Suppress("UNUSED_PARAMETER") tokenStream: XmlTokenStream,
+        @Suppress("UNUSED_PARAMETER") fingerprint: Int,
+        @Suppress("UNUSED_PARAMETER") cacheProbe: CacheProbe?,
+    )
+
+    /**
+     * Compiles an in-memory layout straight to Voyager bytecode in one native parse,
+     * without building a [com.voyager.core.model.ViewNode] or sending tokens to Kotlin.
+     * The result runs on [com.voyager.core.compiler.BytecodeInterpreter] and records
+     * [activityName]. Buffers are handled as in [parseXMLBuffer].
+     *
+     * @param buffer The XML bytes between the buffer's position and limit
+     * @param version The bytecode format: 2, with its constant pool and view index, or 1
+     *                for readers that predate it
+     * @return The bytecode, or `null` if the XML is malformed or has no root element
+     */
+    fun compileLayout(buffer: ByteBuffer, activityName: String, version: Int = 2): ByteArray? = when {
+        buffer.isDirect -> compileLayoutDirect(
+            buffer, buffer.position(), buffer.remaining(), activityName, version
+        )
+
+        buffer.hasArray() -> compileLayoutBytes(
+            buffer.array(), buffer.arrayOffset() + buffer.position(), buffer.remaining(),
+            activityName, version
+        )
+
+        else -> {
+            val bytes = ByteArray(buffer.remaining())
+            buffer.duplicate().get(bytes)
+            compileLayoutBytes(bytes, 0, bytes.size, activityName, version)
+        }
+    }
+
+    /** External JNI function compiling a direct buffer region; see [compileLayout]. */
+    private external fun compileLayoutDirect(
+        @Suppress("UNUSED_PARAMETER") buffer: ByteBuffer,
+        @Suppress("UNUSED_PARAMETER") offset: Int,
+        @Suppress("UNUSED_PARAMETER") length: Int,
+        @Suppress("UNUSED_PARAMETER") activityName: String,
+        @Suppress("UNUSED_PARAMETER") version: Int,
+    ): ByteArray?
+
+    /** External JNI function compiling a byte array region; see [compileLayout]. */
+    private external fun compileLayoutBytes(
+        @Suppress("UNUSED_PARAMETER") bytes: ByteArray,
+        @Suppress("UNUSED_PARAMETER") offset: Int,
+        @Suppress("UNUSED_PARAMETER") length: Int,
+        @Suppress("UNUSED_PARAMETER") activityName: String,
+        @Suppress("UNUSED_PARAMETER") version: Int,
+    ): ByteArray?
+
+    /**
+     * External JNI function parsing `length` bytes at `offset` of a direct [ByteBuffer]
+     * straight from its native address.
+     */
+    private external fun parseXMLDirect(
+        @Suppress("UNUSED_PARAMETER") buffer: ByteBuffer,
+        @Suppress("UNUSED_PARAMETER") offset: Int,
+        @Suppress("UNUSED_PARAMETER") length: Int,
+        @Suppress("UNUSED_PARAMETER") tokenStream: XmlTokenStream,
+        @Suppress("UNUSED_PARAMETER") fingerprint: Int,
+        @Suppress("UNUSED_PARAMETER") cacheProbe: CacheProbe?,
+    )
+
+    /**
+     * Parses many in-memory layouts at once on the native parse pool, one worker per core,
+     * and reports each as a flat tree through [callback] on the calling thread. Meant for
+     * preloading a whole layout set without paying stream and JNI setup per document.
+     *
+     * Blocks until every document is done. Heap buffers are copied to direct ones first.
+     *
+     * @param buffers The documents, each between its buffer's position and limit
+     * @param fingerprint The content hash to put in each tree
+     * @param priority Scheduling class of the documents on the pool
+     * @param callback Receives `(index, tree)` for every document; `tree` is `null` for a
+     *                 document that fails to parse or is cancelled through
+     *                 [cancelQueuedParses]
+     */
+    fun parseXMLBatch(
+        buffers: List<ByteBuffer>,
+        fingerprint: ContentFingerprint = ContentFingerprint.SHA256,
+        priority: ParsePriority = ParsePriority.IMMEDIATE,
+        callback: BatchParseCallback,
+    ) {
+        val direct = Array(buffers.size) { i ->
+            val buffer = buffers[i]
+            if (buffer.isDirect) {
+                buffer.slice()
+            } else {
+                ByteBuffer.allocateDirect(buffer.remaining()).put(buffer.duplicate()).apply { flip() }
+            }
+        }
+        parseXMLBatchDirect(direct, fingerprint.id, priority.id, callback)
+    }
+
+    /**
+     * External JNI function parsing file regions on the native parse pool, like
+     * [parseXMLBatch]. The descriptors must stay open until the call returns.
+     *
+     * @param fds Readable file descriptors of regular files
+     * @param offsets Byte offset of each document within its file
+     * @param lengths Length of each document, or a negative value for "to end of file"
+     * @param fingerprint The [ContentFingerprint.id] to compute
+     * @param priority The [ParsePriority.id] of the documents
+     * @param callback Receives `(index, tree)` for every document; `tree` is `null` for a
+     *                 descriptor that can't be mapped, a document that fails to parse or
+     *                 one that was cancelled
+     */
+    external fun parseXMLBatchFds(
+        @Suppress("UNUSED_PARAMETER") fds: IntArray,
+        @Suppress("UNUSED_PARAMETER") offsets: LongArray,
+        @Suppress("UNUSED_PARAMETER") lengths: LongArray,
+        @Suppress("UNUSED_PARAMETER") fingerprint: Int,
+        @Suppress("UNUSED_PARAMETER") priority: Int,
+        @Suppress("UNUSED_PARAMETER") callback: BatchParseCallback,
+    )
+
+    /**
+     * External JNI function parsing whole direct buffers (position 0 to capacity) on the
+     * native parse pool.
+     */
+    private external fun parseXMLBatchDirect(
+        @Suppress("UNUSED_PARAMETER") buffers: Array<ByteBuffer>,
+        @Suppress("UNUSED_PARAMETER") fingerprint: Int,
+        @Suppress("UNUSED_PARAMETER") priority: Int,
+        @Suppress("UNUSED_PARAMETER") callback: BatchParseCallback,
+    )
+
+    /**
+     * External JNI function queueing a parse of a whole direct buffer (position 0 to
+     * capacity) on the native parse pool. Prefer [ParseScheduler.submit].
+     *
+     * @return The job id, or 0 if [buffer] is not direct
+     */
+    external fun submitParseDirect(
+        @Suppress("UNUSED_PARAMETER") buffer: ByteBuffer,
+        @Suppress("UNUSED_PARAMETER") fingerprint: Int,
+        @Suppress("UNUSED_PARAMETER") priority: Int,
+        @Suppress("UNUSED_PARAMETER") callback: ParseJobCallback,
+    ): Long
+
+    /**
+     * External JNI function queueing a parse of a file region on the native parse pool.
+     * The descriptor is duplicated. Prefer [ParseScheduler.submit].
+     *
+     * @return The job id, or 0 if the descriptor could not be duplicated
+     */
+    external fun submitParseFd(
+        @Suppress("UNUSED_PARAMETER") fd: Int,
+        @Suppress("UNUSED_PARAMETER") offset: Long,
+        @Suppress("UNUSED_PARAMETER") length: Long,
+        @Suppress("UNUSED_PARAMETER") fingerprint: Int,
+        @Suppress("UNUSED_PARAMETER") priority: Int,
+        @Suppress("UNUSED_PARAMETER") callback: ParseJobCallback,
+    ): Long
+
+    /** External JNI function moving a queued job to a more urgent [ParsePriority.id]. */
+    external fun boostParse(
+        @Suppress("UNUSED_PARAMETER") jobId: Long,
+        @Suppress("UNUSED_PARAMETER") priority: Int,
+    ): Boolean
+
+    /**
+     * External JNI function cancelling a job. A queued job never runs and its callback
+     * receives `null`; only that returns `true`. A running one is asked to stop at its
+     * next element but may still deliver its tree.
+     */
+    external fun cancelParse(@Suppress("UNUSED_PARAMETER") jobId: Long): Boolean
+
+    /**
+     * External JNI function cancelling every job, single or batched, still queued at the
+     * [ParsePriority.id]. Returns how many were cancelled.
+     */
+    external fun cancelQueuedParses(@Suppress("UNUSED_PARAMETER") priority: Int): Int
+
+    /**
+     * External JNI function starting a parse fed over several calls. Prefer [PushParse].
+     *
+     * @return A handle for the other `*PushParse` functions
+     */
+    external fun beginPushParse(
+        @Suppress("UNUSED_PARAMETER") tokenStream: XmlTokenStream,
+        @Suppress("UNUSED_PARAMETER") fingerprint: Int,
+    ): Long
+
+    /** External JNI function parsing a direct buffer region; `false` once the parse failed. */
+    external fun feedPushParseDirect(
+        @Suppress("UNUSED_PARAMETER") handle: Long,
+        @Suppress("UNUSED_PARAMETER") buffer: ByteBuffer,
+        @Suppress("UNUSED_PARAMETER") offset: Int,
+        @Suppress("UNUSED_PARAMETER") length: Int,
+    ): Boolean
+
+    /** External JNI function parsing a byte array region; `false` once the parse failed. */
+    external fun feedPushParseBytes(
+        @Suppress("UNUSED_PARAMETER") handle: Long,
+        @Suppress("UNUSED_PARAMETER") bytes: ByteArray,
+        @Suppress("UNUSED_PARAMETER") offset: Int,
+        @Suppress("UNUSED_PARAMETER") length: Int,
+    ): Boolean
+
+    /**
+     * External JNI function ending the document, reporting it through the token stream and
+     * freeing the parse. The handle must not be used afterwards.
+     */
+    external fun finishPushParse(@Suppress("UNUSED_PARAMETER") handle: Long): Boolean
+
+    /** External JNI function freeing an unfinished push parse without reporting it. */
+    external fun abortPushParse(@Suppress("UNUSED_PARAMETER") handle: Long)
+
+    /**
+     * External JNI function starting a time-sliced parse of a whole direct buffer (position
+     * 0 to capacity). Prefer [SlicedParse].
+     *
+     * @return A handle for the other `*SlicedParse` functions, or 0 if [buffer] is not direct
+     */
+    external fun beginSlicedParse(
+        @Suppress("UNUSED_PARAMETER") buffer: ByteBuffer,
+        @Suppress("UNUSED_PARAMETER") fingerprint: Int,
+    ): Long
+
+    /** External JNI function parsing for up to [budgetMicros]; returns a [SlicedParse.Status.id]. */
+    external fun continueSlicedParse(
+        @Suppress("UNUSED_PARAMETER") handle: Long,
+        @Suppress("UNUSED_PARAMETER") budgetMicros: Long,
+    ): Int
+
+    /** External JNI function cancelling a sliced parse from any thread. */
+    external fun cancelSlicedParse(@Suppress("UNUSED_PARAMETER") handle: Long)
+
+    /**
+     * External JNI function freeing a sliced parse; returns its tree if it finished. The
+     * handle must not be used afterwards.
+     */
+    external fun endSlicedParse(@Suppress("UNUSED_PARAMETER") handle: Long): ByteArray?
+
+    /**
+     * External JNI function starting a parse of a whole direct buffer on the parse pool
+     * that writes its tokens into a shared ring. Prefer [TokenRing].
+     *
+     * @return A handle for the other `*TokenRing` functions, or 0 if [buffer] is not direct
+     */
+    external fun openTokenRing(
+        @Suppress("UNUSED_PARAMETER") buffer: ByteBuffer,
+        @Suppress("UNUSED_PARAMETER") fingerprint: Int,
+        @Suppress("UNUSED_PARAMETER") priority: Int,
+        @Suppress("UNUSED_PARAMETER") capacity: Int,
+        @Suppress("UNUSED_PARAMETER") publishDepth: Int,
+    ): Long
+
+    /** External JNI function returning the ring's data area, valid until [closeTokenRing]. */
+    external fun tokenRingBuffer(@Suppress("UNUSED_PARAMETER") handle: Long): ByteBuffer
+
+    /**
+     * External JNI function releasing the ring up to [consumed] and blocking until more
+     * records are published. Returns their end; [consumed] itself once the ring is done.
+     */
+    external fun awaitTokenRing(
+        @Suppress("UNUSED_PARAMETER") handle: Long,
+        @Suppress("UNUSED_PARAMETER") consumed: Long,
+    ): Long
+
+    /**
+     * External JNI function stopping the ring's parse and freeing it. The handle must not
+     * be used afterwards.
+     */
+    external fun closeTokenRing(@Suppress("UNUSED_PARAMETER") handle: Long)
+
+    /**
+     * External JNI function mapping a layout bundle from a descriptor region (a negative
+     * [length] runs to the end of the file). Prefer [LayoutBundle].
+     *
+     * @return A handle for the other `*LayoutBundle*` functions, or 0 if the region does
+     *         not hold a valid bundle
+     */
+    external fun openLayoutBundle(
+        @Suppress("UNUSED_PARAMETER") fd: Int,
+        @Suppress("UNUSED_PARAMETER") offset: Long,
+        @Suppress("UNUSED_PARAMETER") length: Long,
+    ): Long
+
+    /** External JNI function listing the bundle's layout names in sorted order. */
+    external fun layoutBundleNames(@Suppress("UNUSED_PARAMETER") handle: Long): Array<String>
+
+    /**
+     * External JNI function returning the flat tree of layout [name] as a direct buffer
+     * over the mapped bundle, valid until [closeLayoutBundle], or null if there is none.
+     * The mapping is read-only, so the buffer must never be written.
+     */
+    external fun layoutBundleRecord(
+        @Suppress("UNUSED_PARAMETER") handle: Long,
+        @Suppress("UNUSED_PARAMETER") name: String,
+    ): ByteBuffer?
+
+    /** External JNI function unmapping the bundle. The handle must not be used afterwards. */
+    external fun closeLayoutBundle(@Suppress("UNUSED_PARAMETER") handle: Long)
+
+    /**
+     * External JNI function returning the parse pool's latency histograms. Prefer
+     * [ParseSchedulerStats.snapshot].
+     *
+     * @param reset Whether to zero the histograms after reading them
+     */
+    external fun nativeSchedulerStats(@Suppress("UNUSED_PARAMETER") reset: Boolean): LongArray
+
+    /**
+     * External JNI function returning the native parser's accumulated JNI cost, parser pool
+     * and memory counters in [NativeParserStats] field order. Prefer [NativeParserStats.snapshot].
+     *
+     * @param reset Whether to zero the counters after reading them
+     */
+    external fun nativeParserStats(@Suppress("UNUSED_PARAMETER") reset: Boolean): LongArray
+
     /**
      * Asynchronously retrieves the file extension for a given [Uri].
      *
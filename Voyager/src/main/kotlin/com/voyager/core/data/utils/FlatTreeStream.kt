@@ -0,0 +1,17 @@
+package com.voyager.core.data.utils
+
+/**
+ * An [XmlTokenStream] that accepts the whole document as a natively built tree.
+ *
+ * When a batched parse is handed a [FlatTreeStream], the native side builds the view tree
+ * itself and calls [onFlatTree] exactly once instead of streaming tokens; [onToken],
+ * [onTokenBatch] and [onComplete] are not called for that parse. The content fingerprint
+ * of the input travels inside the tree (see [FlatViewTree.hash]).
+ */
+interface FlatTreeStream : XmlTokenStream {
+    /**
+     * Called once with the finished tree, in the format read by [FlatViewTree].
+     * The array belongs to the receiver and may be retained.
+     */
+    fun onFlatTree(tree: ByteArray)
+}
@@ -0,0 +1,141 @@
+package com.voyager.core.data.utils
+
+import androidx.collection.ArrayMap
+import com.voyager.core.model.ViewNode
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Read-only view over the flat tree built by the native parser
+ * (see `FlatTreeSink` in `xmlParser.cpp`).
+ *
+ * Layout (little-endian):
+ * - header `[magic:u32 "VFT1"][version:u16][hashLength:u16][nodeCount:u32][attrCount:u32]
+ *   [childCount:u32][stringCount:u32][poolBytes:u32]`, then the content fingerprint
+ * - nodes `([typeId:u32][attrStart:u32][attrCount:u32][childStart:u32][childCount:u32])*`,
+ *   node 0 being the root
+ * - attributes `([keyId:u32][valueId:u32])*`
+ * - children `[nodeIndex:u32]*`
+ * - strings `([offset:u32][length:u32])*` into the UTF-8 pool that follows
+ *
+ * Nodes can be read lazily by index ([type], [attributes], [children]); strings are
+ * decoded on first use and shared afterwards. [toViewNode] materializes the whole tree.
+ *
+ * The tree can also be read in place from a direct buffer, such as a record mapped from
+ * a [LayoutBundle]; it is then only read, never copied.
+ *
+ * @param tree The tree, from the buffer's position to its limit
+ * @throws IllegalArgumentException if [tree] is not a flat tree this version understands
+ */
+class FlatViewTree(tree: ByteBuffer) {
+    private val input = tree.slice().order(ByteOrder.LITTLE_ENDIAN)
+    private val size = input.remaining()
+
+    constructor(bytes: ByteArray) : this(ByteBuffer.wrap(bytes))
+
+    val nodeCount: Int
+    private val nodesOffset: Int
+    private val attributesOffset: Int
+    private val childrenOffset: Int
+    private val stringsOffset: Int
+    private val poolOffset: Int
+    private val strings: Array<String?>
+
+    /** The content fingerprint of the parsed XML (see [ContentFingerprint]). */
+    val hash: ByteArray
+
+    init {
+        require(size >= HEADER_SIZE && input.getInt(0) == MAGIC) {
+            "Not a flat view tree"
+        }
+        val version = input.getShort(4).toInt()
+        require(version == VERSION) { "Unsupported flat view tree version: $version" }
+
+        nodeCount = input.getInt(8)
+        val attrCount = input.getInt(12)
+        val childCount = input.getInt(16)
+        val stringCount = input.getInt(20)
+        val poolBytes = input.getInt(24)
+        val hashLength = input.getShort(6).toInt() and 0xFFFF
+        require(size >= HEADER_SIZE + hashLength) { "Truncated flat view tree" }
+
+        hash = read(HEADER_SIZE, hashLength)
+        nodesOffset = HEADER_SIZE + hashLength
+        attributesOffset = nodesOffset + NODE_SIZE * nodeCount
+        childrenOffset = attributesOffset + 8 * attrCount
+        stringsOffset = childrenOffset + 4 * childCount
+        poolOffset = stringsOffset + 8 * stringCount
+        require(poolOffset + poolBytes == size) { "Truncated flat view tree" }
+        strings = arrayOfNulls(stringCount)
+    }
+
+    /** Returns the element name of node [index]. */
+    fun type(index: Int): String = string(field(index, 0))
+
+    /** Returns a new map with the attributes of node [index], keyed without namespace prefix. */
+    fun attributes(index: Int): ArrayMap<String, String> {
+        val start = field(index, 1)
+        val count = field(index, 2)
+        val attributes = ArrayMap<String, String>(count)
+        for (i in start until start + count) {
+            val entry = attributesOffset + 8 * i
+            attributes[string(input.getInt(entry))] = string(input.getInt(entry + 4))
+        }
+        return attributes
+    }
+
+    /** Returns the number of children of node [index]. */
+    fun childCount(index: Int): Int = field(index, 4)
+
+    /** Returns the node index of the [position]th child of node [index]. */
+    fun child(index: Int, position: Int): Int =
+        input.getInt(childrenOffset + 4 * (field(index, 3) + position))
+
+    /** Returns the node indices of the children of node [index], in document order. */
+    fun children(index: Int): IntArray = IntArray(childCount(index)) { child(index, it) }
+
+    /**
+     * Materializes node [index] and its whole subtree as [ViewNode]s.
+     * Returns null for the root of an empty tree.
+     */
+    fun toViewNode(index: Int = ROOT): ViewNode? {
+        if (index >= nodeCount) return null
+        val children = ArrayList<ViewNode>(childCount(index))
+        for (position in 0 until childCount(index)) {
+            children += toViewNode(child(index, position))!!
+        }
+        return ViewNode(type = type(index), attributes = attributes(index), children = children)
+    }
+
+    private fun field(index: Int, slot: Int): Int {
+        if (index !in 0 until nodeCount) throw IndexOutOfBoundsException("Node $index of $nodeCount")
+        return input.getInt(nodesOffset + NODE_SIZE * index + 4 * slot)
+    }
+
+    private fun string(id: Int): String = strings[id] ?: run {
+        val entry = stringsOffset + 8 * id
+        val offset = poolOffset + input.getInt(entry)
+        val length = input.getInt(entry + 4)
+        val string = if (input.hasArray()) {
+            String(input.array(), input.arrayOffset() + offset, length, Charsets.UTF_8)
+        } else {
+            String(read(offset, length), Charsets.UTF_8)
+        }
+        string.also { strings[id] = it }
+    }
+
+    private fun read(offset: Int, length: Int): ByteArray {
+        val bytes = ByteArray(length)
+        input.duplicate().apply { position(offset) }.get(bytes)
+        return bytes
+    }
+
+    companion object {
+        const val MAGIC = 0x31544656 // "VFT1"
+        /** Version 2 replaced the `flags` header field of version 1 with `hashLength`. */
+        const val VERSION = 2
+        const val ROOT = 0
+        private const val HEADER_SIZE = 28
+        private const val NODE_SIZE = 20
+    }
+}
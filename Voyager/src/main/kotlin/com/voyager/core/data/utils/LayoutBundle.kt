@@ -0,0 +1,87 @@
+package com.voyager.core.data.utils
+
+import android.content.res.AssetFileDescriptor
+import android.content.res.AssetManager
+import java.io.Closeable
+import java.io.FileNotFoundException
+import java.io.IOException
+import java.nio.ByteOrder
+
+/**
+ * A bundle of precompiled layouts (see `layoutBundle.h`), built ahead of time by the host
+ * `layoutBundleTool` from a directory of XML files. The whole bundle is mapped once;
+ * looking a layout up is a binary search over the mapping, and its tree is read in place,
+ * so loading a layout costs no I/O beyond page faults and never runs the XML parser.
+ *
+ * Trees returned by [tree] read the mapping directly and must not be used after [close];
+ * materialize what is kept with [FlatViewTree.toViewNode].
+ */
+class LayoutBundle private constructor(private var handle: Long) : Closeable {
+
+    /** The layout names, in sorted order. */
+    val names: List<String> by lazy {
+        check(handle != 0L) { "LayoutBundle already closed" }
+        FileHelper.layoutBundleNames(handle).asList()
+    }
+
+    operator fun contains(name: String): Boolean = record(name) != null
+
+    /**
+     * The flat tree of layout [name], read in place, or `null` if there is none. The tree
+     * must not outlive [close], which unmaps the memory it reads.
+     */
+    fun tree(name: String): FlatViewTree? = record(name)?.let { FlatViewTree(it) }
+
+    // Read-only: the mapping is PROT_READ, so a write through the buffer would crash
+    private fun record(name: String) = run {
+        check(handle != 0L) { "LayoutBundle already closed" }
+        FileHelper.layoutBundleRecord(handle, name)?.asReadOnlyBuffer()?.order(ByteOrder.LITTLE_ENDIAN)
+    }
+
+    override fun close() {
+        if (handle == 0L) return
+        FileHelper.closeLayoutBundle(handle)
+        handle = 0L
+    }
+
+    companion object {
+        /**
+         * Maps the bundle behind [descriptor], which may be closed afterwards.
+         * @return `null` if it does not hold a valid bundle
+         */
+        fun open(descriptor: AssetFileDescriptor): LayoutBundle? {
+            val handle = FileHelper.openLayoutBundle(
+                descriptor.parcelFileDescriptor.fd, descriptor.startOffset, descriptor.declaredLength
+            )
+            return if (handle != 0L) LayoutBundle(handle) else null
+        }
+
+        /**
+         * Maps the bundle stored as asset [path]. The asset must be stored uncompressed
+         * (`androidResources { noCompress += "bundle" }`) so it can be mapped from the APK.
+         *
+         * @return `null` if there is no such asset
+         * @throws IOException if the asset is compressed or not a valid bundle
+         */
+        fun openAsset(assets: AssetManager, path: String): LayoutBundle? {
+            val descriptor = try {
+                assets.openFd(path)
+            } catch (e: FileNotFoundException) {
+                // openFd fails the same way for a compressed asset, which open still reads
+                val exists = try {
+                    assets.open(path).close()
+                    true
+                } catch (missing: FileNotFoundException) {
+                    false
+                }
+                if (!exists) return null
+                throw IOException(
+                    "Layout bundle $path is compressed in the APK and cannot be mapped; " +
+                            "add noCompress += \"bundle\" to androidResources", e
+                )
+            }
+            return descriptor.use { open(it) }
+                ?: throw IOException("Asset $path is not a valid layout bundle")
+        }
+    }
+}
@@ -0,0 +1,56 @@
+package com.voyager.core.data.utils
+
+/**
+ * Snapshot of the JNI work done by the native XML parser.
+ *
+ * Used to measure the per-token cost of crossing from Expat's callbacks into Kotlin,
+ * e.g. before and after a transport change.
+ *
+ * @property parses Number of completed `parseXML` calls
+ * @property tokens Number of tokens delivered to Kotlin
+ * @property jniCalls Number of JNI calls (allocations and upcalls) made while parsing
+ * @property tokenNanos Time spent building and delivering tokens, in nanoseconds
+ * @property poolHits Parses that reused a pooled Expat parser via `XML_ParserReset`
+ * @property poolMisses Parses that had to create a new Expat parser
+ * @property expatAllocations Calls Expat made into its memory suite
+ * @property systemAllocations Blocks the parser's arenas had to take from `malloc`; stays flat
+ *           once pooled sessions are warm
+ * @property peakParseBytes Largest arena and Expat heap footprint of a single parse
+ */
+data class NativeParserStats(
+    val parses: Long,
+    val tokens: Long,
+    val jniCalls: Long,
+    val tokenNanos: Long,
+    val poolHits: Long = 0,
+    val poolMisses: Long = 0,
+    val expatAllocations: Long = 0,
+    val systemAllocations: Long = 0,
+    val peakParseBytes: Long = 0,
+) {
+    /** Average JNI calls per token, or 0 when no tokens were emitted. */
+    val jniCallsPerToken: Double
+        get() = if (tokens == 0L) 0.0 else jniCalls.toDouble() / tokens
+
+    /** Average nanoseconds spent per token, or 0 when no tokens were emitted. */
+    val nanosPerToken: Double
+        get() = if (tokens == 0L) 0.0 else tokenNanos.toDouble() / tokens
+
+    /** Fraction of parses served by a pooled parser, or 0 before the first parse. */
+    val poolHitRate: Double
+        get() = if (poolHits + poolMisses == 0L) 0.0 else poolHits.toDouble() / (poolHits + poolMisses)
+
+    companion object {
+        /**
+         * Reads the native counters.
+         * @param reset Whether to zero the counters after reading them
+         */
+        fun snapshot(reset: Boolean = false): NativeParserStats {
+            val values = FileHelper.nativeParserStats(reset)
+            return NativeParserStats(
+                values[0], values[1], values[2], values[3], values[4], values[5], values[6],
+                values[7], values[8]
+            )
+        }
+    }
+}
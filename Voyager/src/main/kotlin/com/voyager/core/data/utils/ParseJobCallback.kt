@@ -0,0 +1,15 @@
+package com.voyager.core.data.utils
+
+/**
+ * Receives the result of a parse submitted to [ParseScheduler].
+ *
+ * Called exactly once, on a native worker thread, or on the thread that cancelled the job.
+ */
+fun interface ParseJobCallback {
+    /**
+     * @param tree The finished tree in the format read by [FlatViewTree], or `null` if the
+     *             document could not be parsed or the job was cancelled. The array belongs
+     *             to the receiver.
+     */
+    fun onFinished(tree: ByteArray?)
+}
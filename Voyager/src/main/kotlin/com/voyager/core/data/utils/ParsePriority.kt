@@ -0,0 +1,18 @@
+package com.voyager.core.data.utils
+
+/**
+ * Scheduling class of a parse on the native parse pool. Workers always drain a more urgent
+ * class before starting anything from a less urgent one.
+ *
+ * @property id The value passed to the native parser
+ */
+enum class ParsePriority(val id: Int) {
+    /** The layout for the screen being shown right now. */
+    IMMEDIATE(0),
+
+    /** The next likely screen, e.g. the target of a visible button. */
+    VISIBLE_SOON(1),
+
+    /** Layouts that may never be shown; first to be cancelled when navigation moves on. */
+    PREFETCH(2),
+}
@@ -3,12 +3,14 @@ package com.voyager.core.data.utils
 import com.voyager.core.model.ViewNode
 
 /**
- * Result class that holds both the parsed JSON string and its SHA256 hash.
+ * Result class that holds both the parsed JSON string and its content fingerprint.
  * Used to return both values from the native XML parser in a single pass.
+ *
+ * @property hash SHA256 or XXH3-128 digest of the XML, see [ContentFingerprint]
  */
 data class ParseResult(
     val jsonString: ViewNode,
-    val sha256Hash: ByteArray
+    val hash: ByteArray
 ) {
     override fun equals(other: Any?): Boolean {
         if (this === other) return true
@@ -17,14 +19,14 @@ data class ParseResult(
         other as ParseResult
 
         if (jsonString != other.jsonString) return false
-        if (!sha256Hash.contentEquals(other.sha256Hash)) return false
+        if (!hash.contentEquals(other.hash)) return false
 
         return true
     }
 
     override fun hashCode(): Int {
         var result = jsonString.hashCode()
-        result = 31 * result + sha256Hash.contentHashCode()
+        result = 31 * result + hash.contentHashCode()
         return result
     }
 } 
\ No newline at end of file
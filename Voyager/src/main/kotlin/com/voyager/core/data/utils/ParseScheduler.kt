@@ -0,0 +1,99 @@
+package com.voyager.core.data.utils
+
+import kotlinx.coroutines.suspendCancellableCoroutine
+import java.nio.ByteBuffer
+import kotlin.coroutines.resume
+
+/**
+ * Submits single parses to the native parse pool without blocking the caller, so a layout
+ * for the current screen can overtake queued prefetches.
+ *
+ * Each submitted job can be boosted to a more urgent [ParsePriority] while it waits, or
+ * cancelled; either way its [ParseJobCallback] hears back exactly once.
+ */
+internal object ParseScheduler {
+
+    /**
+     * A parse waiting on or running in the native pool.
+     * @property id Native job id
+     */
+    class ParseJob internal constructor(val id: Long) {
+        /** Moves the job to a more urgent class. `false` once it has started or finished. */
+        fun boost(priority: ParsePriority): Boolean = FileHelper.boostParse(id, priority.id)
+
+        /**
+         * Cancels the job. A queued one never runs and its callback receives `null`; only
+         * then is the result `true`. A running one is asked to stop at its next element,
+         * but may finish first, so its callback receives `null` or the tree.
+         */
+        fun cancel(): Boolean = FileHelper.cancelParse(id)
+    }
+
+    /**
+     * Queues a parse of [buffer] (position to limit). Heap buffers are copied to a direct
+     * one first; direct buffers must not be modified until [callback] runs.
+     *
+     * @return The job, or `null` if it could not be submitted
+     */
+    fun submit(
+        buffer: ByteBuffer,
+        priority: ParsePriority,
+        fingerprint: ContentFingerprint = ContentFingerprint.SHA256,
+        callback: ParseJobCallback,
+    ): ParseJob? {
+        val direct = if (buffer.isDirect) {
+            buffer.slice()
+        } else {
+            ByteBuffer.allocateDirect(buffer.remaining()).put(buffer.duplicate()).apply { flip() }
+        }
+        val id = FileHelper.submitParseDirect(direct, fingerprint.id, priority.id, callback)
+        return if (id == 0L) null else ParseJob(id)
+    }
+
+    /**
+     * Queues a parse of a file region. The descriptor is duplicated, so the caller may close
+     * it as soon as this returns.
+     *
+     * @param length Length of the document, or a negative value for "to end of file"
+     * @return The job, or `null` if it could not be submitted
+     */
+    fun submit(
+        fd: Int,
+        offset: Long,
+        length: Long,
+        priority: ParsePriority,
+        fingerprint: ContentFingerprint = ContentFingerprint.SHA256,
+        callback: ParseJobCallback,
+    ): ParseJob? {
+        val id = FileHelper.submitParseFd(fd, offset, length, fingerprint.id, priority.id, callback)
+        return if (id == 0L) null else ParseJob(id)
+    }
+
+    /**
+     * Parses [buffer] on the pool and suspends until its tree is ready. Cancelling the
+     * coroutine cancels the job, stopping it mid-document if it already started.
+     *
+     * @return The flat tree, or `null` if the document could not be parsed
+     */
+    suspend fun parse(
+        buffer: ByteBuffer,
+        priority: ParsePriority,
+        fingerprint: ContentFingerprint = ContentFingerprint.SHA256,
+    ): ByteArray? = suspendCancellableCoroutine { continuation ->
+        val job = submit(buffer, priority, fingerprint) { tree ->
+            if (continuation.isActive) continuation.resume(tree)
+        }
+        if (job == null) {
+            continuation.resume(null)
+        } else {
+            continuation.invokeOnCancellation { job.cancel() }
+        }
+    }
+
+    /**
+     * Cancels every job still waiting in [priority], e.g. prefetches for a screen the user
+     * navigated away from.
+     * @return The number of jobs cancelled
+     */
+    fun cancelQueued(priority: ParsePriority): Int = FileHelper.cancelQueuedParses(priority.id)
+}
@@ -0,0 +1,61 @@
+package com.voyager.core.data.utils
+
+import kotlin.math.ceil
+
+/**
+ * Latency histograms of the native parse pool, per [ParsePriority].
+ *
+ * Bucket 0 counts samples under 1 µs, bucket `i` samples in `[2^(i-1), 2^i)` µs, and the
+ * last bucket everything slower.
+ *
+ * @property queueWait Time from submission to a worker starting the job, per priority
+ * @property runTime Time a worker spent on the job, per priority
+ */
+class ParseSchedulerStats(
+    private val queueWait: Array<LongArray>,
+    private val runTime: Array<LongArray>,
+) {
+    /** Queue-wait histogram of [priority]. */
+    fun queueWait(priority: ParsePriority): LongArray = queueWait[priority.id]
+
+    /** Run-time histogram of [priority]. */
+    fun runTime(priority: ParsePriority): LongArray = runTime[priority.id]
+
+    /** Upper bound in µs of the bucket holding the [percentile] (0..100) queue wait. */
+    fun queueWaitPercentile(priority: ParsePriority, percentile: Double): Long =
+        percentile(queueWait[priority.id], percentile)
+
+    /** Upper bound in µs of the bucket holding the [percentile] (0..100) run time. */
+    fun runTimePercentile(priority: ParsePriority, percentile: Double): Long =
+        percentile(runTime[priority.id], percentile)
+
+    companion object {
+        /** Number of buckets per histogram; matches `LatencyHistogram::BUCKETS`. */
+        const val BUCKETS = 24
+
+        /**
+         * Reads the native histograms.
+         * @param reset Whether to zero them after reading
+         */
+        fun snapshot(reset: Boolean = false): ParseSchedulerStats {
+            val values = FileHelper.nativeSchedulerStats(reset)
+            val priorities = ParsePriority.entries.size
+            return ParseSchedulerStats(
+                Array(priorities) { values.copyOfRange(it * 2 * BUCKETS, it * 2 * BUCKETS + BUCKETS) },
+                Array(priorities) { values.copyOfRange(it * 2 * BUCKETS + BUCKETS, (it + 1) * 2 * BUCKETS) },
+            )
+        }
+
+        private fun percentile(histogram: LongArray, percentile: Double): Long {
+            val total = histogram.sum()
+            if (total == 0L) return 0
+            val target = ceil(total * percentile / 100).toLong().coerceAtLeast(1)
+            var seen = 0L
+            for (bucket in histogram.indices) {
+                seen += histogram[bucket]
+                if (seen >= target) return 1L shl bucket
+            }
+            return 1L shl (histogram.size - 1)
+        }
+    }
+}
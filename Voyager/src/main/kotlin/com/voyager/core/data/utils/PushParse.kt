@@ -0,0 +1,69 @@
+package com.voyager.core.data.utils
+
+import java.io.Closeable
+import java.nio.ByteBuffer
+
+/**
+ * A native parse fed chunk by chunk as the document arrives, e.g. from an HTTP body, so
+ * parsing overlaps the transfer instead of waiting for the whole file. Each chunk is
+ * hashed and parsed straight away; tokens reach [tokenStream] as they are parsed, and
+ * [XmlTokenStream.onComplete] (or [FlatTreeStream.onFlatTree]) follows [finish].
+ *
+ * Feeds may come from different threads but must not overlap. [close] abandons a parse
+ * that was not finished.
+ *
+ * @param tokenStream Receives the tokens, or the finished tree if it is a [FlatTreeStream]
+ * @param fingerprint The content hash reported on completion
+ */
+class PushParse(
+    tokenStream: XmlTokenStream,
+    fingerprint: ContentFingerprint = ContentFingerprint.SHA256,
+) : Closeable {
+
+    private var handle = FileHelper.beginPushParse(tokenStream, fingerprint.id)
+
+    /**
+     * Parses the bytes between the buffer's position and limit, and moves the position to
+     * the limit.
+     * @return `false` once the document turned out malformed; later feeds are ignored
+     */
+    fun feed(buffer: ByteBuffer): Boolean {
+        check(handle != 0L) { "PushParse already finished" }
+        val length = buffer.remaining()
+        val ok = when {
+            buffer.isDirect -> FileHelper.feedPushParseDirect(handle, buffer, buffer.position(), length)
+            buffer.hasArray() -> FileHelper.feedPushParseBytes(
+                handle, buffer.array(), buffer.arrayOffset() + buffer.position(), length
+            )
+            else -> ByteArray(length).let {
+                buffer.duplicate().get(it)
+                FileHelper.feedPushParseBytes(handle, it, 0, length)
+            }
+        }
+        buffer.position(buffer.limit())
+        return ok
+    }
+
+    /** Parses [length] bytes of [bytes] from [offset]. See [feed] for [ByteBuffer]. */
+    fun feed(bytes: ByteArray, offset: Int = 0, length: Int = bytes.size - offset): Boolean {
+        check(handle != 0L) { "PushParse already finished" }
+        return FileHelper.feedPushParseBytes(handle, bytes, offset, length)
+    }
+
+    /**
+     * Ends the document and delivers the result to the token stream.
+     * @return `false` if the document was malformed or incomplete
+     */
+    fun finish(): Boolean {
+        check(handle != 0L) { "PushParse already finished" }
+        val ok = FileHelper.finishPushParse(handle)
+        handle = 0L
+        return ok
+    }
+
+    override fun close() {
+        if (handle == 0L) return
+        FileHelper.abortPushParse(handle)
+        handle = 0L
+    }
+}
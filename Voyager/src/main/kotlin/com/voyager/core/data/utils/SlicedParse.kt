@@ -0,0 +1,86 @@
+package com.voyager.core.data.utils
+
+import java.io.Closeable
+import java.nio.ByteBuffer
+
+/**
+ * A native parse that runs in bounded time slices, so a large layout can be parsed on
+ * the main thread a frame budget at a time, or interleaved with other work, without a
+ * thread blocked on it for the whole document.
+ *
+ * Call [advance] until it returns [Status.FINISHED], then take the tree with [finish].
+ * Slices may run on different threads but must not overlap; [cancel] is safe from any
+ * thread, even against [finish], and stops a running slice at the next element.
+ */
+class SlicedParse(
+    buffer: ByteBuffer,
+    fingerprint: ContentFingerprint = ContentFingerprint.SHA256,
+) : Closeable {
+
+    /** Where the parse stands after a slice; [id] matches `SlicedParse::Status` natively. */
+    enum class Status(val id: Int) {
+        /** The budget ran out; call [advance] again. */
+        SUSPENDED(0),
+
+        /** The whole document is parsed and [finish] returns its tree. */
+        FINISHED(1),
+
+        /** The document is malformed or the parser could not be set up. */
+        FAILED(2),
+
+        /** [cancel] was called. */
+        CANCELLED(3),
+    }
+
+    // Keeps the bytes reachable while native code reads them
+    private val direct: ByteBuffer = if (buffer.isDirect) {
+        buffer.slice()
+    } else {
+        ByteBuffer.allocateDirect(buffer.remaining()).put(buffer.duplicate()).apply { flip() }
+    }
+
+    // Guards handle against cancel() racing finish(); slices don't take it, so a cancel
+    // never waits for one
+    private val lock = Any()
+
+    @Volatile
+    private var handle = FileHelper.beginSlicedParse(direct, fingerprint.id)
+
+    /** The latest status; [Status.SUSPENDED] until the first slice says otherwise. */
+    var status = if (handle == 0L) Status.FAILED else Status.SUSPENDED
+        private set
+
+    /**
+     * Parses for about [budgetMicros] microseconds.
+     * @return The new [status]
+     */
+    fun advance(budgetMicros: Long): Status {
+        val current = handle
+        if (status != Status.SUSPENDED || current == 0L) return status
+        val id = FileHelper.continueSlicedParse(current, budgetMicros)
+        status = Status.entries.first { it.id == id }
+        return status
+    }
+
+    /** Stops the parse; the running or next slice returns [Status.CANCELLED]. */
+    fun cancel() {
+        synchronized(lock) {
+            if (handle != 0L) FileHelper.cancelSlicedParse(handle)
+        }
+    }
+
+    /**
+     * Releases the native parse.
+     * @return The flat tree (see [FlatViewTree]) if the parse finished, otherwise `null`
+     */
+    fun finish(): ByteArray? {
+        val ended = synchronized(lock) {
+            handle.also { handle = 0L }
+        }
+        return if (ended != 0L) FileHelper.endSlicedParse(ended) else null
+    }
+
+    override fun close() {
+        finish()
+    }
+}
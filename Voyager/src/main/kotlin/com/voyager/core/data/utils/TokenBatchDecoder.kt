@@ -0,0 +1,89 @@
+package com.voyager.core.data.utils
+
+import androidx.collection.ArrayMap
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Decodes the binary token batches written by the native parser's batched transport
+ * (see `BatchTokenSink` in `xmlParser.cpp`).
+ *
+ * Batch layout (little-endian):
+ * - `START_ELEMENT [nameId:u32][attrCount:u16]([keyId:u32][valueId:u32])*`
+ * - `END_ELEMENT [nameId:u32]`
+ * - `TEXT [textId:u32]`
+ *
+ * Ids index the string table that the native side fills lazily and passes with every
+ * batch; it is shared by all batches of one parse, so each distinct string crosses JNI
+ * once per parse. The decoder itself is stateless.
+ */
+object TokenBatchDecoder {
+    const val OP_START_ELEMENT = 0x02
+    const val OP_END_ELEMENT = 0x03
+    const val OP_TEXT = 0x04
+
+    /**
+     * Receives decoded tokens without allocating intermediate [XmlToken] objects.
+     */
+    interface Handler {
+        fun onStartElement(type: String, attributes: ArrayMap<String, String>)
+        fun onEndElement(type: String)
+        fun onText(text: String)
+    }
+
+    /**
+     * Decodes [count] tokens from the start of [buffer] into [handler].
+     * The buffer is only valid for the duration of the call and is not retained.
+     *
+     * @param strings The session's string table; every id in the batch is populated
+     */
+    fun decode(buffer: ByteBuffer, count: Int, strings: Array<String?>, handler: Handler) {
+        val input = buffer.duplicate().order(ByteOrder.LITTLE_ENDIAN)
+        input.position(0)
+        repeat(count) {
+            when (val op = input.get().toInt()) {
+                OP_START_ELEMENT -> {
+                    val type = strings[input.int]!!
+                    handler.onStartElement(type, readAttributes(input, strings))
+                }
+
+                OP_END_ELEMENT -> handler.onEndElement(strings[input.int]!!)
+                OP_TEXT -> handler.onText(strings[input.int]!!)
+                else -> throw IllegalStateException("Unknown token batch opcode: $op")
+            }
+        }
+    }
+
+    /**
+     * Decodes [count] tokens from [buffer] as [XmlToken] objects, for streams that only
+     * implement [XmlTokenStream.onToken].
+     */
+    fun decode(
+        buffer: ByteBuffer,
+        count: Int,
+        strings: Array<String?>,
+        consumer: (XmlToken) -> Unit,
+    ) {
+        decode(buffer, count, strings, object : Handler {
+            override fun onStartElement(type: String, attributes: ArrayMap<String, String>) =
+                consumer(XmlToken.StartElement(type, attributes))
+
+            override fun onEndElement(type: String) = consumer(XmlToken.EndElement(type))
+
+            override fun onText(text: String) = consumer(XmlToken.Text(text))
+        })
+    }
+
+    private fun readAttributes(
+        input: ByteBuffer,
+        strings: Array<String?>,
+    ): ArrayMap<String, String> {
+        val attrCount = input.short.toInt() and 0xFFFF
+        val attributes = ArrayMap<String, String>(attrCount)
+        repeat(attrCount) {
+            val key = strings[input.int]!!
+            attributes[key] = strings[input.int]!!
+        }
+        return attributes
+    }
+}
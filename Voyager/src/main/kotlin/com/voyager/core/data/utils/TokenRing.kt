@@ -0,0 +1,194 @@
+package com.voyager.core.data.utils
+
+import androidx.collection.ArrayMap
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.flow.Flow
+import kotlinx.coroutines.flow.flow
+import kotlinx.coroutines.flow.flowOn
+import java.io.Closeable
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * A native parse running on the parse pool that streams its tokens through a ring buffer
+ * shared with this consumer (see `tokenRing.h`). Parsing and tree building run on
+ * different threads, and tokens cross without per-token JNI. The only native call is
+ * made once everything published so far has been decoded, and it blocks until more
+ * arrives. When the ring is full the parser sleeps until the consumer catches up.
+ *
+ * Reads block, so consume from a background thread, or collect [tokens]. [close] stops a
+ * parse that is still running.
+ *
+ * @param document A direct buffer; the whole buffer (position 0 to capacity) is parsed.
+ *                 It must stay unchanged until the ring is closed.
+ * @param fingerprint The content hash reported on completion
+ * @param priority Scheduling class of the parse on the pool
+ * @param capacity Ring size in bytes, rounded up to a power of two
+ * @param publishDepth The parser wakes the consumer after a record that leaves at most
+ *                     this many elements open: [PUBLISH_SUBTREES] hands over the root's
+ *                     start tag and then each child of the root once it is complete,
+ *                     and [PUBLISH_EVERY_TOKEN] hands over each token as it is parsed
+ */
+class TokenRing(
+    document: ByteBuffer,
+    fingerprint: ContentFingerprint = ContentFingerprint.SHA256,
+    priority: ParsePriority = ParsePriority.IMMEDIATE,
+    capacity: Int = DEFAULT_CAPACITY,
+    publishDepth: Int = PUBLISH_EVERY_TOKEN,
+) : Closeable {
+
+    private var handle =
+        FileHelper.openTokenRing(document, fingerprint.id, priority.id, capacity, publishDepth)
+
+    init {
+        require(handle != 0L) { "TokenRing needs a direct buffer" }
+    }
+
+    private val data = FileHelper.tokenRingBuffer(handle).order(ByteOrder.LITTLE_ENDIAN)
+    private val mask = data.capacity() - 1L
+    private val strings = ArrayList<String>()
+    private var position = 0L
+    private var end = 0L
+
+    /** The document's content hash, once [drain] (or [tokens]) has seen the whole parse. */
+    var hash: ByteArray? = null
+        private set
+
+    /** Whether the parse ended without completing: malformed, cancelled or out of room. */
+    var failed = false
+        private set
+
+    /**
+     * Decodes every token into [handler] as soon as it is parsed, until the parse ends.
+     * @return `true` if the document parsed completely; [hash] is then set
+     */
+    fun drain(handler: TokenBatchDecoder.Handler): Boolean {
+        while (next(handler)) {
+            // Each call decodes one token
+        }
+        return hash != null
+    }
+
+    /**
+     * Decodes the next token into [handler], waiting for the parser if necessary.
+     * @return `false` once the parse has ended; check [hash] or [failed]
+     */
+    fun next(handler: TokenBatchDecoder.Handler): Boolean {
+        check(handle != 0L) { "TokenRing already closed" }
+        while (true) {
+            if (position == end) {
+                if (hash != null || failed) return false
+                end = FileHelper.awaitTokenRing(handle, position)
+                if (end == position) {
+                    // Closed without a final record: the parse never started
+                    failed = true
+                    return false
+                }
+            }
+            val offset = (position and mask).toInt()
+            data.position(offset)
+            when (val op = data.get().toInt()) {
+                OP_PAD -> {
+                    position = (position or mask) + 1
+                    continue
+                }
+
+                OP_STRING -> {
+                    data.int // the id, always the next one
+                    val bytes = ByteArray(data.int)
+                    data.get(bytes)
+                    strings.add(String(bytes, Charsets.UTF_8))
+                    position += data.position() - offset
+                    continue
+                }
+
+                TokenBatchDecoder.OP_START_ELEMENT -> {
+                    val type = strings[data.int]
+                    val attrCount = data.short.toInt() and 0xFFFF
+                    val attributes = ArrayMap<String, String>(attrCount)
+                    repeat(attrCount) {
+                        val key = strings[data.int]
+                        attributes[key] = strings[data.int]
+                    }
+                    position += data.position() - offset
+                    handler.onStartElement(type, attributes)
+                    return true
+                }
+
+                TokenBatchDecoder.OP_END_ELEMENT -> {
+                    position += 5
+                    handler.onEndElement(strings[data.int])
+                    return true
+                }
+
+                TokenBatchDecoder.OP_TEXT -> {
+                    position += 5
+                    handler.onText(strings[data.int])
+                    return true
+                }
+
+                OP_COMPLETE -> {
+                    val digest = ByteArray(data.get().toInt() and 0xFF)
+                    data.get(digest)
+                    position += data.position() - offset
+                    hash = digest
+                }
+
+                OP_FAILED -> {
+                    position += 1
+                    failed = true
+                }
+
+                else -> throw IllegalStateException("Unknown token ring opcode: $op")
+            }
+        }
+    }
+
+    /**
+     * The parse as a cold [Flow] of [XmlToken]s, decoded on [Dispatchers.IO]. It ends with
+     * [XmlToken.EndDocument] if the document parsed completely, and the ring is closed
+     * when collection ends. Collect it once.
+     */
+    fun tokens(): Flow<XmlToken> = flow {
+        use {
+            var token: XmlToken? = null
+            val handler = object : TokenBatchDecoder.Handler {
+                override fun onStartElement(type: String, attributes: ArrayMap<String, String>) {
+                    token = XmlToken.StartElement(type, attributes)
+                }
+
+                override fun onEndElement(type: String) {
+                    token = XmlToken.EndElement(type)
+                }
+
+                override fun onText(text: String) {
+                    token = XmlToken.Text(text)
+                }
+            }
+            while (next(handler)) emit(token!!)
+            if (hash != null) emit(XmlToken.EndDocument)
+        }
+    }.flowOn(Dispatchers.IO)
+
+    override fun close() {
+        if (handle == 0L) return
+        FileHelper.closeTokenRing(handle)
+        handle = 0L
+    }
+
+    companion object {
+        /** Room for a few thousand tokens; a full ring only pauses the parser. */
+        const val DEFAULT_CAPACITY = 64 * 1024
+
+        /** See `publishDepth`: whole subtrees of the root, for progressive rendering. */
+        const val PUBLISH_SUBTREES = 1
+
+        /** See `publishDepth`: every token as soon as it is parsed. */
+        const val PUBLISH_EVERY_TOKEN = -1
+
+        private const val OP_PAD = 0x00
+        private const val OP_STRING = 0x01
+        private const val OP_COMPLETE = 0x05
+        private const val OP_FAILED = 0x06
+    }
+}
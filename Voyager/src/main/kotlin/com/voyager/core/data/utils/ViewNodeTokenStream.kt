@@ -1,42 +1,46 @@
 package com.voyager.core.data.utils
 
+import androidx.collection.ArrayMap
 import com.voyager.core.model.ViewNode
+import java.nio.ByteBuffer
 import java.util.Stack
 
 /**
  * Implementation of [XmlTokenStream] that builds a [ViewNode] hierarchy
  * from the streamed XML tokens.
+ *
+ * Batched parses hand it a natively built [FlatViewTree] instead, so the tree arrives in
+ * a single call; per-token delivery is still supported for the object transport.
+ *
+ * @param subtreeListener Told about the root as soon as its start tag is parsed and about
+ *                        each child of the root once its end tag is, for progressive
+ *                        rendering. Only token delivery reports subtrees, not [onFlatTree].
  */
-class ViewNodeTokenStream : XmlTokenStream {
+class ViewNodeTokenStream(
+    private val subtreeListener: SubtreeListener? = null,
+) : FlatTreeStream, TokenBatchDecoder.Handler {
+
+    /**
+     * Receives parts of the tree as soon as they are complete, on the thread delivering
+     * tokens. The root's children list keeps growing after [onRootStarted]; read only its
+     * type and attributes there.
+     */
+    interface SubtreeListener {
+        fun onRootStarted(root: ViewNode)
+        fun onSubtreeComplete(node: ViewNode)
+    }
+
     private val nodeStack = Stack<ViewNode>()
     private var rootNode: ViewNode? = null
-    private var sha256Hash: ByteArray? = null
+    private var hash: ByteArray? = null
 
     override fun onToken(token: XmlToken) {
         when (token) {
-            is XmlToken.StartElement -> {
-                val node = ViewNode(
-                    type = token.type, attributes = token.attributes, children = mutableListOf()
-                )
-
-                if (nodeStack.isEmpty()) {
-                    rootNode = node
-                } else {
-                    nodeStack.peek().children.add(node)
-                }
-
-                nodeStack.push(node)
-            }
+            is XmlToken.StartElement -> onStartElement(token.type, token.attributes)
 
-            is XmlToken.EndElement -> {
-                if (nodeStack.isNotEmpty()) {
-                    nodeStack.pop()
-                }
-            }
+            is XmlToken.EndElement -> onEndElement(token.type)
 
-            is XmlToken.Text -> {
-                // Handle text content if needed
-            }
+            is XmlToken.Text -> onText(token.text)
 
             XmlToken.EndDocument -> {
                 // Document parsing complete
@@ -44,17 +48,53 @@ class ViewNodeTokenStream : XmlTokenStream {
         }
     }
 
-    override fun onComplete(sha256Hash: ByteArray) {
-        this.sha256Hash = sha256Hash
+    override fun onTokenBatch(buffer: ByteBuffer, count: Int, strings: Array<String?>) {
+        TokenBatchDecoder.decode(buffer, count, strings, this)
+    }
+
+    override fun onStartElement(type: String, attributes: ArrayMap<String, String>) {
+        val node = ViewNode(
+            type = type, attributes = attributes, children = mutableListOf()
+        )
+
+        if (nodeStack.isEmpty()) {
+            rootNode = node
+            subtreeListener?.onRootStarted(node)
+        } else {
+            nodeStack.peek().children.add(node)
+        }
+
+        nodeStack.push(node)
+    }
+
+    override fun onEndElement(type: String) {
+        if (nodeStack.isNotEmpty()) {
+            val node = nodeStack.pop()
+            if (nodeStack.size == 1) subtreeListener?.onSubtreeComplete(node)
+        }
+    }
+
+    override fun onText(text: String) {
+        // Handle text content if needed
+    }
+
+    override fun onComplete(hash: ByteArray) {
+        this.hash = hash
+    }
+
+    override fun onFlatTree(tree: ByteArray) {
+        val flatTree = FlatViewTree(tree)
+        rootNode = flatTree.toViewNode()
+        hash = flatTree.hash
     }
 
     /**
-     * Get the parsed ViewNode and its SHA256 hash.
+     * Get the parsed ViewNode and its content fingerprint.
      * @return A [ParseResult] containing the parsed ViewNode and its hash
      */
     fun getResult(): ParseResult? {
         val node = rootNode ?: return null
-        val hash = sha256Hash ?: return null
+        val hash = this.hash ?: return null
         return ParseResult(node, hash)
     }
-} 
\ No newline at end of file
+}
@@ -1,5 +1,7 @@
 package com.voyager.core.data.utils
 
+import java.nio.ByteBuffer
+
 /**
  * Interface for streaming XML tokens from native code.
  * This allows efficient parsing of XML without building a complete JSON string.
@@ -11,9 +13,26 @@ interface XmlTokenStream {
      */
     fun onToken(token: XmlToken)
 
+    /**
+     * Called by the batched transport with [count] binary-encoded tokens, in the format
+     * read by [TokenBatchDecoder]. The buffer is reused by the native side and must not
+     * be retained after this call returns.
+     *
+     * The default implementation decodes each token and forwards it to [onToken].
+     *
+     * @param buffer Direct buffer holding the encoded tokens, starting at position 0
+     * @param count Number of tokens in the batch
+     * @param strings The parse's interned strings, indexed by the ids in [buffer]. The same
+     *                table (possibly grown) is passed with every batch of a parse.
+     */
+    fun onTokenBatch(buffer: ByteBuffer, count: Int, strings: Array<String?>) {
+        TokenBatchDecoder.decode(buffer, count, strings) { token -> onToken(token) }
+    }
+
     /**
      * Called when parsing is complete.
-     * @param sha256Hash The SHA256 hash of the parsed XML
+     * @param hash The content fingerprint of the parsed XML: 32 bytes of SHA256 or 16 bytes
+     *             of XXH3-128, as requested by the caller (see [ContentFingerprint])
      */
-    fun onComplete(sha256Hash: ByteArray)
-} 
\ No newline at end of file
+    fun onComplete(hash: ByteArray)
+}
@@ -0,0 +1,21 @@
+package com.voyager.core.renderer
+
+/**
+ * How long a layout took to appear, measured from the start of the render call, parsing
+ * included. Compare [timeToFirstViewNanos] across modes to see what progressive rendering
+ * gains: a full render shows nothing until the whole tree is inflated, while a progressive
+ * one shows the first child of the root as soon as that subtree has been parsed.
+ *
+ * @property timeToFirstViewNanos Until the first content view (the first child of the
+ *                                root, or the root itself if it has none) was inflated
+ * @property totalNanos Until the whole layout was inflated
+ * @property subtrees Children of the root inflated on their own as they were parsed; 0 for
+ *                    a full render
+ * @property progressive Whether the layout was rendered while it was still being parsed
+ */
+data class RenderTimings(
+    val timeToFirstViewNanos: Long,
+    val totalNanos: Long,
+    val subtrees: Int,
+    val progressive: Boolean,
+)
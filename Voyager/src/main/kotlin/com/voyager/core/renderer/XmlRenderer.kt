@@ -64,17 +64,49 @@ internal class XmlRenderer(
         }
     }
 
+    /**
+     * Renders only the root of a layout whose children are still being parsed, for
+     * progressive rendering. Runs on the calling thread; its children follow through
+     * [renderSubtree].
+     *
+     * @param root The root ViewNode; its children are ignored
+     * @return The root view
+     * @throws VoyagerRenderingException.ViewInflationException if view creation fails
+     * @throws VoyagerRenderingException.MissingAttributeException if required attributes are missing
+     */
+    fun renderRoot(root: ViewNode): View {
+        logger.debug("renderRoot", "Rendering root ${root.type} ahead of its children")
+        return renderNode(node = root, withChildren = false)
+    }
+
+    /**
+     * Renders a complete subtree and appends it to [parent]. Runs on the calling thread,
+     * which must own [parent] once it is attached to a window.
+     *
+     * @param parent The view rendered by [renderRoot]
+     * @param node The completed child of the root
+     * @return The subtree's view
+     * @throws VoyagerRenderingException.ViewInflationException if view creation fails
+     * @throws VoyagerRenderingException.MissingAttributeException if required attributes are missing
+     */
+    fun renderSubtree(parent: ViewGroup, node: ViewNode): View = renderNode(parent, node)
+
     /**
      * Renders a single node and its children.
      * Handles view creation, attribute processing, and child rendering.
      *
      * @param parent The parent ViewGroup, or null for root node
      * @param node The ViewNode to render
+     * @param withChildren Whether to render the node's children as well
      * @return The rendered view
      * @throws VoyagerRenderingException.ViewInflationException if view creation fails
      * @throws VoyagerRenderingException.MissingAttributeException if required attributes are missing
      */
-    private fun renderNode(parent: ViewGroup? = null, node: ViewNode): View {
+    private fun renderNode(
+        parent: ViewGroup? = null,
+        node: ViewNode,
+        withChildren: Boolean = true,
+    ): View {
         try {
             val contextThemeWrapper = ContextThemeWrapper(context, theme)
             logger.debug("renderNode", "Creating view of type: ${node.type}")
@@ -96,7 +128,7 @@ internal class XmlRenderer(
             }
 
             // Handle children if it's a ViewGroup
-            if (view is ViewGroup && node.children.isNotEmpty()) {
+            if (withChildren && view is ViewGroup && node.children.isNotEmpty()) {
                 renderChildren(view, node.children)
             }
 
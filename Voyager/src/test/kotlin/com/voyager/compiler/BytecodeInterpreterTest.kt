@@ -0,0 +1,116 @@
+package com.voyager.compiler
+
+import android.content.Context
+import android.view.View
+import android.view.ViewGroup
+import android.widget.TextView
+import com.voyager.core.compiler.BytecodeInterpreter
+import com.voyager.core.view.ViewFactory
+import io.mockk.every
+import io.mockk.mockk
+import io.mockk.mockkObject
+import io.mockk.unmockkObject
+import io.mockk.verify
+import org.junit.jupiter.api.AfterEach
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.BeforeEach
+import org.junit.jupiter.api.DisplayName
+import org.junit.jupiter.api.Test
+
+@DisplayName("BytecodeInterpreter Native Compiler Output Tests")
+class BytecodeInterpreterTest {
+
+    private lateinit var context: Context
+    private val created = mutableListOf<Pair<String, View>>()
+
+    @BeforeEach
+    fun setUp() {
+        context = mockk(relaxed = true)
+        every { context.packageName } returns PACKAGE
+        every { context.resources.getIdentifier("root", "id", PACKAGE) } returns ROOT_ID
+        every { context.resources.getIdentifier("label", "id", PACKAGE) } returns LABEL_ID
+
+        created.clear()
+        mockkObject(ViewFactory)
+        every { ViewFactory.createView(any(), any()) } answers {
+            val type = secondArg<String>()
+            val view: View = if (type.endsWith("Layout")) mockk<ViewGroup>(relaxed = true)
+            else mockk<TextView>(relaxed = true)
+            created += type to view
+            view
+        }
+    }
+
+    @AfterEach
+    fun tearDown() {
+        unmockkObject(ViewFactory)
+    }
+
+    private fun view(index: Int) = created[index].second
+
+    private fun assertFixtureTree(root: View?) {
+        assertEquals(listOf("LinearLayout", "TextView", "FrameLayout", "TextView"), created.map { it.first })
+        assertSame(view(0), root)
+        val layout = view(0) as ViewGroup
+        val frame = view(2) as ViewGroup
+        verify(exactly = 1) { layout.addView(view(1)) }
+        verify(exactly = 1) { layout.addView(view(2)) }
+        verify(exactly = 1) { frame.addView(view(3)) }
+        verify { view(0).id = ROOT_ID }
+        verify { view(3).id = LABEL_ID }
+    }
+
+    @Test
+    @DisplayName("v1 output runs to FINALIZE and builds the tree")
+    fun `v1 output builds the tree`() {
+        // FINALIZE is 0xF0, so the opcode must be read unsigned for the run to end on it
+        assertFixtureTree(BytecodeInterpreter(context).execute(hex(FIXTURE_V1)))
+    }
+
+    @Test
+    @DisplayName("v2 output builds the same tree")
+    fun `v2 output builds the tree`() {
+        assertFixtureTree(BytecodeInterpreter(context).execute(hex(FIXTURE_V2)))
+    }
+
+    @Test
+    @DisplayName("Unknown versions are rejected")
+    fun `unknown version is rejected`() {
+        val bytecode = hex(FIXTURE_V2).also { it[0] = 3 }
+        assertThrows(IllegalArgumentException::class.java) {
+            BytecodeInterpreter(context).execute(bytecode)
+        }
+    }
+
+    companion object {
+        private const val PACKAGE = "com.example"
+        private const val ROOT_ID = 0x7f010001
+        private const val LABEL_ID = 0x7f010002
+
+        // `bytecodeCompilerTest --fixture`: its FIXTURE layout, compiled by the native
+        // compiler for com.example.MainActivity with timestamp 1234
+        const val FIXTURE_V1 =
+            "01d20400000c0000004c696e6561724c61796f757404000000600800000061637469766974791800" +
+            "0000636f6d2e6578616d706c652e4d61696e4163746976697479100c0000004c696e6561724c6179" +
+            "6f75745004000000726f6f74200200000069640109000000402b69642f726f6f74200b0000006f72" +
+            "69656e746174696f6e0108000000766572746963616c100800000054657874566965774000000000" +
+            "01000000200400000074657874010300000030303720080000007465787453697a65010400000031" +
+            "367370100b0000004672616d654c61796f75744000000000020000002005000000616c7068610103" +
+            "000000302e351008000000546578745669657740020000000300000050050000006c6162656c2002" +
+            "0000006964010a000000402b69642f6c6162656c200900000074657874436f6c6f72010900000023" +
+            "666633333636393920080000006d61784c696e6573010100000031f0ff"
+
+        const val FIXTURE_V2 =
+            "02d2040000040100150118636f6d2e6578616d706c652e4d61696e4163746976697479010c4c696e" +
+            "6561724c61796f75740104726f6f74010269640109402b69642f726f6f74010b6f7269656e746174" +
+            "696f6e0108766572746963616c010854657874566965770104746578740103303037010874657874" +
+            "53697a65050220010b4672616d654c61796f75740105616c7068610103302e3501056c6162656c01" +
+            "0a402b69642f6c6162656c010974657874436f6c6f720603996633ff01086d61784c696e65730202" +
+            "00000000030000000a0000000000000014000000010000001b000000000000002b10015002200304" +
+            "20050610074000200809200a0b100c4000200d0e10074002500f200310201112201314f0ff"
+
+        fun hex(text: String) = ByteArray(text.length / 2) {
+            text.substring(it * 2, it * 2 + 2).toInt(16).toByte()
+        }
+    }
+}
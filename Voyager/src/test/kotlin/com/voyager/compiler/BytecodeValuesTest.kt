@@ -0,0 +1,137 @@
+package com.voyager.compiler
+
+import android.content.Context
+import android.view.View
+import android.view.ViewGroup
+import com.voyager.compiler.BytecodeInterpreterTest.Companion.FIXTURE_V1
+import com.voyager.compiler.BytecodeInterpreterTest.Companion.FIXTURE_V2
+import com.voyager.compiler.BytecodeInterpreterTest.Companion.hex
+import com.voyager.core.compiler.BytecodeColor
+import com.voyager.core.compiler.BytecodeDimension
+import com.voyager.core.compiler.BytecodeInterpreter
+import com.voyager.core.compiler.BytecodeProgram
+import com.voyager.core.compiler.readVarint
+import com.voyager.core.view.ViewFactory
+import io.mockk.every
+import io.mockk.mockk
+import io.mockk.mockkObject
+import io.mockk.unmockkObject
+import io.mockk.verify
+import org.junit.jupiter.api.AfterEach
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.BeforeEach
+import org.junit.jupiter.api.DisplayName
+import org.junit.jupiter.api.Test
+import org.junit.jupiter.params.ParameterizedTest
+import org.junit.jupiter.params.provider.CsvSource
+import java.nio.ByteBuffer
+
+@DisplayName("BytecodeValues v2 Format Tests")
+class BytecodeValuesTest {
+
+    private val created = mutableListOf<Pair<String, View>>()
+
+    @BeforeEach
+    fun setUp() {
+        created.clear()
+        mockkObject(ViewFactory)
+        every { ViewFactory.createView(any(), any()) } answers {
+            val type = secondArg<String>()
+            val view = mockk<ViewGroup>(relaxed = true)
+            created += type to view
+            view
+        }
+    }
+
+    @AfterEach
+    fun tearDown() {
+        unmockkObject(ViewFactory)
+    }
+
+    @ParameterizedTest
+    @CsvSource("0, 00", "127, 7f", "128, 8001", "300, ac02", "2147483647, ffffffff07")
+    @DisplayName("readVarint decodes LEB128 and stops after the last byte")
+    fun `readVarint edge cases`(value: Int, encoded: String) {
+        val buffer = ByteBuffer.wrap(hex(encoded + "aa"))
+        assertEquals(value, readVarint(buffer))
+        assertEquals(encoded.length / 2, buffer.position())
+    }
+
+    @Test
+    @DisplayName("readVarint keeps all 32 bits of the largest unsigned count")
+    fun `readVarint unsigned max`() {
+        assertEquals(-1, readVarint(ByteBuffer.wrap(hex("ffffffff0f"))))
+    }
+
+    @Test
+    @DisplayName("Header and constant pool decode to Kotlin values")
+    fun `constant pool`() {
+        val program = BytecodeProgram(hex(FIXTURE_V2))
+        assertEquals(4, program.viewCount)
+        assertEquals("LinearLayout", program.rootType)
+        assertEquals("com.example.MainActivity", program.activityName)
+        assertEquals(
+            listOf(
+                "com.example.MainActivity", "LinearLayout", "root", "id", "@+id/root",
+                "orientation", "vertical", "TextView", "text", "007", "textSize",
+                BytecodeDimension(16, "sp"), "FrameLayout", "alpha", "0.5", "label",
+                "@+id/label", "textColor",
+                BytecodeColor(0xff336699.toInt(), hasAlpha = true, lowercase = true), "maxLines", 1,
+            ),
+            program.constants.toList()
+        )
+    }
+
+    @Test
+    @DisplayName("Typed constants print back the attribute text exactly")
+    fun `typed values round trip`() {
+        val program = BytecodeProgram(hex(FIXTURE_V2))
+        val typed = program.constants.filterNot { it is String }.map { it.toString() }
+        assertEquals(listOf("16sp", "#ff336699", "1"), typed)
+
+        assertEquals("-4px", BytecodeDimension(-4, "px").toString())
+        assertEquals("#00FF00", BytecodeColor(0xFF00FF00.toInt(), false, false).toString())
+        assertEquals("#80ff00aa", BytecodeColor(0x80FF00AA.toInt(), true, true).toString())
+    }
+
+    @Test
+    @DisplayName("View index gives each view's descendants and code range")
+    fun `view index`() {
+        val program = BytecodeProgram(hex(FIXTURE_V2))
+        assertEquals(listOf(3, 0, 1, 0), (0 until 4).map { program.descendants(it) })
+        assertEquals(0, program.codeOffset(0))
+        for (view in 0 until 3) assertEquals(program.codeOffset(view + 1), program.codeEnd(view))
+        assertTrue(program.codeEnd(3) > program.codeOffset(3))
+    }
+
+    @Test
+    @DisplayName("executeSubtree builds only the requested view and its descendants")
+    fun `executeSubtree builds one subtree`() {
+        val interpreter = BytecodeInterpreter(mockk<Context>(relaxed = true))
+        val bytecode = hex(FIXTURE_V2)
+
+        val frame = interpreter.executeSubtree(bytecode, 2)
+        assertEquals(listOf("FrameLayout", "TextView"), created.map { it.first })
+        assertSame(created[0].second, frame)
+        verify(exactly = 1) { (frame as ViewGroup).addView(created[1].second) }
+
+        created.clear()
+        val label = interpreter.executeSubtree(bytecode, 3)
+        assertEquals(listOf("TextView"), created.map { it.first })
+        assertSame(created[0].second, label)
+
+        assertThrows(IllegalArgumentException::class.java) { interpreter.executeSubtree(bytecode, 4) }
+    }
+
+    @Test
+    @DisplayName("v1 programs still execute on an interpreter that ran v2")
+    fun `v1 still executes`() {
+        val interpreter = BytecodeInterpreter(mockk<Context>(relaxed = true))
+        interpreter.execute(hex(FIXTURE_V2))
+
+        created.clear()
+        val root = interpreter.execute(hex(FIXTURE_V1))
+        assertEquals(listOf("LinearLayout", "TextView", "FrameLayout", "TextView"), created.map { it.first })
+        assertSame(created[0].second, root)
+    }
+}
@@ -0,0 +1,160 @@
+package com.voyager.data
+
+import com.voyager.core.data.utils.FlatViewTree
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.DisplayName
+import org.junit.jupiter.api.Test
+import java.io.ByteArrayOutputStream
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+@DisplayName("FlatViewTree Native Tree Tests")
+class FlatViewTreeTest {
+
+    // Mirrors FlatTreeSink in xmlParser.cpp, including how child ranges are closed
+    private class TreeWriter {
+        private class Node(val type: Int, val attrStart: Int, val attrCount: Int, var childStart: Int) {
+            var childCount = 0
+        }
+
+        private val ids = LinkedHashMap<String, Int>()
+        private val nodes = mutableListOf<Node>()
+        private val attributes = mutableListOf<Int>()
+        private val children = mutableListOf<Int>()
+        private val open = ArrayDeque<Int>()
+        private val pending = mutableListOf<Int>()
+
+        private fun intern(value: String): Int = ids.getOrPut(value) { ids.size }
+
+        fun start(type: String, vararg attrs: Pair<String, String>) {
+            val index = nodes.size
+            val typeId = intern(type)
+            val attrStart = attributes.size / 2
+            attrs.forEach { (key, value) -> attributes += intern(key); attributes += intern(value) }
+            nodes += Node(typeId, attrStart, attrs.size, pending.size + 1)
+            pending += index
+            open.addLast(index)
+        }
+
+        fun end() {
+            val node = nodes[open.removeLast()]
+            val mark = node.childStart
+            node.childStart = children.size
+            node.childCount = pending.size - mark
+            children += pending.subList(mark, pending.size)
+            while (pending.size > mark) pending.removeAt(pending.size - 1)
+        }
+
+        fun build(
+            hash: ByteArray = ByteArray(16) { it.toByte() },
+            version: Int = FlatViewTree.VERSION,
+        ): ByteArray {
+            val encoded = ids.keys.map { it.toByteArray(Charsets.UTF_8) }
+            val pool = ByteArrayOutputStream().apply { encoded.forEach { write(it) } }.toByteArray()
+            val size = 28 + hash.size + 20 * nodes.size + 4 * attributes.size + 4 * children.size +
+                8 * encoded.size + pool.size
+            val out = ByteBuffer.allocate(size).order(ByteOrder.LITTLE_ENDIAN)
+            out.putInt(FlatViewTree.MAGIC).putShort(version.toShort())
+            out.putShort(hash.size.toShort())
+            out.putInt(nodes.size).putInt(attributes.size / 2).putInt(children.size)
+            out.putInt(encoded.size).putInt(pool.size).put(hash)
+            nodes.forEach {
+                out.putInt(it.type).putInt(it.attrStart).putInt(it.attrCount)
+                out.putInt(it.childStart).putInt(it.childCount)
+            }
+            attributes.forEach { out.putInt(it) }
+            children.forEach { out.putInt(it) }
+            var offset = 0
+            encoded.forEach { out.putInt(offset).putInt(it.size); offset += it.size }
+            out.put(pool)
+            return out.array()
+        }
+    }
+
+    @Test
+    @DisplayName("toViewNode - rebuilds the hierarchy in document order")
+    fun `toViewNode rebuilds hierarchy`() {
+        val writer = TreeWriter()
+        writer.start("LinearLayout", "orientation" to "vertical")
+        writer.start("TextView", "text" to "héllo")
+        writer.end()
+        writer.start("FrameLayout")
+        writer.start("ImageView", "src" to "@drawable/icon")
+        writer.end()
+        writer.end()
+        writer.start("Button", "text" to "OK")
+        writer.end()
+        writer.end()
+
+        val tree = FlatViewTree(writer.build())
+        val root = tree.toViewNode()!!
+
+        assertEquals(5, tree.nodeCount)
+        assertEquals("LinearLayout", root.type)
+        assertEquals("vertical", root.attributes["orientation"])
+        assertEquals(listOf("TextView", "FrameLayout", "Button"), root.children.map { it.type })
+        assertEquals("héllo", root.children[0].attributes["text"])
+        assertEquals("ImageView", root.children[1].children.single().type)
+        assertEquals("@drawable/icon", root.children[1].children.single().attributes["src"])
+        assertTrue(root.children[2].children.isEmpty())
+        assertArrayEquals(ByteArray(16) { it.toByte() }, tree.hash)
+    }
+
+    @Test
+    @DisplayName("hash - carries a fingerprint of any length")
+    fun `hash carries sha256 digest`() {
+        val writer = TreeWriter()
+        writer.start("View")
+        writer.end()
+        val digest = ByteArray(32) { (0xA0 + it).toByte() }
+
+        val tree = FlatViewTree(writer.build(digest))
+
+        assertArrayEquals(digest, tree.hash)
+        assertEquals("View", tree.toViewNode()!!.type)
+    }
+
+    @Test
+    @DisplayName("type - decodes each string once and shares it")
+    fun `type shares decoded strings`() {
+        val writer = TreeWriter()
+        writer.start("LinearLayout")
+        writer.start("TextView")
+        writer.end()
+        writer.start("TextView")
+        writer.end()
+        writer.end()
+
+        val tree = FlatViewTree(writer.build())
+        val children = tree.children(FlatViewTree.ROOT)
+
+        assertEquals(2, children.size)
+        assertSame(tree.type(children[0]), tree.type(children[1]))
+    }
+
+    @Test
+    @DisplayName("constructor - rejects foreign and truncated buffers")
+    fun `constructor rejects invalid input`() {
+        val writer = TreeWriter()
+        writer.start("View")
+        writer.end()
+        val bytes = writer.build()
+
+        assertThrows(IllegalArgumentException::class.java) { FlatViewTree(ByteArray(64)) }
+        assertThrows(IllegalArgumentException::class.java) {
+            FlatViewTree(bytes.copyOf(bytes.size - 1))
+        }
+    }
+
+    @Test
+    @DisplayName("constructor - rejects version 1 trees, whose header had flags, not a hash length")
+    fun `constructor rejects version 1`() {
+        val writer = TreeWriter()
+        writer.start("View")
+        writer.end()
+
+        assertThrows(IllegalArgumentException::class.java) {
+            FlatViewTree(writer.build(version = 1))
+        }
+    }
+}
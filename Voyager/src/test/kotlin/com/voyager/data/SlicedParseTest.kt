@@ -0,0 +1,142 @@
+package com.voyager.data
+
+import com.voyager.core.data.utils.FileHelper
+import com.voyager.core.data.utils.SlicedParse
+import io.mockk.every
+import io.mockk.mockkObject
+import io.mockk.unmockkObject
+import io.mockk.verify
+import org.junit.jupiter.api.AfterEach
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.BeforeEach
+import org.junit.jupiter.api.DisplayName
+import org.junit.jupiter.api.Test
+import java.nio.ByteBuffer
+import java.util.concurrent.CountDownLatch
+import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicInteger
+
+@DisplayName("SlicedParse Time-Sliced Parse Tests")
+class SlicedParseTest {
+
+    // Stands in for the native SlicedParse: suspends `slices - 1` times, then finishes
+    private class FakeNative(var slices: Int) {
+        val tree = byteArrayOf(1, 2, 3)
+        val cancelled = AtomicBoolean(false)
+        val freed = AtomicBoolean(false)
+        val useAfterFree = AtomicBoolean(false)
+        val budgets = mutableListOf<Long>()
+
+        fun advance(budget: Long): Int {
+            if (freed.get()) useAfterFree.set(true)
+            budgets += budget
+            return when {
+                cancelled.get() -> SlicedParse.Status.CANCELLED.id
+                --slices > 0 -> SlicedParse.Status.SUSPENDED.id
+                else -> SlicedParse.Status.FINISHED.id
+            }
+        }
+
+        fun cancel() {
+            if (freed.get()) useAfterFree.set(true)
+            cancelled.set(true)
+        }
+
+        fun end(): ByteArray? {
+            if (freed.getAndSet(true)) useAfterFree.set(true)
+            return if (slices <= 0 && !cancelled.get()) tree else null
+        }
+    }
+
+    private lateinit var native: FakeNative
+
+    @BeforeEach
+    fun setUp() {
+        native = FakeNative(slices = 3)
+        mockkObject(FileHelper)
+        every { FileHelper.beginSlicedParse(any(), any()) } returns HANDLE
+        every { FileHelper.continueSlicedParse(HANDLE, any()) } answers { native.advance(secondArg()) }
+        every { FileHelper.cancelSlicedParse(HANDLE) } answers { native.cancel() }
+        every { FileHelper.endSlicedParse(HANDLE) } answers { native.end() }
+    }
+
+    @AfterEach
+    fun tearDown() {
+        unmockkObject(FileHelper)
+    }
+
+    @Test
+    @DisplayName("advance - resumes slice by slice until the parse finishes")
+    fun `advance resumes until finished`() {
+        val parse = SlicedParse(ByteBuffer.wrap("<View/>".toByteArray()))
+
+        assertEquals(SlicedParse.Status.SUSPENDED, parse.advance(100))
+        assertEquals(SlicedParse.Status.SUSPENDED, parse.advance(200))
+        assertEquals(SlicedParse.Status.FINISHED, parse.advance(300))
+        assertEquals(SlicedParse.Status.FINISHED, parse.advance(400))
+
+        assertEquals(listOf(100L, 200L, 300L), native.budgets)
+        assertArrayEquals(native.tree, parse.finish())
+        assertNull(parse.finish())
+        verify(exactly = 1) { FileHelper.endSlicedParse(HANDLE) }
+    }
+
+    @Test
+    @DisplayName("constructor - copies a heap buffer to a direct one for the native side")
+    fun `constructor copies heap buffers`() {
+        SlicedParse(ByteBuffer.wrap("<View/>".toByteArray())).close()
+
+        verify { FileHelper.beginSlicedParse(match { it.isDirect && it.remaining() == 7 }, any()) }
+    }
+
+    @Test
+    @DisplayName("cancel - the next slice reports CANCELLED and no tree is returned")
+    fun `cancel stops the parse`() {
+        val parse = SlicedParse(ByteBuffer.allocateDirect(16))
+        assertEquals(SlicedParse.Status.SUSPENDED, parse.advance(100))
+
+        parse.cancel()
+
+        assertEquals(SlicedParse.Status.CANCELLED, parse.advance(100))
+        assertEquals(SlicedParse.Status.CANCELLED, parse.status)
+        assertNull(parse.finish())
+    }
+
+    @Test
+    @DisplayName("cancel - never reaches a native parse that finish already freed")
+    fun `cancel after finish is ignored`() {
+        val parse = SlicedParse(ByteBuffer.allocateDirect(16))
+        parse.finish()
+
+        parse.cancel()
+        parse.advance(100)
+
+        verify(exactly = 0) { FileHelper.cancelSlicedParse(any()) }
+        verify(exactly = 0) { FileHelper.continueSlicedParse(any(), any()) }
+    }
+
+    @Test
+    @DisplayName("cancel - racing finish from another thread is safe")
+    fun `cancel racing finish`() {
+        val cancels = AtomicInteger()
+        repeat(200) {
+            native = FakeNative(slices = 3)
+            val parse = SlicedParse(ByteBuffer.allocateDirect(16))
+            val start = CountDownLatch(1)
+            val canceller = Thread {
+                start.await()
+                parse.cancel()
+                cancels.incrementAndGet()
+            }.apply { start() }
+            start.countDown()
+            parse.finish()
+            canceller.join()
+            assertFalse(native.useAfterFree.get())
+        }
+        assertEquals(200, cancels.get())
+    }
+
+    private companion object {
+        const val HANDLE = 42L
+    }
+}
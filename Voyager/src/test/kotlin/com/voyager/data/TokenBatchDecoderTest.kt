@@ -0,0 +1,90 @@
+package com.voyager.data
+
+import com.voyager.core.data.utils.TokenBatchDecoder
+import com.voyager.core.data.utils.XmlToken
+import org.junit.jupiter.api.Assertions.*
+import org.junit.jupiter.api.DisplayName
+import org.junit.jupiter.api.Test
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+@DisplayName("TokenBatchDecoder Binary Batch Tests")
+class TokenBatchDecoderTest {
+
+    // Mirrors the encoder in xmlParser.cpp (BatchTokenSink + InternTable)
+    private class BatchWriter {
+        val buffer: ByteBuffer = ByteBuffer.allocateDirect(1024).order(ByteOrder.LITTLE_ENDIAN)
+        private val ids = LinkedHashMap<String, Int>()
+
+        val strings: Array<String?>
+            get() = ids.keys.toTypedArray<String?>() + arrayOfNulls(4)
+
+        fun intern(value: String): Int = ids.getOrPut(value) { ids.size }
+
+        fun start(type: String, vararg attributes: Pair<String, String>) {
+            buffer.put(TokenBatchDecoder.OP_START_ELEMENT.toByte())
+            buffer.putInt(intern(type))
+            buffer.putShort(attributes.size.toShort())
+            attributes.forEach { (key, value) -> buffer.putInt(intern(key)).putInt(intern(value)) }
+        }
+
+        fun end(type: String) {
+            buffer.put(TokenBatchDecoder.OP_END_ELEMENT.toByte())
+            buffer.putInt(intern(type))
+        }
+
+        fun text(value: String) {
+            buffer.put(TokenBatchDecoder.OP_TEXT.toByte())
+            buffer.putInt(intern(value))
+        }
+    }
+
+    @Test
+    @DisplayName("decode - resolves interned ids against the string table")
+    fun `decode reproduces tokens`() {
+        val writer = BatchWriter()
+        writer.start("LinearLayout", "layout_width" to "match_parent")
+        writer.start("TextView", "layout_width" to "wrap_content", "text" to "héllo")
+        writer.text("body")
+        writer.end("TextView")
+        writer.end("LinearLayout")
+
+        val tokens = mutableListOf<XmlToken>()
+        TokenBatchDecoder.decode(writer.buffer, 5, writer.strings) { tokens += it }
+
+        assertEquals(5, tokens.size)
+        val root = tokens[0] as XmlToken.StartElement
+        assertEquals("LinearLayout", root.type)
+        assertEquals("match_parent", root.attributes["layout_width"])
+        val child = tokens[1] as XmlToken.StartElement
+        assertEquals("TextView", child.type)
+        assertEquals("wrap_content", child.attributes["layout_width"])
+        assertEquals("héllo", child.attributes["text"])
+        assertEquals(XmlToken.Text("body"), tokens[2])
+        assertEquals(XmlToken.EndElement("TextView"), tokens[3])
+        assertEquals(XmlToken.EndElement("LinearLayout"), tokens[4])
+    }
+
+    @Test
+    @DisplayName("decode - shares element names with the same id")
+    fun `decode shares interned strings`() {
+        val writer = BatchWriter()
+        writer.start("TextView")
+        writer.end("TextView")
+
+        val tokens = mutableListOf<XmlToken>()
+        TokenBatchDecoder.decode(writer.buffer, 2, writer.strings) { tokens += it }
+
+        assertSame((tokens[0] as XmlToken.StartElement).type, (tokens[1] as XmlToken.EndElement).type)
+    }
+
+    @Test
+    @DisplayName("decode - rejects unknown opcodes")
+    fun `decode rejects unknown opcode`() {
+        val buffer = ByteBuffer.allocateDirect(4).put(0x7F.toByte())
+
+        assertThrows(IllegalStateException::class.java) {
+            TokenBatchDecoder.decode(buffer, 1, arrayOfNulls(0)) { }
+        }
+    }
+}
@@ -0,0 +1,104 @@
+/**
+ * Gradle task that builds Voyager's native layout compiler for the build machine.
+ *
+ * Configures and builds the `layoutBundleTool` target of Voyager's native sources
+ * (`Voyager/src/main/cpp`) with CMake, outside of any Android ABI, so
+ * [PrecompileLayoutsTask] compiles layouts with the same code the device runs. The host
+ * needs CMake, a C++17 compiler and the Expat development files.
+ *
+ * Usage example:
+ * ```kotlin
+ * tasks.register<BuildLayoutCompilerTask>("buildVoyagerLayoutCompiler") {
+ *     sourceDir.set(rootProject.file("Voyager/src/main/cpp"))
+ *     cmake.set("cmake")
+ *     buildDir.set(layout.buildDirectory.dir("voyager-host"))
+ * }
+ * ```
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+package com.voyager.plugin
+
+import org.gradle.api.DefaultTask
+import org.gradle.api.GradleException
+import org.gradle.api.file.DirectoryProperty
+import org.gradle.api.file.RegularFile
+import org.gradle.api.provider.Property
+import org.gradle.api.provider.Provider
+import org.gradle.api.tasks.Input
+import org.gradle.api.tasks.InputDirectory
+import org.gradle.api.tasks.Internal
+import org.gradle.api.tasks.OutputDirectory
+import org.gradle.api.tasks.PathSensitive
+import org.gradle.api.tasks.PathSensitivity
+import org.gradle.api.tasks.TaskAction
+import org.gradle.process.ExecOperations
+import javax.inject.Inject
+
+/**
+ * Task for building the host `layoutBundleTool` from Voyager's native sources. Not
+ * cacheable: the binary only runs on machines like the one that built it.
+ */
+abstract class BuildLayoutCompilerTask @Inject constructor(
+    private val execOperations: ExecOperations,
+) : DefaultTask() {
+
+    companion object {
+        private const val TARGET = "layoutBundleTool"
+    }
+
+    /**
+     * Voyager's native sources, the directory holding their `CMakeLists.txt`.
+     */
+    @get:PathSensitive(PathSensitivity.RELATIVE)
+    @get:InputDirectory
+    abstract val sourceDir: DirectoryProperty
+
+    /**
+     * The CMake executable, `cmake` from the `PATH` by default.
+     */
+    @get:Input
+    abstract val cmake: Property<String>
+
+    /**
+     * CMake build directory; the compiler is built at its top level.
+     */
+    @get:OutputDirectory
+    abstract val buildDir: DirectoryProperty
+
+    /**
+     * The built compiler, carrying the dependency on this task.
+     */
+    @get:Internal
+    val executable: Provider<RegularFile>
+        get() = buildDir.file(TARGET)
+
+    /**
+     * Main task action: configures and builds the compiler target.
+     */
+    @TaskAction
+    fun build() {
+        val build = buildDir.get().asFile.path
+        cmake("-S", sourceDir.get().asFile.path, "-B", build, "-DCMAKE_BUILD_TYPE=Release")
+        cmake("--build", build, "--target", TARGET)
+        if (!executable.get().asFile.canExecute()) {
+            throw GradleException(
+                "$TARGET was not built; the host build needs the Expat development files"
+            )
+        }
+    }
+
+    private fun cmake(vararg arguments: String) {
+        val result = execOperations.exec { spec ->
+            spec.commandLine(cmake.get(), *arguments)
+            spec.isIgnoreExitValue = true
+        }
+        if (result.exitValue != 0) {
+            throw GradleException(
+                "Failed to build $TARGET (cmake ${arguments.joinToString(" ")}); " +
+                        "the host build needs CMake, a C++17 compiler and the Expat development files"
+            )
+        }
+    }
+}
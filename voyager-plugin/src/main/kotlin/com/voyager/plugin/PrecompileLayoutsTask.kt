@@ -0,0 +1,201 @@
+/**
+ * Gradle task that compiles layout XML to Voyager's binary flat trees at build time.
+ *
+ * The layouts (typically the XML files in `res/raw`) are compiled by a host build of
+ * Voyager's native compiler, `layoutBundleTool` (see
+ * `Voyager/src/main/cpp/tools/layoutBundleTool.cpp`), into the variant's assets, where
+ * `Voyager.loadPrecompiledLayout` reads them without parsing any XML at runtime.
+ *
+ * Key features:
+ * - Incremental: only added or modified layouts are recompiled, removed ones are dropped
+ * - One mapped bundle (`voyager/layouts.bundle`) or one `.vft` asset per layout
+ * - Byte-identical output for identical inputs, so the task is cacheable
+ *
+ * Usage example:
+ * ```kotlin
+ * tasks.register<PrecompileLayoutsTask>("precompileLayouts") {
+ *     layoutFiles.from(fileTree("src/main/res/raw").include("*.xml"))
+ *     compiler.set(file("/path/to/layoutBundleTool"))
+ *     bundle.set(true)
+ *     treeDir.set(layout.buildDirectory.dir("intermediates/voyager-layouts"))
+ *     outputDir.set(layout.buildDirectory.dir("generated/voyager-assets"))
+ * }
+ * ```
+ *
+ * @author Abdelrahman Omar
+ * @since 1.0.0
+ */
+package com.voyager.plugin
+
+import org.gradle.api.DefaultTask
+import org.gradle.api.GradleException
+import org.gradle.api.file.ConfigurableFileCollection
+import org.gradle.api.file.DirectoryProperty
+import org.gradle.api.file.FileType
+import org.gradle.api.file.RegularFileProperty
+import org.gradle.api.logging.Logger
+import org.gradle.api.logging.Logging
+import org.gradle.api.provider.Property
+import org.gradle.api.tasks.CacheableTask
+import org.gradle.api.tasks.IgnoreEmptyDirectories
+import org.gradle.api.tasks.Input
+import org.gradle.api.tasks.InputFile
+import org.gradle.api.tasks.InputFiles
+import org.gradle.api.tasks.OutputDirectory
+import org.gradle.api.tasks.PathSensitive
+import org.gradle.api.tasks.PathSensitivity
+import org.gradle.api.tasks.TaskAction
+import org.gradle.process.ExecOperations
+import org.gradle.work.ChangeType
+import org.gradle.work.Incremental
+import org.gradle.work.InputChanges
+import java.io.ByteArrayOutputStream
+import java.io.File
+import javax.inject.Inject
+
+/**
+ * Task for precompiling layout XML files into binary layouts in the APK's assets.
+ */
+@CacheableTask
+abstract class PrecompileLayoutsTask @Inject constructor(
+    private val execOperations: ExecOperations,
+) : DefaultTask() {
+
+    companion object {
+        /** Asset path of the bundle; `Voyager.loadPrecompiledLayout` maps it from the APK. */
+        const val BUNDLE_ASSET = "voyager/layouts.bundle"
+
+        /** Asset directory of the per-layout trees when layouts are not bundled. */
+        const val TREES_ASSET_DIR = "voyager/layouts"
+
+        private const val TREE_EXTENSION = "vft"
+
+        private val LOGGER: Logger = Logging.getLogger(PrecompileLayoutsTask::class.java)
+    }
+
+    /**
+     * Layout XML files to compile. Each file becomes the layout named after it, so names
+     * must be unique across the collection.
+     */
+    @get:PathSensitive(PathSensitivity.NAME_ONLY)
+    @get:IgnoreEmptyDirectories
+    @get:Incremental
+    @get:InputFiles
+    abstract val layoutFiles: ConfigurableFileCollection
+
+    /**
+     * The host `layoutBundleTool` executable. A different compiler recompiles everything.
+     */
+    @get:PathSensitive(PathSensitivity.NONE)
+    @get:InputFile
+    abstract val compiler: RegularFileProperty
+
+    /**
+     * Whether the layouts are packed into one bundle ([BUNDLE_ASSET]) or written as one
+     * asset per layout under [TREES_ASSET_DIR].
+     */
+    @get:Input
+    abstract val bundle: Property<Boolean>
+
+    /**
+     * Directory holding one compiled tree per layout between builds, so an incremental
+     * run only compiles what changed and packs the rest as is.
+     */
+    @get:OutputDirectory
+    abstract val treeDir: DirectoryProperty
+
+    /**
+     * Assets directory the precompiled layouts are written to.
+     */
+    @get:OutputDirectory
+    abstract val outputDir: DirectoryProperty
+
+    /**
+     * Main task action for layout precompilation.
+     */
+    @TaskAction
+    fun precompile(inputChanges: InputChanges) {
+        val trees = treeDir.get().asFile
+        val assets = outputDir.get().asFile
+        checkNames()
+
+        if (!inputChanges.isIncremental) {
+            LOGGER.info("Precompiling all layouts.")
+            trees.listFiles()?.forEach { it.deleteRecursively() }
+            assets.listFiles()?.forEach { it.deleteRecursively() }
+        }
+
+        // Removals first: a layout moved to another directory is removed under its old path
+        // and added under the new one, and must not lose its fresh tree to the removal
+        val (removed, changed) = inputChanges.getFileChanges(layoutFiles)
+            .filter { it.fileType != FileType.DIRECTORY }
+            .partition { it.changeType == ChangeType.REMOVED }
+        removed.forEach { treeOf(trees, it.file).delete() }
+        changed.forEach { compile(it.file, treeOf(trees, it.file)) }
+        LOGGER.info("Compiled ${changed.size} changed layouts.")
+
+        if (bundle.get()) {
+            val bundleFile = File(assets, BUNDLE_ASSET)
+            bundleFile.parentFile.mkdirs()
+            run("--pack", trees.path, bundleFile.path, what = "pack layouts into $BUNDLE_ASSET")
+        } else {
+            syncTrees(trees, File(assets, TREES_ASSET_DIR))
+        }
+    }
+
+    /**
+     * Fails on two layouts with the same name, which would overwrite each other.
+     */
+    private fun checkNames() {
+        layoutFiles.files.groupBy { it.nameWithoutExtension }.values
+            .firstOrNull { it.size > 1 }
+            ?.let { clash ->
+                throw GradleException(
+                    "Layouts ${clash.joinToString()} share the name ${clash[0].nameWithoutExtension}"
+                )
+            }
+    }
+
+    /**
+     * The compiled tree of [layout] in [trees], named after the layout alone.
+     */
+    private fun treeOf(trees: File, layout: File) =
+        File(trees, "${layout.nameWithoutExtension}.$TREE_EXTENSION")
+
+    /**
+     * Compiles one layout to its flat tree.
+     */
+    private fun compile(layout: File, tree: File) {
+        tree.parentFile.mkdirs()
+        run("--compile", layout.path, tree.path, what = "precompile ${layout.name}")
+    }
+
+    /**
+     * Mirrors the compiled trees into [assetsDir], one asset per layout.
+     */
+    private fun syncTrees(trees: File, assetsDir: File) {
+        assetsDir.mkdirs()
+        val current = trees.listFiles { file -> file.extension == TREE_EXTENSION }.orEmpty()
+        val names = current.mapTo(HashSet()) { it.name }
+        assetsDir.listFiles()?.filterNot { it.name in names }?.forEach { it.delete() }
+        current.forEach { tree -> tree.copyTo(File(assetsDir, tree.name), overwrite = true) }
+    }
+
+    /**
+     * Runs the compiler with [arguments]; its own error message is kept in the failure.
+     */
+    private fun run(vararg arguments: String, what: String) {
+        val errors = ByteArrayOutputStream()
+        val output = ByteArrayOutputStream()
+        val result = execOperations.exec { spec ->
+            spec.commandLine(compiler.get().asFile.path, *arguments)
+            spec.standardOutput = output
+            spec.errorOutput = errors
+            spec.isIgnoreExitValue = true
+        }
+        if (result.exitValue != 0) {
+            throw GradleException("Failed to $what: ${errors.toString(Charsets.UTF_8).trim()}")
+        }
+        output.toString(Charsets.UTF_8).trim().takeIf { it.isNotEmpty() }?.let { LOGGER.info(it) }
+    }
+}
@@ -24,6 +24,10 @@
  *
  * voyager {
  *     resFiles.from(fileTree("src/main/res"))
+ *
+ *     // Optional: compile layouts to binary assets at build time
+ *     layoutFiles.from(fileTree("src/main/res/raw").include("*.xml"))
+ *     nativeSources.set(rootProject.layout.projectDirectory.dir("Voyager/src/main/cpp"))
  * }
  * ```
  *
@@ -34,6 +38,9 @@ package com.voyager.plugin
 
 import org.gradle.api.Project
 import org.gradle.api.file.ConfigurableFileCollection
+import org.gradle.api.file.DirectoryProperty
+import org.gradle.api.file.RegularFileProperty
+import org.gradle.api.provider.Property
 import javax.inject.Inject
 
 /**
@@ -45,4 +52,34 @@ abstract class ResourcesExtension @Inject constructor(target: Project) {
      * This is lazily initialized for better performance.
      */
     val resFiles: ConfigurableFileCollection = target.objects.fileCollection()
-}
\ No newline at end of file
+
+    /**
+     * Layout XML files to precompile into the APK's assets (see `PrecompileLayoutsTask`),
+     * loaded at runtime with `Voyager.loadPrecompiledLayout` instead of being parsed.
+     * Nothing is precompiled while this is empty.
+     */
+    val layoutFiles: ConfigurableFileCollection = target.objects.fileCollection()
+
+    /**
+     * Whether precompiled layouts are packed into one mapped bundle (the default) or
+     * written as one asset per layout.
+     */
+    val bundleLayouts: Property<Boolean> =
+        target.objects.property(Boolean::class.java).convention(true)
+
+    /**
+     * Voyager's native sources (`Voyager/src/main/cpp`), built for the host to precompile
+     * [layoutFiles]. Not needed when [layoutCompiler] is set.
+     */
+    val nativeSources: DirectoryProperty = target.objects.directoryProperty()
+
+    /**
+     * A prebuilt host `layoutBundleTool`, used instead of building one from [nativeSources].
+     */
+    val layoutCompiler: RegularFileProperty = target.objects.fileProperty()
+
+    /**
+     * The CMake used to build the layout compiler, `cmake` from the `PATH` by default.
+     */
+    val cmake: Property<String> = target.objects.property(String::class.java).convention("cmake")
+}
@@ -7,6 +7,7 @@
  * Key features:
  * - Efficient resource management
  * - Optimized code generation
+ * - Build-time layout precompilation into the APK's assets
  * - Incremental build support
  * - Memory-efficient processing
  * - Thread-safe operations
@@ -25,6 +26,8 @@
  *
  * resources {
  *     resFiles.from(fileTree("src/main/res"))
+ *     layoutFiles.from(fileTree("src/main/res/raw").include("*.xml"))
+ *     nativeSources.set(rootProject.layout.projectDirectory.dir("Voyager/src/main/cpp"))
  * }
  * ```
  *
@@ -34,6 +37,7 @@
 package com.voyager.plugin
 
 import com.android.build.api.variant.AndroidComponentsExtension
+import com.android.build.api.variant.GeneratesApk
 import com.android.build.api.variant.Variant
 import org.gradle.api.GradleException
 import org.gradle.api.Plugin
@@ -57,6 +61,9 @@ class ResourcesPlugin : Plugin<Project> {
     companion object {
         private const val EXTENSION_NAME = "resources"
         private const val GENERATED_DIR = "generated/kt-resources"
+        private const val COMPILER_TASK = "buildVoyagerLayoutCompiler"
+        private const val COMPILER_DIR = "voyager-host"
+        private const val LAYOUT_TREES_DIR = "intermediates/voyager-layouts"
         private val LOGGER: Logger = Logging.getLogger(ResourcesPlugin::class.java)
     }
 
@@ -82,6 +89,15 @@ class ResourcesPlugin : Plugin<Project> {
             // Configure generated code directory
             val generatedDir = project.layout.buildDirectory.dir(GENERATED_DIR)
 
+            // Host build of the native layout compiler, only realized when layouts are precompiled
+            val compilerTask = project.tasks.register(
+                COMPILER_TASK, BuildLayoutCompilerTask::class.java
+            ) { task ->
+                task.sourceDir.set(extension.nativeSources)
+                task.cmake.set(extension.cmake)
+                task.buildDir.set(project.layout.buildDirectory.dir(COMPILER_DIR))
+            }
+
             // Get Android components with proper error handling
             val androidComponents =
                 project.extensions.findByType(AndroidComponentsExtension::class.java)
@@ -101,6 +117,11 @@ class ResourcesPlugin : Plugin<Project> {
 
                     // Configure source sets and dependencies
                     configureVariant(variant, generateTask, project)
+
+                    // Precompile layouts into the variant's assets, if any are configured
+                    if (!extension.layoutFiles.isEmpty) {
+                        configureLayoutPrecompilation(project, variant, extension, compilerTask)
+                    }
                 } catch (e: Exception) {
                     LOGGER.error("Failed to configure variant ${variant.name}: ${e.message}", e)
                     throw GradleException("Failed to configure variant ${variant.name}", e)
@@ -172,6 +193,55 @@ class ResourcesPlugin : Plugin<Project> {
         }
     }
 
+    /**
+     * Registers the layout precompilation task for the given variant and adds its output
+     * to the variant's assets.
+     *
+     * @param project The Gradle project
+     * @param variant The Android variant
+     * @param extension The resources extension
+     * @param compilerTask The task building the host compiler, used unless a prebuilt
+     *        compiler is configured
+     * @throws GradleException if no compiler is configured or configuration fails
+     */
+    private fun configureLayoutPrecompilation(
+        project: Project,
+        variant: Variant,
+        extension: ResourcesExtension,
+        compilerTask: TaskProvider<BuildLayoutCompilerTask>,
+    ) {
+        if (!extension.layoutCompiler.isPresent && !extension.nativeSources.isPresent) {
+            throw GradleException(
+                "resources.layoutFiles is set, but neither resources.layoutCompiler " +
+                        "nor resources.nativeSources is."
+            )
+        }
+        try {
+            val precompileTask = project.tasks.register(
+                "precompileLayouts${variant.name.capitalize()}", PrecompileLayoutsTask::class.java
+            ) { task ->
+                task.layoutFiles.setFrom(extension.layoutFiles)
+                task.compiler.set(
+                    extension.layoutCompiler.orElse(compilerTask.flatMap { it.executable })
+                )
+                task.bundle.set(extension.bundleLayouts)
+                task.treeDir.set(
+                    project.layout.buildDirectory.dir("$LAYOUT_TREES_DIR/${variant.name}")
+                )
+            }
+
+            variant.sources.assets?.addGeneratedSourceDirectory(
+                precompileTask, PrecompileLayoutsTask::outputDir
+            )
+
+            // The bundle is mapped straight from the APK, so it must be stored uncompressed
+            (variant as? GeneratesApk)?.androidResources?.noCompress?.add("bundle")
+        } catch (e: Exception) {
+            LOGGER.error("Failed to configure layout precompilation for ${variant.name}: ${e.message}", e)
+            throw GradleException("Failed to configure layout precompilation for ${variant.name}", e)
+        }
+    }
+
     /**
      * Capitalizes the first character of a string.
      *